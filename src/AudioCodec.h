@@ -0,0 +1,96 @@
+//*****************************************************************
+/*
+  JackTrip: A System for High-Quality Audio Network Performance
+  over the Internet
+
+  Copyright (c) 2008 Juan-Pablo Caceres, Chris Chafe.
+  SoundWIRE group at CCRMA, Stanford University.
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation
+  files (the "Software"), to deal in the Software without
+  restriction, including without limitation the rights to use,
+  copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following
+  conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+*/
+//*****************************************************************
+
+
+/**
+ * \file AudioCodec.h
+ * \date October 2026
+ */
+
+#ifndef __AUDIOCODEC_H__
+#define __AUDIOCODEC_H__
+
+#include "jacktrip_types.h"
+
+
+/** \brief Base class of the codecs that compress the audio sent to the peer.
+ *
+ * The audio interface codes its input in packets of getFrames() frames before
+ * they go to the sending RingBuffer, and decodes the packets it reads from the
+ * receiving RingBuffer. Packets have the same size, getPacketSize(), whatever
+ * the audio, so they go through the RingBuffers and the network like PCM audio
+ * (with redundancy, FEC and NACK).
+ *
+ * When a packet doesn't arrive in time to be played (the RingBuffer underruns),
+ * the codec conceals it from the audio it decoded before.
+ *
+ * Subclass this class to add a codec, see OpusCodec, BlockFloatCodec and
+ * HalfFloatCodec.
+ */
+class AudioCodec
+{
+public:
+
+    /// \brief Enum of the codecs
+    enum codecT {
+        PCM, ///< No codec, the audio is sent in the bit resolution of the session
+        OPUS, ///< Opus, see OpusCodec
+        BLOCKFLOAT, ///< Block floating point, see BlockFloatCodec
+        HALFFLOAT ///< 16 bit floating point, see HalfFloatCodec
+    };
+
+    /// \brief The class destructor
+    virtual ~AudioCodec() {}
+
+    /// \brief Frames of each packet, at the local sampling rate
+    virtual int getFrames() const = 0;
+    /// \brief Bytes of each coded packet
+    virtual int getPacketSize() const = 0;
+
+    /** \brief Codes a packet
+   * \param input getFrames() samples of each channel
+   * \param output Returns the coded packet, getPacketSize() bytes
+   */
+    virtual void encode(sample_t* const* input, int8_t* output) = 0;
+
+    /** \brief Decodes a packet
+   * \param input Coded packet, getPacketSize() bytes
+   * \param output Returns getFrames() samples of each channel
+   */
+    virtual void decode(const int8_t* input, sample_t* const* output) = 0;
+
+    /** \brief Conceals a packet that was lost or arrived too late
+   * \param output Returns getFrames() samples of each channel
+   */
+    virtual void conceal(sample_t* const* output) = 0;
+};
+
+#endif //__AUDIOCODEC_H__
@@ -0,0 +1,194 @@
+//*****************************************************************
+/*
+  JackTrip: A System for High-Quality Audio Network Performance
+  over the Internet
+
+  Copyright (c) 2008 Juan-Pablo Caceres, Chris Chafe.
+  SoundWIRE group at CCRMA, Stanford University.
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation
+  files (the "Software"), to deal in the Software without
+  restriction, including without limitation the rights to use,
+  copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following
+  conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+*/
+//*****************************************************************
+
+/**
+ * \file AudioConverter.cpp
+ * \date October 2026
+ */
+
+#include "AudioConverter.h"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+const double AudioConverter::FilterCutoff = 0.9;
+const sample_t AudioConverter::sMaxSample = 32767.0f / 32768.0f;
+
+
+//*******************************************************************************
+AudioConverter::AudioConverter(int NumChannels,
+                               AudioInterface::audioBitResolutionT SourceResolution, int SourceRate,
+                               AudioInterface::audioBitResolutionT TargetResolution, int TargetRate) :
+    mNumChannels(NumChannels),
+    mSourceResolution(SourceResolution),
+    mTargetResolution(TargetResolution)
+{
+    if ( (NumChannels < 1) || (SourceRate <= 0) || (TargetRate <= 0) ) {
+        throw std::invalid_argument("Audio conversion needs channels and sampling rates");
+    }
+    mStep = static_cast<double>(SourceRate) / TargetRate;
+    if (mStep > 1.0) {
+        makeFilter();
+    } else {
+        // Catmull-Rom spline
+        mLookBack = 1;
+        mLookAhead = 2;
+        mTaps = 0;
+    }
+    mHistorySize = mLookBack + mLookAhead;
+    mHistory.resize(mNumChannels * mHistorySize);
+    reset();
+}
+
+
+//*******************************************************************************
+void AudioConverter::makeFilter()
+{
+    // Cutoff in cycles per peer sample, times 2 (sinc(fc * x) has its zeros at
+    // multiples of 1 / fc peer samples)
+    const double pi = std::acos(-1.0);
+    double fc = FilterCutoff / mStep;
+    int half = static_cast<int>(std::ceil(FilterZeros / fc));
+    mLookBack = half - 1;
+    mLookAhead = half;
+    mTaps = mLookBack + mLookAhead + 1;
+
+    // Row p is for local samples p / FilterPhases after a peer sample, tap i
+    // weighs the peer sample i - mLookBack after that one
+    mFilter.resize((FilterPhases + 1) * mTaps);
+    for (int p = 0; p <= FilterPhases; p++) {
+        sample_t* h = mFilter.data() + p * mTaps;
+        double t = static_cast<double>(p) / FilterPhases;
+        double sum = 0.0;
+        for (int i = 0; i < mTaps; i++) {
+            double x = (i - mLookBack) - t;
+            double u = x / half;
+            double window = 0.42 + 0.5 * std::cos(pi * u) + 0.08 * std::cos(2.0 * pi * u);
+            double sinc = (x == 0.0) ? 1.0 : std::sin(pi * fc * x) / (pi * fc * x);
+            h[i] = static_cast<sample_t>(sinc * window);
+            sum += h[i];
+        }
+        // Unity gain at DC for every phase
+        for (int i = 0; i < mTaps; i++) { h[i] = static_cast<sample_t>(h[i] / sum); }
+    }
+}
+
+
+//*******************************************************************************
+void AudioConverter::reset()
+{
+    mHistory.fill(0);
+    // The first local sample needs the first input sample
+    mPosition = -mLookAhead;
+}
+
+
+//*******************************************************************************
+uint32_t AudioConverter::getMaxOutputFrames(uint32_t input_frames) const
+{
+    if (mStep == 1.0) { return input_frames; }
+    return static_cast<uint32_t>(std::ceil(input_frames / mStep)) + 1;
+}
+
+
+//*******************************************************************************
+uint32_t AudioConverter::convert(const int8_t* input, uint32_t input_frames,
+                                 int8_t* output, uint32_t output_stride)
+{
+    int source_size = mSourceResolution;
+    int target_size = mTargetResolution;
+    sample_t sample;
+
+    // mSamples[mHistorySize + i] is input sample i, the history comes before it
+    int total = mHistorySize + static_cast<int>(input_frames);
+    if (mSamples.size() < total) { mSamples.resize(total); }
+
+    // Same rates: only the bit resolution changes
+    if (mStep == 1.0) {
+        for (int c = 0; c < mNumChannels; c++) {
+            const int8_t* in = input + c * input_frames * source_size;
+            int8_t* out = output + c * output_stride * target_size;
+            AudioInterface::fromBitToSampleConversion(in, mSamples.data(), input_frames, mSourceResolution);
+            AudioInterface::fromSampleToBitConversion(mSamples.data(), out, input_frames, mTargetResolution);
+        }
+        return input_frames;
+    }
+
+    double start = mPosition;
+    uint32_t frames = 0;
+    for (int c = 0; c < mNumChannels; c++) {
+        sample_t* x = mSamples.data();
+        sample_t* history = mHistory.data() + c * mHistorySize;
+        std::memcpy(x, history, mHistorySize * sizeof(sample_t));
+        const int8_t* in = input + c * input_frames * source_size;
+        AudioInterface::fromBitToSampleConversion(in, x + mHistorySize, input_frames, mSourceResolution);
+
+        int8_t* out = output + c * output_stride * target_size;
+        double position = start;
+        frames = 0;
+        while (true) {
+            double k = std::floor(position);
+            int k1 = mHistorySize + static_cast<int>(k);
+            if (k1 + mLookAhead >= total) { break; }
+            float t = static_cast<float>(position - k);
+            if (mTaps == 0) {
+                // Catmull-Rom spline through x[k-1], x[k], x[k+1], x[k+2], between x[k] and x[k+1]
+                float y0 = x[k1 - 1], y1 = x[k1], y2 = x[k1 + 1], y3 = x[k1 + 2];
+                sample = y1 + 0.5f * t * ( (y2 - y0)
+                                           + t * ( (2.0f * y0 - 5.0f * y1 + 4.0f * y2 - y3)
+                                                   + t * (3.0f * (y1 - y2) + y3 - y0) ) );
+            } else {
+                // Low-pass filter, between the two tabulated phases around t
+                double phase = (position - k) * FilterPhases;
+                int p = static_cast<int>(phase);
+                float a = static_cast<float>(phase - p);
+                const sample_t* h0 = mFilter.data() + p * mTaps;
+                const sample_t* h1 = h0 + mTaps;
+                const sample_t* y = x + k1 - mLookBack;
+                float s0 = 0.0f, s1 = 0.0f;
+                for (int i = 0; i < mTaps; i++) {
+                    s0 += h0[i] * y[i];
+                    s1 += h1[i] * y[i];
+                }
+                sample = s0 + a * (s1 - s0);
+            }
+            // Interpolation can overshoot full scale, which doesn't fit the integer samples
+            if (sample > sMaxSample) { sample = sMaxSample; } else if (sample < -1.0f) { sample = -1.0f; }
+            AudioInterface::fromSampleToBitConversion(&sample, out + frames * target_size, mTargetResolution);
+            frames++;
+            position += mStep;
+        }
+        mPosition = position - input_frames;
+        std::memcpy(history, x + input_frames, mHistorySize * sizeof(sample_t));
+    }
+    return frames;
+}
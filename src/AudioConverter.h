@@ -0,0 +1,120 @@
+//*****************************************************************
+/*
+  JackTrip: A System for High-Quality Audio Network Performance
+  over the Internet
+
+  Copyright (c) 2008 Juan-Pablo Caceres, Chris Chafe.
+  SoundWIRE group at CCRMA, Stanford University.
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation
+  files (the "Software"), to deal in the Software without
+  restriction, including without limitation the rights to use,
+  copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following
+  conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+*/
+//*****************************************************************
+
+/**
+ * \file AudioConverter.h
+ * \date October 2026
+ */
+
+#ifndef __AUDIOCONVERTER_H__
+#define __AUDIOCONVERTER_H__
+
+#include <QVector>
+
+#include "jacktrip_types.h"
+#include "AudioInterface.h"
+
+
+/** \brief Converts the audio of peer packets to the local format.
+ *
+ * Each side sends audio in its own bit resolution and sampling rate, and says
+ * which in the packet headers. The receiver converts the peer audio with this
+ * class: samples are decoded from the peer bit resolution, resampled to the
+ * local rate if the rates differ, and encoded in the local bit resolution.
+ *
+ * When the peer rate is lower, the resampler interpolates between the 4 nearest
+ * peer samples (Catmull-Rom spline). It costs little and adds 2 peer samples of
+ * latency. When the peer rate is higher, peer content above half the local
+ * rate would fold back into the audible band, so the resampler is a windowed
+ * sinc low-pass filter instead (Blackman window, cutoff at 90% of the local
+ * Nyquist frequency). Its coefficients are tabulated for FilterPhases
+ * positions between two peer samples, and interpolated between them. It adds
+ * FilterZeros / FilterCutoff local samples of latency (0.74 ms at 48 kHz).
+ *
+ * Audio is planar, like the packets: each channel has its frames back to back.
+ */
+class AudioConverter
+{
+public:
+
+    /** \brief The class constructor
+   * \param NumChannels Number of channels
+   * \param SourceResolution Bit resolution of the peer audio
+   * \param SourceRate Sampling rate of the peer audio, in Hz
+   * \param TargetResolution Local bit resolution
+   * \param TargetRate Local sampling rate, in Hz
+   */
+    AudioConverter(int NumChannels,
+                   AudioInterface::audioBitResolutionT SourceResolution, int SourceRate,
+                   AudioInterface::audioBitResolutionT TargetResolution, int TargetRate);
+
+    /// \brief Returns the most frames convert() writes for input_frames
+    uint32_t getMaxOutputFrames(uint32_t input_frames) const;
+
+    /** \brief Converts peer frames to local frames
+   * \param input NumChannels channels of input_frames peer samples
+   * \param input_frames Frames in input
+   * \param output Returns NumChannels channels of output_stride local samples
+   * \param output_stride Frames of each output channel, getMaxOutputFrames() or more
+   * \return Frames written in each output channel
+   */
+    uint32_t convert(const int8_t* input, uint32_t input_frames,
+                     int8_t* output, uint32_t output_stride);
+
+    /// \brief Forgets the past samples, to start a new stream
+    void reset();
+
+private:
+
+    /// \brief Fills mFilter with the low-pass filter for mStep
+    void makeFilter();
+
+    static const int FilterZeros = 32; ///< Zero crossings of the sinc on each side
+    static const int FilterPhases = 128; ///< Tabulated positions between two peer samples
+    static const double FilterCutoff; ///< Cutoff, relative to the local Nyquist frequency
+
+    static const sample_t sMaxSample; ///< Largest sample the 16 bit conversion can hold
+
+    int mNumChannels; ///< Number of channels
+    AudioInterface::audioBitResolutionT mSourceResolution; ///< Peer bit resolution
+    AudioInterface::audioBitResolutionT mTargetResolution; ///< Local bit resolution
+    double mStep; ///< Peer samples for each local sample
+    double mPosition; ///< Position of the next local sample, in peer samples of the next input
+    int mLookBack; ///< Peer samples before the position that a local sample needs
+    int mLookAhead; ///< Peer samples after the position that a local sample needs
+    int mHistorySize; ///< Past peer samples kept for the interpolation, mLookBack + mLookAhead
+    int mTaps; ///< Filter coefficients for each phase, 0 for the spline
+    QVector<sample_t> mFilter; ///< FilterPhases + 1 rows of mTaps coefficients
+    QVector<sample_t> mHistory; ///< Last mHistorySize peer samples of each channel
+    QVector<sample_t> mSamples; ///< History and decoded input of one channel
+};
+
+#endif //__AUDIOCONVERTER_H__
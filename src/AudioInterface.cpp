@@ -39,6 +39,16 @@
 #include "JackTrip.h"
 #include <iostream>
 #include <cmath>
+#include <cstring>
+#include <algorithm>
+// The SSSE3, AVX2 and AVX-512 code is compiled for every x86 build and used only
+// if the processor has it
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__)
+#define AUDIO_X86
+#include <immintrin.h>
+#elif defined (__ARM_NEON) && defined (__aarch64__)
+#include <arm_neon.h>
+#endif
 
 using std::cout; using std::endl;
 
@@ -57,7 +67,14 @@ AudioInterface::AudioInterface(JackTrip* jacktrip,
     mAudioBitResolution(AudioBitResolution*8),
     mBitResolutionMode(AudioBitResolution),
     mSampleRate(gDefaultSampleRate), mBufferSizeInSamples(gDefaultBufferSizeInSamples),
-    mInputPacket(NULL), mOutputPacket(NULL)
+    mInputPacket(NULL), mOutputPacket(NULL),
+    mCaptureUsec(0),
+    mCodec(NULL),
+    mCodecInFill(0),
+    mCodecOutPos(0),
+    mCodecCaptureUsec(0),
+    mToNetwork(NULL),
+    mFromNetwork(NULL)
 {
 #ifndef WAIR
     //cc
@@ -187,6 +204,7 @@ void AudioInterface::setup()
     }
 #endif // endwhere
 
+    setupNetworkFunctions();
 }
 
 
@@ -202,6 +220,10 @@ void AudioInterface::callback(QVarLengthArray<sample_t*>& in_buffer,
                               QVarLengthArray<sample_t*>& out_buffer,
                               unsigned int n_frames)
 {
+    // The input period was captured during the last n_frames
+    mCaptureUsec = PacketHeader::steadyUsecTime()
+            - static_cast<uint64_t>(n_frames) * 1000000 / getSampleRate();
+
     // Allocate the Process Callback
     //-------------------------------------------------------------------
     // 1) First, process incoming packets
@@ -230,16 +252,18 @@ void AudioInterface::callback(QVarLengthArray<sample_t*>& in_buffer,
     /// do it chaining outputs to inputs in the buffers. May need a tempo buffer
 
 #ifndef WAIR // WAIR
-    for (int i = 0; i < mNumInChans; i++) {
-        std::memset(mInProcessBuffer[i], 0, sizeof(sample_t) * n_frames);
-        std::memcpy(mInProcessBuffer[i], out_buffer[i], sizeof(sample_t) * n_frames);
-    }
-    for (int i = 0; i < mNumOutChans; i++) {
-        std::memset(mOutProcessBuffer[i], 0, sizeof(sample_t) * n_frames);
-    }
+    // Without plugins, the input goes straight from the audio buffers to the packet
+    if (!mProcessPlugins.isEmpty()) {
+        for (int i = 0; i < mNumInChans; i++) {
+            std::memcpy(mInProcessBuffer[i], out_buffer[i], sizeof(sample_t) * n_frames);
+        }
+        for (int i = 0; i < mNumOutChans; i++) {
+            std::memset(mOutProcessBuffer[i], 0, sizeof(sample_t) * n_frames);
+        }
 
-    for (int i = 0; i < mProcessPlugins.size(); i++) {
-        mProcessPlugins[i]->compute(n_frames, mInProcessBuffer.data(), mOutProcessBuffer.data());
+        for (int i = 0; i < mProcessPlugins.size(); i++) {
+            mProcessPlugins[i]->compute(n_frames, mInProcessBuffer.data(), mOutProcessBuffer.data());
+        }
     }
 #else // WAIR
     for (int i = 0; i < ((mNumNetRevChans)?mNumNetRevChans:mNumOutChans); i++) {
@@ -318,23 +342,6 @@ void AudioInterface::callback(QVarLengthArray<sample_t*>& in_buffer,
         ///////////////////////////////////////////////////////////////////////////////
     }
 #endif // endwhere
-
-
-    ///************PROTORYPE FOR CELT**************************
-    ///********************************************************
-    /*
-  CELTMode* mode;
-  int* error;
-  mode = celt_mode_create(48000, 2, 64, error);
-  */
-    //celt_mode_create(48000, 2, 64, NULL);
-    //unsigned char* compressed;
-    //CELTEncoder* celtEncoder;
-    //celt_encode_float(celtEncoder, mInBuffer, NULL, compressed, );
-
-    ///********************************************************
-    ///********************************************************
-
 }
 
 
@@ -345,6 +352,11 @@ void AudioInterface::callback(QVarLengthArray<sample_t*>& in_buffer,
 void AudioInterface::computeProcessFromNetwork(QVarLengthArray<sample_t*>& out_buffer,
                                                unsigned int n_frames)
 {
+    if (mCodec != NULL) {
+        computeCodecFromNetwork(out_buffer, n_frames);
+        return;
+    }
+
     /// \todo cast *mInBuffer[i] to the bit resolution
     // Output Process (from NETWORK to JACK)
     // ----------------------------------------------------------------
@@ -355,32 +367,15 @@ void AudioInterface::computeProcessFromNetwork(QVarLengthArray<sample_t*>& out_b
     if (mNumNetRevChans)
         // Extract separate channels
         for (int i = 0; i < mNumNetRevChans; i++) {
-            sample_t* tmp_sample = mNetInBuffer[i]; //sample buffer for channel i
-            for (unsigned int j = 0; j < n_frames; j++) {
-                // Change the bit resolution on each sample
-                fromBitToSampleConversion(
-                            &mOutputPacket[(i*mSizeInBytesPerChannel) + (j*mBitResolutionMode)],
-                        &tmp_sample[j], mBitResolutionMode );
-            }
+            // Change the bit resolution of the whole channel
+            fromBitToSampleConversion(&mOutputPacket[i*mSizeInBytesPerChannel],
+                                      mNetInBuffer[i], n_frames, mBitResolutionMode );
         }
     else // not wair
 #endif // endwhere
 
         // Extract separate channels to send to Jack
-        for (int i = 0; i < mNumOutChans; i++) {
-            //--------
-            // This should be faster for 32 bits
-            //std::memcpy(mOutBuffer[i], &mOutputPacket[i*mSizeInBytesPerChannel],
-            //		mSizeInBytesPerChannel);
-            //--------
-            sample_t* tmp_sample = out_buffer[i]; //sample buffer for channel i
-            for (unsigned int j = 0; j < n_frames; j++) {
-                // Change the bit resolution on each sample
-                fromBitToSampleConversion(
-                            &mOutputPacket[(i*mSizeInBytesPerChannel) + (j*mBitResolutionMode)],
-                        &tmp_sample[j], mBitResolutionMode );
-            }
-        }
+        mFromNetwork(mOutputPacket, out_buffer.data(), n_frames, mNumOutChans, mSizeInBytesPerChannel);
 }
 
 
@@ -388,6 +383,11 @@ void AudioInterface::computeProcessFromNetwork(QVarLengthArray<sample_t*>& out_b
 void AudioInterface::computeProcessToNetwork(QVarLengthArray<sample_t*>& in_buffer,
                                              unsigned int n_frames)
 {
+    if (mCodec != NULL) {
+        computeCodecToNetwork(in_buffer, n_frames);
+        return;
+    }
+
     // Input Process (from JACK to NETWORK)
     // ----------------------------------------------------------------
     // Concatenate  all the channels from jack to form packet
@@ -413,33 +413,387 @@ void AudioInterface::computeProcessToNetwork(QVarLengthArray<sample_t*>& in_buff
     else // not wair
 #endif // endwhere
 
+        mToNetwork(in_buffer.data(), mProcessPlugins.isEmpty() ? NULL : mOutProcessBuffer.data(),
+                   mInputPacket, n_frames, mNumInChans, mSizeInBytesPerChannel);
+    // Send Audio buffer to Network
+    mJackTrip->sendNetworkPacket( mInputPacket, mCaptureUsec );
+}
+
+
+//*******************************************************************************
+void AudioInterface::setCodec(AudioCodec* codec)
+{
+    mCodec = codec;
+    mCodecInFill = 0;
+    if (mCodec == NULL) { return; }
+    int frames = mCodec->getFrames();
+    mCodecSamples.resize( (mNumInChans + mNumOutChans) * frames );
+    mCodecSamples.fill(0);
+    mCodecInBuffer.resize(mNumInChans);
+    mCodecOutBuffer.resize(mNumOutChans);
+    for (int i = 0; i < mNumInChans; i++) {
+        mCodecInBuffer[i] = mCodecSamples.data() + i * frames;
+    }
+    for (int i = 0; i < mNumOutChans; i++) {
+        mCodecOutBuffer[i] = mCodecSamples.data() + (mNumInChans + i) * frames;
+    }
+    // The first period decodes a packet
+    mCodecOutPos = frames;
+    mCodecPacket.resize(mCodec->getPacketSize());
+}
+
+
+//*******************************************************************************
+// The codec frames don't have to match the audio periods: a period can
+// complete several packets, or none
+void AudioInterface::computeCodecFromNetwork(QVarLengthArray<sample_t*>& out_buffer,
+                                             unsigned int n_frames)
+{
+    unsigned int frames = mCodec->getFrames();
+    unsigned int done = 0;
+    while (done < n_frames) {
+        if (static_cast<unsigned int>(mCodecOutPos) == frames) {
+            // The codec conceals the packets that aren't there in time
+            if ( mJackTrip->receiveNetworkPacket(mCodecPacket.data()) ) {
+                mCodec->decode(mCodecPacket.data(), mCodecOutBuffer.data());
+            } else {
+                mCodec->conceal(mCodecOutBuffer.data());
+            }
+            mCodecOutPos = 0;
+        }
+        unsigned int n = std::min(n_frames - done, frames - mCodecOutPos);
+        for (int i = 0; i < mNumOutChans; i++) {
+            std::memcpy(out_buffer[i] + done, mCodecOutBuffer[i] + mCodecOutPos,
+                        sizeof(sample_t) * n);
+        }
+        done += n;
+        mCodecOutPos += n;
+    }
+}
+
+
+//*******************************************************************************
+void AudioInterface::computeCodecToNetwork(QVarLengthArray<sample_t*>& in_buffer,
+                                           unsigned int n_frames)
+{
+    unsigned int frames = mCodec->getFrames();
+    unsigned int done = 0;
+    while (done < n_frames) {
+        if (mCodecInFill == 0) {
+            mCodecCaptureUsec = mCaptureUsec + static_cast<uint64_t>(done) * 1000000 / getSampleRate();
+        }
+        unsigned int n = std::min(n_frames - done, frames - mCodecInFill);
         for (int i = 0; i < mNumInChans; i++) {
-            //--------
-            // This should be faster for 32 bits
-            //std::memcpy(&mInputPacket[i*mSizeInBytesPerChannel], mInBuffer[i],
-            //		mSizeInBytesPerChannel);
-            //--------
-            sample_t* tmp_sample = in_buffer[i]; //sample buffer for channel i
-            sample_t* tmp_process_sample = mOutProcessBuffer[i]; //sample buffer from the output process
-            sample_t tmp_result;
-            for (unsigned int j = 0; j < n_frames; j++) {
-                // Change the bit resolution on each sample
-                // Add the input jack buffer to the buffer resulting from the output process
-                tmp_result = tmp_sample[j] + tmp_process_sample[j];
-                fromSampleToBitConversion(
-                            &tmp_result,
-                            &mInputPacket[(i*mSizeInBytesPerChannel) + (j*mBitResolutionMode)],
-                        mBitResolutionMode );
+            // Add the input jack buffer to the buffer resulting from the output process
+            sample_t* tmp_sample = in_buffer[i] + done;
+            sample_t* codec_sample = mCodecInBuffer[i] + mCodecInFill;
+            if (mProcessPlugins.isEmpty()) {
+                std::memcpy(codec_sample, tmp_sample, sizeof(sample_t) * n);
+                continue;
+            }
+            sample_t* tmp_process_sample = mOutProcessBuffer[i] + done;
+            for (unsigned int j = 0; j < n; j++) {
+                codec_sample[j] = tmp_sample[j] + tmp_process_sample[j];
             }
         }
-    // Send Audio buffer to Network
-    mJackTrip->sendNetworkPacket( mInputPacket );
+        done += n;
+        mCodecInFill += n;
+        if (static_cast<unsigned int>(mCodecInFill) == frames) {
+            mCodec->encode(mCodecInBuffer.data(), mCodecPacket.data());
+            mJackTrip->sendNetworkPacket( mCodecPacket.data(), mCodecCaptureUsec );
+            mCodecInFill = 0;
+        }
+    }
+}
+
+
+//*******************************************************************************
+// Saturated floor(sample * scale): the integer of the fixed point formats. Out of
+// range samples clip instead of wrapping around, and NaN gives the lowest value,
+// like the SIMD kernels below.
+static inline int32_t quantizeSample(sample_t sample, float scale, float low, float high)
+{
+    float value = std::max(low, sample * scale);
+    value = std::min(high, value);
+    return static_cast<int32_t>(std::floor(value));
+}
+
+static const float sScale8 = 128.0f; // 2^7
+static const float sScale16 = 32768.0f; // 2^15
+static const float sScale24 = 8388608.0f; // 2^23
+
+#if defined (AUDIO_X86)
+// Four samples of quantizeSample(), for the SSSE3 kernels too when SSE2 is not
+// the baseline
+__attribute__((target("sse2")))
+static inline __m128i quantizeSamples(const sample_t* input, __m128 scale, __m128 low, __m128 high)
+{
+    __m128 value = _mm_max_ps(_mm_mul_ps(_mm_loadu_ps(input), scale), low);
+    value = _mm_min_ps(value, high);
+    // The conversion truncates, floor takes one off the negative values it rounded up
+    __m128i truncated = _mm_cvttps_epi32(value);
+    __m128 rounded_up = _mm_cmpgt_ps(_mm_cvtepi32_ps(truncated), value);
+    return _mm_add_epi32(truncated, _mm_castps_si128(rounded_up));
+}
+#endif
+
+#if defined (__SSE2__)
+// Sign extends the 8 low or high int16 of a vector to int32
+static inline __m128i extendLow16(__m128i value)
+{ return _mm_srai_epi32(_mm_unpacklo_epi16(value, value), 16); }
+static inline __m128i extendHigh16(__m128i value)
+{ return _mm_srai_epi32(_mm_unpackhi_epi16(value, value), 16); }
+#elif defined (__ARM_NEON) && defined (__aarch64__)
+// Four samples of quantizeSample()
+static inline int32x4_t quantizeSamples(const sample_t* input, float32x4_t scale,
+                                        float32x4_t low, float32x4_t high)
+{
+    float32x4_t value = vmulq_f32(vld1q_f32(input), scale);
+    value = vbslq_f32(vcgtq_f32(value, low), value, low);
+    value = vbslq_f32(vcltq_f32(value, high), value, high);
+    return vcvtmq_s32_f32(value);
 }
+#endif
 
 
+#if defined (AUDIO_X86)
 //*******************************************************************************
-// This function quantize from 32 bit to a lower bit resolution
-// 24 bit is not working yet
+// Widest kernels the processor can run, checked once. Below them are the SSE2
+// kernels (every x86-64 has SSE2) and the scalar code.
+enum { SIMD_BASE, SIMD_SSSE3, SIMD_AVX2, SIMD_AVX512 };
+
+static int detectSimdLevel()
+{
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports("avx512f") ) { return SIMD_AVX512; }
+    if ( __builtin_cpu_supports("avx2") ) { return SIMD_AVX2; }
+    if ( __builtin_cpu_supports("ssse3") ) { return SIMD_SSSE3; }
+    return SIMD_BASE;
+}
+
+static const int sMaxSimdLevel = detectSimdLevel();
+// Lowered by the tests only, see AudioInterface::setSimdLevel()
+static int sSimdLevel = sMaxSimdLevel;
+
+// The kernels convert as many samples as their vectors allow and return how
+// many, the rest is left to the caller. They give the same bits as
+// quantizeSample() and the scalar conversions.
+
+// Bytes 1 and 2 (the 16bit number), then byte 0 (the remainder) of 4 samples
+#define PACK_24 1, 2, 0, 5, 6, 4, 9, 10, 8, 13, 14, 12, -1, -1, -1, -1
+// 4 samples of 3 bytes to the 16bit number in the high bytes and the remainder
+// under it: the sample times 2^8
+#define UNPACK_24 -1, 2, 0, 1, -1, 5, 3, 4, -1, 8, 6, 7, -1, 11, 9, 10
+
+__attribute__((target("ssse3")))
+static unsigned int samplesToBits24Ssse3(const sample_t* input, int8_t* output, unsigned int n_samples)
+{
+    const __m128 scale = _mm_set1_ps(sScale24);
+    const __m128 low = _mm_set1_ps(-8388608.0f);
+    const __m128 high = _mm_set1_ps(8388607.0f);
+    const __m128i pack = _mm_setr_epi8(PACK_24);
+    unsigned int n = 0;
+    for (; n + 4 <= n_samples; n += 4) {
+        __m128i packed = _mm_shuffle_epi8(quantizeSamples(input + n, scale, low, high), pack);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(output + 3 * n), packed);
+        int32_t last = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+        std::memcpy(output + 3 * n + 8, &last, 4);
+    }
+    return n;
+}
+
+__attribute__((target("ssse3")))
+static unsigned int bitsToSamples24Ssse3(const int8_t* input, sample_t* output, unsigned int n_samples)
+{
+    const __m128 scale = _mm_set1_ps(1.0f / sScale24);
+    const __m128i unpack = _mm_setr_epi8(UNPACK_24);
+    unsigned int n = 0;
+    // (16 bytes are read for 12)
+    for (; 3 * n + 16 <= 3 * n_samples; n += 4) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 3 * n));
+        __m128i samples = _mm_srai_epi32(_mm_shuffle_epi8(bytes, unpack), 8);
+        _mm_storeu_ps(output + n, _mm_mul_ps(_mm_cvtepi32_ps(samples), scale));
+    }
+    return n;
+}
+
+// Eight samples of quantizeSample()
+__attribute__((target("avx2")))
+static inline __m256i quantizeSamplesAvx2(const sample_t* input, __m256 scale, __m256 low, __m256 high)
+{
+    __m256 value = _mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(input), scale), low);
+    value = _mm256_min_ps(value, high);
+    return _mm256_cvtps_epi32(_mm256_floor_ps(value));
+}
+
+__attribute__((target("avx2")))
+static unsigned int samplesToBits8Avx2(const sample_t* input, int8_t* output, unsigned int n_samples)
+{
+    const __m256 scale = _mm256_set1_ps(sScale8);
+    const __m256 low = _mm256_set1_ps(-128.0f);
+    const __m256 high = _mm256_set1_ps(127.0f);
+    // The packs work in each 128 bit lane, this puts the groups of 4 back in order
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    unsigned int n = 0;
+    for (; n + 32 <= n_samples; n += 32) {
+        __m256i a = _mm256_packs_epi32(quantizeSamplesAvx2(input + n, scale, low, high),
+                                       quantizeSamplesAvx2(input + n + 8, scale, low, high));
+        __m256i b = _mm256_packs_epi32(quantizeSamplesAvx2(input + n + 16, scale, low, high),
+                                       quantizeSamplesAvx2(input + n + 24, scale, low, high));
+        __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(a, b), order);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + n), bytes);
+    }
+    return n;
+}
+
+__attribute__((target("avx2")))
+static unsigned int samplesToBits16Avx2(const sample_t* input, int8_t* output, unsigned int n_samples)
+{
+    const __m256 scale = _mm256_set1_ps(sScale16);
+    const __m256 low = _mm256_set1_ps(-32768.0f);
+    const __m256 high = _mm256_set1_ps(32767.0f);
+    unsigned int n = 0;
+    for (; n + 16 <= n_samples; n += 16) {
+        __m256i a = _mm256_packs_epi32(quantizeSamplesAvx2(input + n, scale, low, high),
+                                       quantizeSamplesAvx2(input + n + 8, scale, low, high));
+        // The pack works in each 128 bit lane, this puts the groups of 4 back in order
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + 2 * n),
+                            _mm256_permute4x64_epi64(a, 0xD8));
+    }
+    return n;
+}
+
+__attribute__((target("avx2")))
+static unsigned int samplesToBits24Avx2(const sample_t* input, int8_t* output, unsigned int n_samples)
+{
+    const __m256 scale = _mm256_set1_ps(sScale24);
+    const __m256 low = _mm256_set1_ps(-8388608.0f);
+    const __m256 high = _mm256_set1_ps(8388607.0f);
+    const __m256i pack = _mm256_setr_epi8(PACK_24, PACK_24);
+    // The 12 bytes of each lane, back to back
+    const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+    unsigned int n = 0;
+    for (; n + 8 <= n_samples; n += 8) {
+        __m256i packed = _mm256_shuffle_epi8(quantizeSamplesAvx2(input + n, scale, low, high), pack);
+        packed = _mm256_permutevar8x32_epi32(packed, join);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 3 * n), _mm256_castsi256_si128(packed));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(output + 3 * n + 16),
+                         _mm256_extracti128_si256(packed, 1));
+    }
+    return n;
+}
+
+__attribute__((target("avx2")))
+static unsigned int bitsToSamples8Avx2(const int8_t* input, sample_t* output, unsigned int n_samples)
+{
+    const __m256 scale = _mm256_set1_ps(1.0f / sScale8);
+    unsigned int n = 0;
+    for (; n + 8 <= n_samples; n += 8) {
+        __m256i samples = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(input + n)));
+        _mm256_storeu_ps(output + n, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale));
+    }
+    return n;
+}
+
+__attribute__((target("avx2")))
+static unsigned int bitsToSamples16Avx2(const int8_t* input, sample_t* output, unsigned int n_samples)
+{
+    const __m256 scale = _mm256_set1_ps(1.0f / sScale16);
+    unsigned int n = 0;
+    for (; n + 8 <= n_samples; n += 8) {
+        __m256i samples = _mm256_cvtepi16_epi32(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 2 * n)));
+        _mm256_storeu_ps(output + n, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale));
+    }
+    return n;
+}
+
+__attribute__((target("avx2")))
+static unsigned int bitsToSamples24Avx2(const int8_t* input, sample_t* output, unsigned int n_samples)
+{
+    const __m256 scale = _mm256_set1_ps(1.0f / sScale24);
+    const __m256i unpack = _mm256_setr_epi8(UNPACK_24, UNPACK_24);
+    // Bytes 0 to 15 in the low lane, 12 to 27 in the high one
+    const __m256i split = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+    unsigned int n = 0;
+    // (32 bytes are read for 24)
+    for (; 3 * n + 32 <= 3 * n_samples; n += 8) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + 3 * n));
+        bytes = _mm256_permutevar8x32_epi32(bytes, split);
+        __m256i samples = _mm256_srai_epi32(_mm256_shuffle_epi8(bytes, unpack), 8);
+        _mm256_storeu_ps(output + n, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale));
+    }
+    return n;
+}
+
+// Sixteen samples of quantizeSample(), the conversion rounds down itself
+__attribute__((target("avx512f")))
+static inline __m512i quantizeSamplesAvx512(const sample_t* input, __m512 scale, __m512 low, __m512 high)
+{
+    __m512 value = _mm512_max_ps(_mm512_mul_ps(_mm512_loadu_ps(input), scale), low);
+    value = _mm512_min_ps(value, high);
+    return _mm512_cvt_roundps_epi32(value, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+}
+
+__attribute__((target("avx512f")))
+static unsigned int samplesToBits8Avx512(const sample_t* input, int8_t* output, unsigned int n_samples)
+{
+    const __m512 scale = _mm512_set1_ps(sScale8);
+    const __m512 low = _mm512_set1_ps(-128.0f);
+    const __m512 high = _mm512_set1_ps(127.0f);
+    unsigned int n = 0;
+    for (; n + 16 <= n_samples; n += 16) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + n),
+                         _mm512_cvtsepi32_epi8(quantizeSamplesAvx512(input + n, scale, low, high)));
+    }
+    return n;
+}
+
+__attribute__((target("avx512f")))
+static unsigned int samplesToBits16Avx512(const sample_t* input, int8_t* output, unsigned int n_samples)
+{
+    const __m512 scale = _mm512_set1_ps(sScale16);
+    const __m512 low = _mm512_set1_ps(-32768.0f);
+    const __m512 high = _mm512_set1_ps(32767.0f);
+    unsigned int n = 0;
+    for (; n + 16 <= n_samples; n += 16) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + 2 * n),
+                            _mm512_cvtsepi32_epi16(quantizeSamplesAvx512(input + n, scale, low, high)));
+    }
+    return n;
+}
+
+__attribute__((target("avx512f")))
+static unsigned int bitsToSamples8Avx512(const int8_t* input, sample_t* output, unsigned int n_samples)
+{
+    const __m512 scale = _mm512_set1_ps(1.0f / sScale8);
+    unsigned int n = 0;
+    for (; n + 16 <= n_samples; n += 16) {
+        __m512i samples = _mm512_cvtepi8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + n)));
+        _mm512_storeu_ps(output + n, _mm512_mul_ps(_mm512_cvtepi32_ps(samples), scale));
+    }
+    return n;
+}
+
+__attribute__((target("avx512f")))
+static unsigned int bitsToSamples16Avx512(const int8_t* input, sample_t* output, unsigned int n_samples)
+{
+    const __m512 scale = _mm512_set1_ps(1.0f / sScale16);
+    unsigned int n = 0;
+    for (; n + 16 <= n_samples; n += 16) {
+        __m512i samples = _mm512_cvtepi16_epi32(
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + 2 * n)));
+        _mm512_storeu_ps(output + n, _mm512_mul_ps(_mm512_cvtepi32_ps(samples), scale));
+    }
+    return n;
+}
+#endif
+
+
+//*******************************************************************************
+// This function quantize from 32 bit to a lower bit resolution. The 24 bit format
+// is the 16 bit sample followed by the 8 bits of the remainder (unsigned), which
+// is floor(sample * 2^23) on 3 bytes.
 void AudioInterface::fromSampleToBitConversion
 (const sample_t* const input,
  int8_t* output,
@@ -448,37 +802,24 @@ void AudioInterface::fromSampleToBitConversion
     int8_t tmp_8;
     uint8_t tmp_u8; // unsigned to quantize the remainder in 24bits
     int16_t tmp_16;
-    sample_t tmp_sample;
-    sample_t tmp_sample16;
-    sample_t tmp_sample8;
+    int32_t tmp_24;
     switch (targetBitResolution)
     {
     case BIT8 :
         // 8bit integer between -128 to 127
-        tmp_sample = floor( (*input) * 128.0 ); // 2^7 = 128.0
-        tmp_8 = static_cast<int8_t>(tmp_sample);
+        tmp_8 = static_cast<int8_t>(quantizeSample(*input, sScale8, -128.0f, 127.0f));
         std::memcpy(output, &tmp_8, 1); // 8bits = 1 bytes
         break;
     case BIT16 :
         // 16bit integer between -32768 to 32767
-        tmp_sample = floor( (*input) * 32768.0 ); // 2^15 = 32768.0
-        tmp_16 = static_cast<int16_t>(tmp_sample);
+        tmp_16 = static_cast<int16_t>(quantizeSample(*input, sScale16, -32768.0f, 32767.0f));
         std::memcpy(output, &tmp_16, 2); // 16bits = 2 bytes
         break;
     case BIT24 :
-        // To convert to 24 bits, we first quantize the number to 16bit
-        tmp_sample = (*input) * 32768.0; // 2^15 = 32768.0
-        tmp_sample16 = floor(tmp_sample);
-        tmp_16 = static_cast<int16_t>(tmp_sample16);
-
-        // Then we compute the remainder error, and quantize that part into an 8bit number
-        // Note that this remainder is always positive, so we use an unsigned integer
-        tmp_sample8 = floor ((tmp_sample - tmp_sample16)  //this is a positive number, between 0.0-1.0
-                             * 256.0);
-        tmp_u8 = static_cast<uint8_t>(tmp_sample8);
-
-        // Finally, we copy the 16bit number in the first 2 bytes,
-        // and the 8bit number in the third bite
+        // 24bit integer, split in the 16bit number and the remainder
+        tmp_24 = quantizeSample(*input, sScale24, -8388608.0f, 8388607.0f);
+        tmp_16 = static_cast<int16_t>(tmp_24 >> 8);
+        tmp_u8 = static_cast<uint8_t>(tmp_24 & 0xFF);
         std::memcpy(output, &tmp_16, 2); // 16bits = 2 bytes
         std::memcpy(output+2, &tmp_u8, 1); // 8bits = 1 bytes
         break;
@@ -499,29 +840,25 @@ void AudioInterface::fromBitToSampleConversion
     uint8_t tmp_u8;
     int16_t tmp_16;
     sample_t tmp_sample;
-    sample_t tmp_sample16;
-    sample_t tmp_sample8;
     switch (sourceBitResolution)
     {
     case BIT8 :
         tmp_8 = *input;
-        tmp_sample = static_cast<sample_t>(tmp_8) / 128.0;
+        tmp_sample = static_cast<sample_t>(tmp_8) * (1.0f / sScale8);
         std::memcpy(output, &tmp_sample, 4); // 4 bytes
         break;
     case BIT16 :
-        tmp_16 = *( reinterpret_cast<const int16_t*>(input) ); // *((int16_t*) input);
-        tmp_sample = static_cast<sample_t>(tmp_16) / 32768.0;
+        std::memcpy(&tmp_16, input, 2);
+        tmp_sample = static_cast<sample_t>(tmp_16) * (1.0f / sScale16);
         std::memcpy(output, &tmp_sample, 4); // 4 bytes
         break;
     case BIT24 :
         // We first extract the 16bit and 8bit number from the 3 bytes
-        tmp_16 = *( reinterpret_cast<const int16_t*>(input) );
+        std::memcpy(&tmp_16, input, 2);
         tmp_u8 = *( reinterpret_cast<const uint8_t*>(input+2) );
 
-        // Then we recover the number
-        tmp_sample16 = static_cast<sample_t>(tmp_16);
-        tmp_sample8 = static_cast<sample_t>(tmp_u8) / 256.0;
-        tmp_sample =  (tmp_sample16 +  tmp_sample8) / 32768.0;
+        // Then we recover the number (exact, 24 bits fit in a float)
+        tmp_sample = static_cast<sample_t>(tmp_16 * 256 + tmp_u8) * (1.0f / sScale24);
         std::memcpy(output, &tmp_sample, 4); // 4 bytes
         break;
     case BIT32 :
@@ -531,6 +868,408 @@ void AudioInterface::fromBitToSampleConversion
 }
 
 
+//*******************************************************************************
+// Kernels of the buffer conversions, one for each bit resolution so the callback
+// (see ToNetworkFunction) can call them without a switch
+template <AudioInterface::audioBitResolutionT Resolution>
+static void samplesToBits(const sample_t* input, int8_t* output, unsigned int n_samples);
+template <AudioInterface::audioBitResolutionT Resolution>
+static void bitsToSamples(const int8_t* input, sample_t* output, unsigned int n_samples);
+
+template <>
+void samplesToBits<AudioInterface::BIT8>(const sample_t* input, int8_t* output, unsigned int n_samples)
+{
+    unsigned int n = 0;
+#if defined (AUDIO_X86)
+    if (sSimdLevel >= SIMD_AVX512) { n = samplesToBits8Avx512(input, output, n_samples); }
+    else if (sSimdLevel >= SIMD_AVX2) { n = samplesToBits8Avx2(input, output, n_samples); }
+#endif
+#if defined (__SSE2__)
+    const __m128 scale = _mm_set1_ps(sScale8);
+    const __m128 low = _mm_set1_ps(-128.0f);
+    const __m128 high = _mm_set1_ps(127.0f);
+    for (; n + 16 <= n_samples; n += 16) {
+        __m128i a = _mm_packs_epi32(quantizeSamples(input + n, scale, low, high),
+                                    quantizeSamples(input + n + 4, scale, low, high));
+        __m128i b = _mm_packs_epi32(quantizeSamples(input + n + 8, scale, low, high),
+                                    quantizeSamples(input + n + 12, scale, low, high));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + n), _mm_packs_epi16(a, b));
+    }
+#elif defined (__ARM_NEON) && defined (__aarch64__)
+    const float32x4_t scale = vdupq_n_f32(sScale8);
+    const float32x4_t low = vdupq_n_f32(-128.0f);
+    const float32x4_t high = vdupq_n_f32(127.0f);
+    for (; n + 8 <= n_samples; n += 8) {
+        int16x8_t a = vcombine_s16(vqmovn_s32(quantizeSamples(input + n, scale, low, high)),
+                                   vqmovn_s32(quantizeSamples(input + n + 4, scale, low, high)));
+        vst1_s8(output + n, vqmovn_s16(a));
+    }
+#endif
+    for (; n < n_samples; n++) {
+        output[n] = static_cast<int8_t>(quantizeSample(input[n], sScale8, -128.0f, 127.0f));
+    }
+}
+
+template <>
+void samplesToBits<AudioInterface::BIT16>(const sample_t* input, int8_t* output, unsigned int n_samples)
+{
+    unsigned int n = 0;
+    int16_t tmp_16;
+#if defined (AUDIO_X86)
+    if (sSimdLevel >= SIMD_AVX512) { n = samplesToBits16Avx512(input, output, n_samples); }
+    else if (sSimdLevel >= SIMD_AVX2) { n = samplesToBits16Avx2(input, output, n_samples); }
+#endif
+#if defined (__SSE2__)
+    const __m128 scale = _mm_set1_ps(sScale16);
+    const __m128 low = _mm_set1_ps(-32768.0f);
+    const __m128 high = _mm_set1_ps(32767.0f);
+    for (; n + 8 <= n_samples; n += 8) {
+        __m128i a = _mm_packs_epi32(quantizeSamples(input + n, scale, low, high),
+                                    quantizeSamples(input + n + 4, scale, low, high));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + 2 * n), a);
+    }
+#elif defined (__ARM_NEON) && defined (__aarch64__)
+    const float32x4_t scale = vdupq_n_f32(sScale16);
+    const float32x4_t low = vdupq_n_f32(-32768.0f);
+    const float32x4_t high = vdupq_n_f32(32767.0f);
+    for (; n + 8 <= n_samples; n += 8) {
+        int16x8_t a = vcombine_s16(vqmovn_s32(quantizeSamples(input + n, scale, low, high)),
+                                   vqmovn_s32(quantizeSamples(input + n + 4, scale, low, high)));
+        vst1q_s8(output + 2 * n, vreinterpretq_s8_s16(a));
+    }
+#endif
+    for (; n < n_samples; n++) {
+        tmp_16 = static_cast<int16_t>(quantizeSample(input[n], sScale16, -32768.0f, 32767.0f));
+        std::memcpy(output + 2 * n, &tmp_16, 2);
+    }
+}
+
+template <>
+void samplesToBits<AudioInterface::BIT24>(const sample_t* input, int8_t* output, unsigned int n_samples)
+{
+    unsigned int n = 0;
+    int32_t tmp_24[8];
+#if defined (AUDIO_X86)
+    if (sSimdLevel >= SIMD_AVX2) { n = samplesToBits24Avx2(input, output, n_samples); }
+    else if (sSimdLevel >= SIMD_SSSE3) { n = samplesToBits24Ssse3(input, output, n_samples); }
+#endif
+#if defined (__SSE2__)
+    const __m128 scale = _mm_set1_ps(sScale24);
+    const __m128 low = _mm_set1_ps(-8388608.0f);
+    const __m128 high = _mm_set1_ps(8388607.0f);
+    for (; n + 4 <= n_samples; n += 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(tmp_24),
+                         quantizeSamples(input + n, scale, low, high));
+        for (int k = 0; k < 4; k++) {
+            int16_t tmp_16 = static_cast<int16_t>(tmp_24[k] >> 8);
+            std::memcpy(output + 3 * (n + k), &tmp_16, 2);
+            output[3 * (n + k) + 2] = static_cast<int8_t>(tmp_24[k] & 0xFF);
+        }
+    }
+#elif defined (__ARM_NEON) && defined (__aarch64__)
+    const float32x4_t scale = vdupq_n_f32(sScale24);
+    const float32x4_t low = vdupq_n_f32(-8388608.0f);
+    const float32x4_t high = vdupq_n_f32(8388607.0f);
+    for (; n + 8 <= n_samples; n += 8) {
+        int32x4_t a = quantizeSamples(input + n, scale, low, high);
+        int32x4_t b = quantizeSamples(input + n + 4, scale, low, high);
+        uint16x8_t sample16 = vreinterpretq_u16_s16(vcombine_s16(vshrn_n_s32(a, 8), vshrn_n_s32(b, 8)));
+        uint16x8_t remainder = vcombine_u16(vmovn_u32(vreinterpretq_u32_s32(a)),
+                                            vmovn_u32(vreinterpretq_u32_s32(b)));
+        uint8x8x3_t bytes;
+        bytes.val[0] = vmovn_u16(sample16);
+        bytes.val[1] = vshrn_n_u16(sample16, 8);
+        bytes.val[2] = vmovn_u16(remainder);
+        vst3_u8(reinterpret_cast<uint8_t*>(output + 3 * n), bytes);
+    }
+#endif
+    for (; n < n_samples; n++) {
+        tmp_24[0] = quantizeSample(input[n], sScale24, -8388608.0f, 8388607.0f);
+        int16_t tmp_16 = static_cast<int16_t>(tmp_24[0] >> 8);
+        std::memcpy(output + 3 * n, &tmp_16, 2);
+        output[3 * n + 2] = static_cast<int8_t>(tmp_24[0] & 0xFF);
+    }
+}
+
+template <>
+void samplesToBits<AudioInterface::BIT32>(const sample_t* input, int8_t* output, unsigned int n_samples)
+{
+    std::memcpy(output, input, 4 * n_samples);
+}
+
+template <>
+void bitsToSamples<AudioInterface::BIT8>(const int8_t* input, sample_t* output, unsigned int n_samples)
+{
+    unsigned int n = 0;
+#if defined (AUDIO_X86)
+    if (sSimdLevel >= SIMD_AVX512) { n = bitsToSamples8Avx512(input, output, n_samples); }
+    else if (sSimdLevel >= SIMD_AVX2) { n = bitsToSamples8Avx2(input, output, n_samples); }
+#endif
+#if defined (__SSE2__)
+    const __m128 scale = _mm_set1_ps(1.0f / sScale8);
+    for (; n + 16 <= n_samples; n += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + n));
+        // Sign extended to int16, in the high byte and shifted down
+        __m128i a = _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8);
+        __m128i b = _mm_srai_epi16(_mm_unpackhi_epi8(bytes, bytes), 8);
+        _mm_storeu_ps(output + n, _mm_mul_ps(_mm_cvtepi32_ps(extendLow16(a)), scale));
+        _mm_storeu_ps(output + n + 4, _mm_mul_ps(_mm_cvtepi32_ps(extendHigh16(a)), scale));
+        _mm_storeu_ps(output + n + 8, _mm_mul_ps(_mm_cvtepi32_ps(extendLow16(b)), scale));
+        _mm_storeu_ps(output + n + 12, _mm_mul_ps(_mm_cvtepi32_ps(extendHigh16(b)), scale));
+    }
+#elif defined (__ARM_NEON) && defined (__aarch64__)
+    const float32x4_t scale = vdupq_n_f32(1.0f / sScale8);
+    for (; n + 8 <= n_samples; n += 8) {
+        int16x8_t a = vmovl_s8(vld1_s8(input + n));
+        vst1q_f32(output + n, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(a))), scale));
+        vst1q_f32(output + n + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(a))), scale));
+    }
+#endif
+    for (; n < n_samples; n++) {
+        output[n] = static_cast<sample_t>(input[n]) * (1.0f / sScale8);
+    }
+}
+
+template <>
+void bitsToSamples<AudioInterface::BIT16>(const int8_t* input, sample_t* output, unsigned int n_samples)
+{
+    unsigned int n = 0;
+    int16_t tmp_16;
+#if defined (AUDIO_X86)
+    if (sSimdLevel >= SIMD_AVX512) { n = bitsToSamples16Avx512(input, output, n_samples); }
+    else if (sSimdLevel >= SIMD_AVX2) { n = bitsToSamples16Avx2(input, output, n_samples); }
+#endif
+#if defined (__SSE2__)
+    const __m128 scale = _mm_set1_ps(1.0f / sScale16);
+    for (; n + 8 <= n_samples; n += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 2 * n));
+        _mm_storeu_ps(output + n, _mm_mul_ps(_mm_cvtepi32_ps(extendLow16(a)), scale));
+        _mm_storeu_ps(output + n + 4, _mm_mul_ps(_mm_cvtepi32_ps(extendHigh16(a)), scale));
+    }
+#elif defined (__ARM_NEON) && defined (__aarch64__)
+    const float32x4_t scale = vdupq_n_f32(1.0f / sScale16);
+    for (; n + 8 <= n_samples; n += 8) {
+        int16x8_t a = vreinterpretq_s16_s8(vld1q_s8(input + 2 * n));
+        vst1q_f32(output + n, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(a))), scale));
+        vst1q_f32(output + n + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(a))), scale));
+    }
+#endif
+    for (; n < n_samples; n++) {
+        std::memcpy(&tmp_16, input + 2 * n, 2);
+        output[n] = static_cast<sample_t>(tmp_16) * (1.0f / sScale16);
+    }
+}
+
+template <>
+void bitsToSamples<AudioInterface::BIT24>(const int8_t* input, sample_t* output, unsigned int n_samples)
+{
+    unsigned int n = 0;
+    int16_t tmp_16;
+#if defined (AUDIO_X86)
+    // SSE2 has no byte shuffle, SSSE3 takes what AVX2 leaves
+    if (sSimdLevel >= SIMD_AVX2) { n = bitsToSamples24Avx2(input, output, n_samples); }
+    if (sSimdLevel >= SIMD_SSSE3) { n += bitsToSamples24Ssse3(input + 3 * n, output + n, n_samples - n); }
+#elif defined (__ARM_NEON) && defined (__aarch64__)
+    const float32x4_t scale = vdupq_n_f32(1.0f / sScale24);
+    for (; n + 8 <= n_samples; n += 8) {
+        uint8x8x3_t bytes = vld3_u8(reinterpret_cast<const uint8_t*>(input + 3 * n));
+        int16x8_t sample16 = vreinterpretq_s16_u16(
+                    vorrq_u16(vmovl_u8(bytes.val[0]), vshlq_n_u16(vmovl_u8(bytes.val[1]), 8)));
+        uint16x8_t remainder = vmovl_u8(bytes.val[2]);
+        int32x4_t a = vorrq_s32(vshlq_n_s32(vmovl_s16(vget_low_s16(sample16)), 8),
+                                vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(remainder))));
+        int32x4_t b = vorrq_s32(vshlq_n_s32(vmovl_s16(vget_high_s16(sample16)), 8),
+                                vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(remainder))));
+        vst1q_f32(output + n, vmulq_f32(vcvtq_f32_s32(a), scale));
+        vst1q_f32(output + n + 4, vmulq_f32(vcvtq_f32_s32(b), scale));
+    }
+#endif
+    for (; n < n_samples; n++) {
+        std::memcpy(&tmp_16, input + 3 * n, 2);
+        uint8_t tmp_u8 = static_cast<uint8_t>(input[3 * n + 2]);
+        output[n] = static_cast<sample_t>(tmp_16 * 256 + tmp_u8) * (1.0f / sScale24);
+    }
+}
+
+template <>
+void bitsToSamples<AudioInterface::BIT32>(const int8_t* input, sample_t* output, unsigned int n_samples)
+{
+    std::memcpy(output, input, 4 * n_samples);
+}
+
+
+//*******************************************************************************
+// The network side of the callback for a bit resolution and a number of channels
+// known at compile time, so the channel loop unrolls and the kernels inline.
+// Channels 0 is the generic version, for any number of channels.
+template <AudioInterface::audioBitResolutionT Resolution, int Channels>
+static void processToNetwork(sample_t* const* in_buffer, sample_t* const* process_buffer,
+                             int8_t* packet, unsigned int n_frames,
+                             int num_channels, size_t channel_size)
+{
+    const int channels = (Channels > 0) ? Channels : num_channels;
+    for (int i = 0; i < channels; i++) {
+        const sample_t* tmp_sample = in_buffer[i];
+        if (process_buffer == NULL) {
+            samplesToBits<Resolution>(tmp_sample, packet + i * channel_size, n_frames);
+            continue;
+        }
+        // Add the input jack buffer to the buffer resulting from the output process
+        // (cleared on the next period), then change the bit resolution of the whole channel
+        sample_t* tmp_process_sample = process_buffer[i];
+        for (unsigned int j = 0; j < n_frames; j++) {
+            tmp_process_sample[j] += tmp_sample[j];
+        }
+        samplesToBits<Resolution>(tmp_process_sample, packet + i * channel_size, n_frames);
+    }
+}
+
+template <AudioInterface::audioBitResolutionT Resolution, int Channels>
+static void processFromNetwork(const int8_t* packet, sample_t* const* out_buffer,
+                               unsigned int n_frames, int num_channels, size_t channel_size)
+{
+    const int channels = (Channels > 0) ? Channels : num_channels;
+    for (int i = 0; i < channels; i++) {
+        // Change the bit resolution of the whole channel (a copy for 32 bits)
+        bitsToSamples<Resolution>(packet + i * channel_size, out_buffer[i], n_frames);
+    }
+}
+
+template <AudioInterface::audioBitResolutionT Resolution>
+static void selectNetworkFunctions(int num_in_channels, int num_out_channels,
+                                   AudioInterface::ToNetworkFunction* to_network,
+                                   AudioInterface::FromNetworkFunction* from_network)
+{
+    switch (num_in_channels) {
+    case 1 : *to_network = &processToNetwork<Resolution, 1>; break;
+    case 2 : *to_network = &processToNetwork<Resolution, 2>; break;
+    case 4 : *to_network = &processToNetwork<Resolution, 4>; break;
+    case 8 : *to_network = &processToNetwork<Resolution, 8>; break;
+    default : *to_network = &processToNetwork<Resolution, 0>; break;
+    }
+    switch (num_out_channels) {
+    case 1 : *from_network = &processFromNetwork<Resolution, 1>; break;
+    case 2 : *from_network = &processFromNetwork<Resolution, 2>; break;
+    case 4 : *from_network = &processFromNetwork<Resolution, 4>; break;
+    case 8 : *from_network = &processFromNetwork<Resolution, 8>; break;
+    default : *from_network = &processFromNetwork<Resolution, 0>; break;
+    }
+}
+
+
+//*******************************************************************************
+void AudioInterface::setupNetworkFunctions()
+{
+    switch (mBitResolutionMode)
+    {
+    case BIT8 :
+        selectNetworkFunctions<BIT8>(mNumInChans, mNumOutChans, &mToNetwork, &mFromNetwork);
+        break;
+    case BIT16 :
+        selectNetworkFunctions<BIT16>(mNumInChans, mNumOutChans, &mToNetwork, &mFromNetwork);
+        break;
+    case BIT24 :
+        selectNetworkFunctions<BIT24>(mNumInChans, mNumOutChans, &mToNetwork, &mFromNetwork);
+        break;
+    case BIT32 :
+        selectNetworkFunctions<BIT32>(mNumInChans, mNumOutChans, &mToNetwork, &mFromNetwork);
+        break;
+    }
+}
+
+
+//*******************************************************************************
+void AudioInterface::fromSampleToBitConversion
+(const sample_t* const input,
+ int8_t* output,
+ unsigned int n_samples,
+ const AudioInterface::audioBitResolutionT targetBitResolution)
+{
+    switch (targetBitResolution)
+    {
+    case BIT8 :
+        samplesToBits<BIT8>(input, output, n_samples);
+        break;
+    case BIT16 :
+        samplesToBits<BIT16>(input, output, n_samples);
+        break;
+    case BIT24 :
+        samplesToBits<BIT24>(input, output, n_samples);
+        break;
+    case BIT32 :
+        samplesToBits<BIT32>(input, output, n_samples);
+        break;
+    }
+}
+
+
+//*******************************************************************************
+void AudioInterface::fromBitToSampleConversion
+(const int8_t* const input,
+ sample_t* output,
+ unsigned int n_samples,
+ const AudioInterface::audioBitResolutionT sourceBitResolution)
+{
+    switch (sourceBitResolution)
+    {
+    case BIT8 :
+        bitsToSamples<BIT8>(input, output, n_samples);
+        break;
+    case BIT16 :
+        bitsToSamples<BIT16>(input, output, n_samples);
+        break;
+    case BIT24 :
+        bitsToSamples<BIT24>(input, output, n_samples);
+        break;
+    case BIT32 :
+        bitsToSamples<BIT32>(input, output, n_samples);
+        break;
+    }
+}
+
+
+//*******************************************************************************
+int AudioInterface::getSimdLevel()
+{
+#if defined (AUDIO_X86)
+    return sSimdLevel;
+#else
+    return 0;
+#endif
+}
+
+
+//*******************************************************************************
+void AudioInterface::setSimdLevel(int level)
+{
+#if defined (AUDIO_X86)
+    sSimdLevel = std::max(0, std::min(level, sMaxSimdLevel));
+#else
+    (void)level;
+#endif
+}
+
+
+//*******************************************************************************
+const char* AudioInterface::getSimdName()
+{
+#if defined (AUDIO_X86)
+    switch (sSimdLevel) {
+    case SIMD_AVX512 : return "AVX-512";
+    case SIMD_AVX2 : return "AVX2";
+    case SIMD_SSSE3 : return "SSSE3";
+    default : break;
+    }
+#endif
+#if defined (__SSE2__)
+    return "SSE2";
+#elif defined (__ARM_NEON) && defined (__aarch64__)
+    return "NEON";
+#else
+    return "none";
+#endif
+}
+
 //*******************************************************************************
 void AudioInterface::appendProcessPlugin(ProcessPlugin* plugin)
 {
@@ -39,6 +39,7 @@
 #define __AUDIOINTERFACE_H__
 
 #include "ProcessPlugin.h"
+#include "AudioCodec.h"
 #include "jacktrip_types.h"
 
 #include <QVarLengthArray>
@@ -125,6 +126,11 @@ public:
    * <tt>std::tr1::shared_ptr<ProcessPluginName> loopback(new ProcessPluginName);</tt>
    */
     virtual void appendProcessPlugin(ProcessPlugin* plugin);
+    /** \brief Codes the audio sent to the network with a codec, and decodes the
+   * audio received, see AudioCodec. NULL sends PCM audio.
+   * \param codec Codec, owned by the caller. Set it before the process starts.
+   */
+    void setCodec(AudioCodec* codec);
     virtual void connectDefaultPorts() = 0;
     /** \brief Convert a 32bit number (sample_t) into one of the bit resolution
    * supported (audioBitResolutionT).
@@ -146,6 +152,32 @@ public:
     static void fromBitToSampleConversion(const int8_t* const input,
                                           sample_t* output,
                                           const AudioInterface::audioBitResolutionT sourceBitResolution);
+    /** \brief Convert n_samples consecutive samples (sample_t) into one of the bit
+   * resolutions supported, with the widest SIMD the processor has (chosen at run
+   * time on x86). The result is the same as fromSampleToBitConversion() on each
+   * sample.
+   */
+    static void fromSampleToBitConversion(const sample_t* const input,
+                                          int8_t* output,
+                                          unsigned int n_samples,
+                                          const AudioInterface::audioBitResolutionT targetBitResolution);
+    /** \brief Convert n_samples consecutive samples of a bit resolution into 32bit
+   * numbers (sample_t), with the widest SIMD the processor has (chosen at run time
+   * on x86). The result is the same as fromBitToSampleConversion() on each sample.
+   */
+    static void fromBitToSampleConversion(const int8_t* const input,
+                                          sample_t* output,
+                                          unsigned int n_samples,
+                                          const AudioInterface::audioBitResolutionT sourceBitResolution);
+    /** \brief SIMD level of the conversions of n_samples samples: 0 for the code
+   * of the build target, up to the widest level the processor has (x86 only).
+   * setSimdLevel() lowers it, for the tests to check every level; it isn't thread
+   * safe, set it while no audio runs.
+   */
+    static int getSimdLevel();
+    static void setSimdLevel(int level);
+    /// \brief Instruction set of the current SIMD level, "none" for scalar code
+    static const char* getSimdName();
 
     //--------------SETTERS---------------------------------------------
     virtual void setNumInputChannels(int nchannels)
@@ -191,6 +223,15 @@ public:
     static int getSampleRateFromType(samplingRateT rate_type);
     //------------------------------------------------------------------
 
+    /// \brief Network side of the callback: adds the process plugins output to the
+    /// input channels, if process_buffer isn't NULL, and converts them into the packet
+    typedef void (*ToNetworkFunction)(sample_t* const* in_buffer, sample_t* const* process_buffer,
+                                      int8_t* packet, unsigned int n_frames,
+                                      int num_channels, size_t channel_size);
+    /// \brief Network side of the callback: converts the packet into the output channels
+    typedef void (*FromNetworkFunction)(const int8_t* packet, sample_t* const* out_buffer,
+                                        unsigned int n_frames, int num_channels, size_t channel_size);
+
 
 private:
 
@@ -200,6 +241,15 @@ private:
     /// \brief Compute the process to send packets
     void computeProcessToNetwork(QVarLengthArray<sample_t*>& in_buffer,
                                  unsigned int n_frames);
+    /// \brief Decodes the received packets into the output, or conceals the missing ones
+    void computeCodecFromNetwork(QVarLengthArray<sample_t*>& out_buffer,
+                                 unsigned int n_frames);
+    /// \brief Codes the input in packets of the codec frames, and sends each one complete
+    void computeCodecToNetwork(QVarLengthArray<sample_t*>& in_buffer,
+                               unsigned int n_frames);
+    /// \brief Picks the conversions of the callback compiled for the bit resolution
+    /// and the number of channels, or the generic ones
+    void setupNetworkFunctions();
 
     JackTrip* mJackTrip; ///< JackTrip Mediator Class pointer
     int mNumInChans;///< Number of Input Channels
@@ -220,6 +270,17 @@ private:
     QVarLengthArray<sample_t*> mOutProcessBuffer;///< Vector of Output buffers/channel for ProcessPlugin
     int8_t* mInputPacket; ///< Packet containing all the channels to read from the RingBuffer
     int8_t* mOutputPacket;  ///< Packet containing all the channels to send to the RingBuffer
+    uint64_t mCaptureUsec; ///< Capture time of the input period, in PacketHeader::steadyUsecTime()
+    AudioCodec* mCodec; ///< Codec of the network audio, NULL for PCM
+    QVector<sample_t> mCodecSamples; ///< Samples of the codec buffers
+    QVarLengthArray<sample_t*> mCodecInBuffer; ///< Input of the next packet to code, per channel
+    QVarLengthArray<sample_t*> mCodecOutBuffer; ///< Last packet decoded, per channel
+    int mCodecInFill; ///< Frames in mCodecInBuffer
+    int mCodecOutPos; ///< Frames of mCodecOutBuffer already played
+    uint64_t mCodecCaptureUsec; ///< Capture time of the first frame of mCodecInBuffer
+    QVector<int8_t> mCodecPacket; ///< A coded packet
+    ToNetworkFunction mToNetwork; ///< Conversion of the input channels (see setupNetworkFunctions())
+    FromNetworkFunction mFromNetwork; ///< Conversion of the output channels (see setupNetworkFunctions())
 };
 
 #endif // __AUDIOINTERFACE_H__
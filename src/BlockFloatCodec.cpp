@@ -0,0 +1,229 @@
+//*****************************************************************
+/*
+  JackTrip: A System for High-Quality Audio Network Performance
+  over the Internet
+
+  Copyright (c) 2008 Juan-Pablo Caceres, Chris Chafe.
+  SoundWIRE group at CCRMA, Stanford University.
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation
+  files (the "Software"), to deal in the Software without
+  restriction, including without limitation the rights to use,
+  copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following
+  conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+*/
+//*****************************************************************
+
+
+/**
+ * \file BlockFloatCodec.cpp
+ * \date October 2026
+ */
+
+#include "BlockFloatCodec.h"
+
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Exponents of the block peaks, quieter blocks are silent
+static const int sMinExponent = -100;
+static const int sMaxExponent = 127;
+
+const int BlockFloatCodec::sBlockFrames;
+const int BlockFloatCodec::sMinMantissaBits;
+const int BlockFloatCodec::sMaxMantissaBits;
+
+
+//*******************************************************************************
+BlockFloatCodec::BlockFloatCodec(int NumChannels, int NumFrames, int MantissaBits) :
+    mNumChannels(NumChannels),
+    mFrames(NumFrames),
+    mMantissaBits(MantissaBits)
+{
+    if ( (NumChannels < 1) || (NumFrames < 1) ||
+         (MantissaBits < sMinMantissaBits) || (MantissaBits > sMaxMantissaBits) ) {
+        throw std::invalid_argument("Block floating point needs mantissas of 10 to 14 bits");
+    }
+    int num_blocks = (mFrames + sBlockFrames - 1) / sBlockFrames;
+    mChannelSize = (8 * num_blocks + mMantissaBits * mFrames + 7) / 8;
+    mMantissas.resize(sBlockFrames);
+    mLastPacket.resize(getPacketSize());
+    mLastPacket.fill(0);
+}
+
+
+//*******************************************************************************
+float BlockFloatCodec::peakLevel(const sample_t* x, int n)
+{
+    float peak = 0.0f;
+    int i = 0;
+#if defined (__SSE2__)
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) {
+        // (a NaN sample leaves the peak as it was)
+        acc = _mm_max_ps(_mm_andnot_ps(sign, _mm_loadu_ps(x + i)), acc);
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc);
+    peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+    for (; i < n; i++) {
+        float a = std::fabs(x[i]);
+        if (a > peak) { peak = a; }
+    }
+    return peak;
+}
+
+
+//*******************************************************************************
+void BlockFloatCodec::quantize(const sample_t* x, int n, float scale, float max_mantissa,
+                               int32_t* mantissas)
+{
+    int i = 0;
+#if defined (__SSE2__)
+    // Same rounding (the current mode, to nearest) and clipping as the scalar code
+    const __m128 s = _mm_set1_ps(scale);
+    const __m128 hi = _mm_set1_ps(max_mantissa);
+    const __m128 lo = _mm_set1_ps(-max_mantissa);
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(x + i), s);
+        v = _mm_max_ps(_mm_min_ps(v, hi), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(mantissas + i), _mm_cvtps_epi32(v));
+    }
+#endif
+    for (; i < n; i++) {
+        float v = x[i] * scale;
+        v = (v < max_mantissa) ? v : max_mantissa;
+        v = (v > -max_mantissa) ? v : -max_mantissa;
+        mantissas[i] = static_cast<int32_t>(std::lrint(v));
+    }
+}
+
+
+//*******************************************************************************
+void BlockFloatCodec::dequantize(const int32_t* mantissas, int n, float scale, sample_t* x)
+{
+    int i = 0;
+#if defined (__SSE2__)
+    const __m128 s = _mm_set1_ps(scale);
+    for (; i + 4 <= n; i += 4) {
+        __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mantissas + i));
+        _mm_storeu_ps(x + i, _mm_mul_ps(_mm_cvtepi32_ps(m), s));
+    }
+#endif
+    for (; i < n; i++) {
+        x[i] = static_cast<float>(mantissas[i]) * scale;
+    }
+}
+
+
+//*******************************************************************************
+void BlockFloatCodec::encode(sample_t* const* input, int8_t* output)
+{
+    const uint32_t mask = (1u << mMantissaBits) - 1;
+    const float max_mantissa = static_cast<float>((1 << (mMantissaBits - 1)) - 1);
+    for (int ch = 0; ch < mNumChannels; ch++) {
+        uint8_t* out = reinterpret_cast<uint8_t*>(output + ch * mChannelSize);
+        uint64_t bits = 0;
+        int num_bits = 0;
+        for (int start = 0; start < mFrames; start += sBlockFrames) {
+            int n = std::min(sBlockFrames, mFrames - start);
+            const sample_t* x = input[ch] + start;
+
+            // The peak is below 2^exponent, the mantissas use all their bits
+            float peak = peakLevel(x, n);
+            int exponent = sMaxExponent;
+            if (peak <= FLT_MAX) { std::frexp(peak, &exponent); }
+            if (peak == 0.0f) { exponent = sMinExponent; }
+            exponent = std::max(sMinExponent, std::min(sMaxExponent, exponent));
+            quantize(x, n, std::ldexp(1.0f, mMantissaBits - 1 - exponent), max_mantissa,
+                     mMantissas.data());
+
+            bits |= static_cast<uint64_t>(static_cast<uint8_t>(exponent)) << num_bits;
+            num_bits += 8;
+            for (int i = 0; i < n; i++) {
+                bits |= static_cast<uint64_t>(static_cast<uint32_t>(mMantissas[i]) & mask) << num_bits;
+                num_bits += mMantissaBits;
+                while (num_bits >= 8) {
+                    *out++ = static_cast<uint8_t>(bits);
+                    bits >>= 8;
+                    num_bits -= 8;
+                }
+            }
+        }
+        if (num_bits > 0) { *out = static_cast<uint8_t>(bits); }
+    }
+}
+
+
+//*******************************************************************************
+void BlockFloatCodec::decode(const int8_t* input, sample_t* const* output)
+{
+    decodePacket(input, output);
+    std::memcpy(mLastPacket.data(), input, getPacketSize());
+}
+
+
+//*******************************************************************************
+void BlockFloatCodec::conceal(sample_t* const* output)
+{
+    decodePacket(mLastPacket.data(), output);
+}
+
+
+//*******************************************************************************
+void BlockFloatCodec::decodePacket(const int8_t* input, sample_t* const* output)
+{
+    const uint32_t mask = (1u << mMantissaBits) - 1;
+    const int sign_shift = 32 - mMantissaBits;
+    for (int ch = 0; ch < mNumChannels; ch++) {
+        const uint8_t* in = reinterpret_cast<const uint8_t*>(input + ch * mChannelSize);
+        uint64_t bits = 0;
+        int num_bits = 0;
+        for (int start = 0; start < mFrames; start += sBlockFrames) {
+            int n = std::min(sBlockFrames, mFrames - start);
+            while (num_bits < 8) {
+                bits |= static_cast<uint64_t>(*in++) << num_bits;
+                num_bits += 8;
+            }
+            int exponent = static_cast<int8_t>(bits & 0xFF);
+            bits >>= 8;
+            num_bits -= 8;
+            for (int i = 0; i < n; i++) {
+                while (num_bits < mMantissaBits) {
+                    bits |= static_cast<uint64_t>(*in++) << num_bits;
+                    num_bits += 8;
+                }
+                // Sign extends the mantissa
+                uint32_t m = static_cast<uint32_t>(bits & mask) << sign_shift;
+                mMantissas[i] = static_cast<int32_t>(m) >> sign_shift;
+                bits >>= mMantissaBits;
+                num_bits -= mMantissaBits;
+            }
+            dequantize(mMantissas.data(), n, std::ldexp(1.0f, exponent - (mMantissaBits - 1)),
+                       output[ch] + start);
+        }
+    }
+}
@@ -0,0 +1,103 @@
+//*****************************************************************
+/*
+  JackTrip: A System for High-Quality Audio Network Performance
+  over the Internet
+
+  Copyright (c) 2008 Juan-Pablo Caceres, Chris Chafe.
+  SoundWIRE group at CCRMA, Stanford University.
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation
+  files (the "Software"), to deal in the Software without
+  restriction, including without limitation the rights to use,
+  copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following
+  conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+*/
+//*****************************************************************
+
+
+/**
+ * \file BlockFloatCodec.h
+ * \date October 2026
+ */
+
+#ifndef __BLOCKFLOATCODEC_H__
+#define __BLOCKFLOATCODEC_H__
+
+#include <QVector>
+
+#include "AudioCodec.h"
+
+
+/** \brief Block floating point audio: an exponent shared by each block of
+ * samples, and a mantissa for each sample.
+ *
+ * Each channel is split in blocks of sBlockFrames frames. A block stores the
+ * exponent of its peak in one byte and each sample as a mantissa of 10 to 14
+ * bits scaled to that exponent, so a quiet block keeps all its mantissa bits
+ * and the dynamic range is close to 24 bits for about the size of 16 bit
+ * audio. Packets hold one audio period and there is no lookahead, so the codec
+ * adds no latency.
+ *
+ * Each channel starts at a byte, the mantissas are packed with the least
+ * significant bits first. A lost packet is concealed with the last one, like
+ * RingBufferWavetable.
+ */
+class BlockFloatCodec : public AudioCodec
+{
+public:
+
+    /// \brief Frames that share an exponent
+    static const int sBlockFrames = 16;
+    static const int sMinMantissaBits = 10;
+    static const int sMaxMantissaBits = 14;
+
+    /** \brief The class constructor
+   * \param NumChannels Number of channels
+   * \param NumFrames Frames of each packet, the audio buffer size
+   * \param MantissaBits Bits of each mantissa, with its sign
+   */
+    BlockFloatCodec(int NumChannels, int NumFrames, int MantissaBits);
+    /// \brief The class destructor
+    virtual ~BlockFloatCodec() {}
+
+    virtual int getFrames() const { return mFrames; }
+    virtual int getPacketSize() const { return mNumChannels * mChannelSize; }
+    virtual void encode(sample_t* const* input, int8_t* output);
+    virtual void decode(const int8_t* input, sample_t* const* output);
+    virtual void conceal(sample_t* const* output);
+
+private:
+
+    /// \brief Largest absolute value of a block
+    static float peakLevel(const sample_t* x, int n);
+    /// \brief Scales a block to the mantissas, rounded and clipped to +-max_mantissa
+    static void quantize(const sample_t* x, int n, float scale, float max_mantissa,
+                         int32_t* mantissas);
+    /// \brief Scales the mantissas of a block back to samples
+    static void dequantize(const int32_t* mantissas, int n, float scale, sample_t* x);
+    void decodePacket(const int8_t* input, sample_t* const* output);
+
+    int mNumChannels; ///< Number of channels
+    int mFrames; ///< Frames of each packet
+    int mMantissaBits; ///< Bits of each mantissa
+    int mChannelSize; ///< Bytes of each channel in a packet
+    QVector<int32_t> mMantissas; ///< Mantissas of a block
+    QVector<int8_t> mLastPacket; ///< Last decoded packet, to conceal the lost ones
+};
+
+#endif //__BLOCKFLOATCODEC_H__
@@ -56,6 +56,7 @@
 #include <QHostAddress>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QVector>
 
 class JackTrip; // forward declaration
 
@@ -101,7 +102,8 @@ public:
     enum packetHeaderTypeT {
         DEFAULT, ///< Default application header
         JAMLINK, ///< Header to use with Jamlinks
-        EMPTY    ///< Empty Header
+        EMPTY,   ///< Empty Header
+        DEFAULT_V2 ///< Version 2 of the default header, 32-bit sequence numbers
     };
 
     /// \brief Enum to define class modes, SENDER or RECEIVER
@@ -109,6 +111,34 @@ public:
         SENDER, ///< Set class as a Sender (send packets)
         RECEIVER ///< Set class as a Receiver (receives packets)
     };
+
+    /// \brief Enum to define the types of control packets
+    enum controlPacketTypeT {
+        HEARTBEAT = 1, ///< The peer is alive, even if it doesn't send audio
+        GOODBYE = 2, ///< The peer is leaving the session
+        FRAGMENT = 3, ///< A fragment of an audio packet larger than the path MTU
+        FEC_PARITY = 4, ///< A parity packet of a group of audio packets
+        LOSS_REPORT = 5, ///< Datagrams received and lost by the peer
+        NACK = 6, ///< Audio packets the peer lost and wants again
+        COMPRESSED = 7, ///< Audio packets with losslessly coded audio
+        DTX = 8, ///< Audio packets without their silent channels
+        REDUCED = 9 ///< Audio packets at a lower bit resolution
+    };
+
+    /// \brief Enum to define the features a sender announces in version 2 headers
+    enum capabilityT {
+        CAP_HEARTBEAT = 0x01, ///< Sends heartbeats and a goodbye
+        CAP_FRAGMENTS = 0x02, ///< Splits packets larger than the path MTU
+        CAP_FEC = 0x04, ///< Sends FEC parity packets
+        CAP_LOSS_REPORTS = 0x08, ///< Adapts its redundancy to loss reports
+        CAP_NACK = 0x10, ///< Asks for lost packets
+        CAP_LOSSLESS = 0x20, ///< Codes the audio losslessly
+        CAP_OPUS = 0x40, ///< Codes the audio with Opus
+        CAP_BLOCKFLOAT = 0x80, ///< Sends the audio in block floating point
+        CAP_DTX = 0x100, ///< Leaves the silent channels out of the packets
+        CAP_HALFFLOAT = 0x200, ///< Sends the audio as 16 bit floating point
+        CAP_ADAPTIVE_BITRATE = 0x400 ///< Lowers the bit resolution on congestion
+    };
     //---------------------------------------------------------
 
 
@@ -162,6 +192,53 @@ public:
    */
     virtual void setPeerPort(int port) = 0;
 
+    /** \brief Moves the session to a new peer address and port. Unlike setPeerAddress()
+   * and setPeerPort(), it can be called while the thread is running.
+   * \param address New peer address
+   * \param port New peer port
+   */
+    virtual void migratePeer(const QHostAddress& /*address*/, uint16_t /*port*/) {}
+
+    /// \brief Tells the peer that we're leaving. Call it once the thread has stopped.
+    virtual void sendGoodbye() {}
+
+    /** \brief Loss measured by the peer on what we send. Called by the
+   * RECEIVER on the SENDER, from the RECEIVER thread.
+   * \param received Datagrams received
+   * \param lost Datagrams lost
+   * \param max_burst Longest run of consecutive datagrams lost
+   * \param delay_change_usec Change of the shortest one-way delay since the last report
+   */
+    virtual void reportPeerLoss(uint16_t /*received*/, uint16_t /*lost*/, uint16_t /*max_burst*/,
+                                int32_t /*delay_change_usec*/) {}
+
+    /** \brief Packets the peer lost and wants again. Called by the RECEIVER on
+   * the SENDER, from the RECEIVER thread.
+   * \param seq_nums Sequence numbers of the packets
+   * \param count Number of sequence numbers
+   */
+    virtual void requestRetransmission(const uint16_t* /*seq_nums*/, int /*count*/) {}
+
+    /** \brief A peer packet arrived, its time stamp goes back in the next headers.
+   * Called by the RECEIVER on the SENDER, from the RECEIVER thread.
+   * \param time_stamp Time stamp of the peer packet
+   */
+    virtual void echoPeerTimeStamp(uint32_t /*time_stamp*/) {}
+
+    /** \brief Returns when a packet was sent, in PacketHeader::steadyUsecTime(). Called
+   * by the RECEIVER on the SENDER, from the RECEIVER thread.
+   * \param time_stamp Time stamp of the packet
+   * \param capture_usec Returns the capture time of its audio
+   * \return -1 if the packet is too old
+   */
+    virtual int64_t getSendTime(uint32_t /*time_stamp*/, int64_t* /*capture_usec*/) { return -1; }
+
+    /** \brief Encrypts and authenticates the packets. Call it before the thread starts.
+   * \param send_key Key of the packets to the peer
+   * \param receive_key Key of the packets from the peer
+   */
+    virtual void setEncryptionKeys(const uint8_t* /*send_key*/, const uint8_t* /*receive_key*/) {}
+
     //virtual void getPeerAddressFromFirstPacket(QHostAddress& peerHostAddress,
     //				     uint16_t& port) = 0;
 
@@ -177,13 +254,48 @@ public:
         uint32_t outOfOrder;
         uint32_t revived;
         uint32_t statCount;
+        uint32_t migrations; ///< Times the peer moved to a new address
+        uint32_t migrationGapMsec; ///< Silence before the last move, in milliseconds
+        uint32_t concealed; ///< Packets played with some fragments missing
+        uint32_t recovered; ///< Lost packets rebuilt from FEC parity
+        uint32_t retransmitted; ///< Lost packets sent again by the peer in time
+        uint32_t rttCount; ///< Round trip times measured (since last call)
+        double rttMinMsec; ///< Shortest round trip time (since last call)
+        double rttAvgMsec; ///< Average round trip time (since last call)
+        double rttMaxMsec; ///< Longest round trip time (since last call)
+        double latencyAvgMsec; ///< Average capture to peer arrival of our audio, estimated
+                               ///< as the send queue plus half the round trip (since last call)
     };
     virtual bool getStats(PktStat*) {return false;}
 
+    /// \brief Statistics of one network path when the peer sends over several paths
+    struct PathStat {
+        QString address; ///< Source address and port of the path
+        uint32_t received; ///< Datagrams received on this path
+        uint32_t firstArrivals; ///< Datagrams that arrived on this path before any other copy
+        uint32_t lost; ///< Sequence numbers skipped on this path
+        double lagAvgMsec; ///< Average delay behind the fastest copy (since last call)
+        double lagMaxMsec; ///< Maximum delay behind the fastest copy (since last call)
+    };
+    virtual bool getPathStats(QVector<PathStat>*) {return false;}
+
+    /// \brief Statistics of the audio sent with silence suppression or adaptive bitrate
+    struct SendStat {
+        uint64_t audioBytes; ///< Bytes of the packets before suppression (since last call)
+        uint64_t sentBytes; ///< Bytes of the packets sent (since last call)
+        uint8_t wireBits; ///< Bit resolution of the audio sent, 0 without adaptive bitrate
+        uint32_t bitrateSwitches; ///< Changes of wire bit resolution (since last call)
+    };
+    virtual bool getSendStats(SendStat*) {return false;}
+
 signals:
 
     void signalError(const char* error_message);
     void signalReceivedConnectionFromPeer();
+    /// \brief Signals that the peer now sends from a different address
+    void signalPeerMigrated(const QString& address, int port);
+    /// \brief Signals that the peer said goodbye or stopped sending heartbeats
+    void signalPeerGone();
 
 
 protected:
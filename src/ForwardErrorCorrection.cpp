@@ -0,0 +1,274 @@
+//*****************************************************************
+/*
+  JackTrip: A System for High-Quality Audio Network Performance
+  over the Internet
+
+  Copyright (c) 2008 Juan-Pablo Caceres, Chris Chafe.
+  SoundWIRE group at CCRMA, Stanford University.
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation
+  files (the "Software"), to deal in the Software without
+  restriction, including without limitation the rights to use,
+  copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following
+  conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+*/
+//*****************************************************************
+
+/**
+ * \file ForwardErrorCorrection.cpp
+ * \date October 2026
+ */
+
+#include "ForwardErrorCorrection.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+// The SSSE3 code is compiled for every x86 build and used only if the processor has it
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__)
+#define FEC_X86
+#include <tmmintrin.h>
+#endif
+
+uint8_t ForwardErrorCorrection::sExp[512];
+uint8_t ForwardErrorCorrection::sLog[256];
+bool ForwardErrorCorrection::sSsse3 = false;
+
+
+#if defined (FEC_X86)
+//*******************************************************************************
+/// \brief dst ^= low[x & 0x0F] ^ high[x >> 4] for the bytes x of src, 16 at a time
+/// \return Bytes done, the rest (less than 16) is left to the caller
+__attribute__((target("ssse3")))
+static int mulAddSsse3(uint8_t* dst, const uint8_t* src, const uint8_t* low,
+                       const uint8_t* high, int size)
+{
+    const __m128i low_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(low));
+    const __m128i high_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(high));
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    int i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i product = _mm_xor_si128(
+                    _mm_shuffle_epi8(low_table, _mm_and_si128(x, mask)),
+                    _mm_shuffle_epi8(high_table, _mm_and_si128(_mm_srli_epi64(x, 4), mask)) );
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(d, product));
+    }
+    return i;
+}
+#endif
+
+
+//*******************************************************************************
+ForwardErrorCorrection::ForwardErrorCorrection(int GroupSize, int ParityCount) :
+    mGroupSize(GroupSize),
+    mParityCount(ParityCount)
+{
+    if ( (GroupSize < 1) || (ParityCount < 1) || (GroupSize + ParityCount > 256) ) {
+        throw std::invalid_argument("FEC groups need 1 or more packets and parity packets, 256 at most");
+    }
+    static const bool tables_ready = initTables(); // Thread safe, done once
+    (void) tables_ready;
+
+    // Cauchy matrix 1/(x_j + y_i), x_j = GroupSize + j and y_i = i. Every square
+    // submatrix of it can be inverted, so any ParityCount losses can be rebuilt.
+    // Each column is scaled so the first row is all ones (XOR parity), that
+    // keeps the submatrices invertible.
+    mCoefficients.resize(mParityCount * mGroupSize);
+    for (int j = 0; j < mParityCount; j++) {
+        for (int i = 0; i < mGroupSize; i++) {
+            mCoefficients[j * mGroupSize + i] =
+                    mul( static_cast<uint8_t>(mGroupSize ^ i),
+                         inv(static_cast<uint8_t>((mGroupSize + j) ^ i)) );
+        }
+    }
+}
+
+
+//*******************************************************************************
+bool ForwardErrorCorrection::initTables()
+{
+    // GF(256) with the polynomial x^8 + x^4 + x^3 + x^2 + 1 and generator 2
+    int x = 1;
+    for (int i = 0; i < 255; i++) {
+        sExp[i] = static_cast<uint8_t>(x);
+        sLog[x] = static_cast<uint8_t>(i);
+        x <<= 1;
+        if (x & 0x100) { x ^= 0x11D; }
+    }
+    for (int i = 255; i < 512; i++) {
+        sExp[i] = sExp[i - 255];
+    }
+    sLog[0] = 0; // Never used
+#if defined (FEC_X86)
+    __builtin_cpu_init();
+    sSsse3 = __builtin_cpu_supports("ssse3");
+#endif
+    return true;
+}
+
+
+//*******************************************************************************
+uint8_t ForwardErrorCorrection::mul(uint8_t a, uint8_t b)
+{
+    if ( (a == 0) || (b == 0) ) { return 0; }
+    return sExp[sLog[a] + sLog[b]];
+}
+
+
+//*******************************************************************************
+uint8_t ForwardErrorCorrection::inv(uint8_t a)
+{
+    return sExp[255 - sLog[a]];
+}
+
+
+//*******************************************************************************
+void ForwardErrorCorrection::xorAdd(uint8_t* dst, const uint8_t* src, int size)
+{
+    // 8 bytes at a time, the compiler vectorizes this loop
+    int i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t a, b;
+        std::memcpy(&a, dst + i, 8);
+        std::memcpy(&b, src + i, 8);
+        a ^= b;
+        std::memcpy(dst + i, &a, 8);
+    }
+    for (; i < size; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+
+//*******************************************************************************
+void ForwardErrorCorrection::mulAdd(uint8_t* dst, const uint8_t* src, uint8_t c, int size)
+{
+    if (c == 0) { return; }
+    if (c == 1) { xorAdd(dst, src, size); return; }
+
+    // c * x = c * (x & 0x0F) + c * (x & 0xF0): two 16 entry tables, that fit in
+    // one SSSE3 register each
+    uint8_t low[16], high[16];
+    for (int x = 0; x < 16; x++) {
+        low[x] = mul(c, static_cast<uint8_t>(x));
+        high[x] = mul(c, static_cast<uint8_t>(x << 4));
+    }
+    int i = 0;
+#if defined (FEC_X86)
+    if (sSsse3) { i = mulAddSsse3(dst, src, low, high, size); }
+#endif
+    for (; i < size; i++) {
+        dst[i] ^= low[src[i] & 0x0F] ^ high[src[i] >> 4];
+    }
+}
+
+
+//*******************************************************************************
+void ForwardErrorCorrection::encode(const int8_t* data, int8_t* parity, int packet_size) const
+{
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(data);
+    uint8_t* out = reinterpret_cast<uint8_t*>(parity);
+    std::memset(out, 0, mParityCount * packet_size);
+    for (int j = 0; j < mParityCount; j++) {
+        for (int i = 0; i < mGroupSize; i++) {
+            mulAdd(out + j * packet_size, in + i * packet_size, coefficient(j, i), packet_size);
+        }
+    }
+}
+
+
+//*******************************************************************************
+bool ForwardErrorCorrection::decode(int8_t* data, const bool* data_present,
+                                    const int8_t* parity, const bool* parity_present,
+                                    int packet_size)
+{
+    uint8_t* packets = reinterpret_cast<uint8_t*>(data);
+    const uint8_t* parities = reinterpret_cast<const uint8_t*>(parity);
+
+    // Missing packets, and as many received parity packets
+    QVector<int> missing;
+    for (int i = 0; i < mGroupSize; i++) {
+        if (!data_present[i]) { missing.append(i); }
+    }
+    int n = missing.size();
+    if (n == 0) { return true; }
+    QVector<int> rows;
+    for (int j = 0; (j < mParityCount) && (rows.size() < n); j++) {
+        if (parity_present[j]) { rows.append(j); }
+    }
+    if (rows.size() < n) { return false; }
+
+    // Syndromes: the parity packets without the packets we have
+    mSyndromes.resize(n * packet_size);
+    uint8_t* syndromes = mSyndromes.data();
+    for (int k = 0; k < n; k++) {
+        std::memcpy(syndromes + k * packet_size, parities + rows[k] * packet_size, packet_size);
+        for (int i = 0; i < mGroupSize; i++) {
+            if (data_present[i]) {
+                mulAdd(syndromes + k * packet_size, packets + i * packet_size,
+                       coefficient(rows[k], i), packet_size);
+            }
+        }
+    }
+
+    // Invert the n x n matrix of the missing packets (Gauss-Jordan), the left
+    // half is the matrix and the right half becomes its inverse
+    int width = 2 * n;
+    mMatrix.resize(n * width);
+    uint8_t* m = mMatrix.data();
+    for (int k = 0; k < n; k++) {
+        for (int l = 0; l < n; l++) {
+            m[k * width + l] = coefficient(rows[k], missing[l]);
+            m[k * width + n + l] = (k == l) ? 1 : 0;
+        }
+    }
+    for (int col = 0; col < n; col++) {
+        int pivot = col;
+        while ( (pivot < n) && (m[pivot * width + col] == 0) ) { pivot++; }
+        if (pivot == n) { return false; } // Can't happen with a Cauchy matrix
+        if (pivot != col) {
+            for (int l = 0; l < width; l++) {
+                std::swap(m[pivot * width + l], m[col * width + l]);
+            }
+        }
+        uint8_t scale = inv(m[col * width + col]);
+        for (int l = 0; l < width; l++) {
+            m[col * width + l] = mul(m[col * width + l], scale);
+        }
+        for (int k = 0; k < n; k++) {
+            uint8_t factor = m[k * width + col];
+            if ( (k == col) || (factor == 0) ) { continue; }
+            for (int l = 0; l < width; l++) {
+                m[k * width + l] ^= mul(factor, m[col * width + l]);
+            }
+        }
+    }
+
+    // Missing packet l = sum over k of inverse[l][k] * syndrome k
+    for (int l = 0; l < n; l++) {
+        uint8_t* out = packets + missing[l] * packet_size;
+        std::memset(out, 0, packet_size);
+        for (int k = 0; k < n; k++) {
+            mulAdd(out, syndromes + k * packet_size, m[l * width + n + k], packet_size);
+        }
+    }
+    return true;
+}
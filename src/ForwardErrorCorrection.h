@@ -0,0 +1,111 @@
+//*****************************************************************
+/*
+  JackTrip: A System for High-Quality Audio Network Performance
+  over the Internet
+
+  Copyright (c) 2008 Juan-Pablo Caceres, Chris Chafe.
+  SoundWIRE group at CCRMA, Stanford University.
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation
+  files (the "Software"), to deal in the Software without
+  restriction, including without limitation the rights to use,
+  copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following
+  conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+*/
+//*****************************************************************
+
+/**
+ * \file ForwardErrorCorrection.h
+ * \date October 2026
+ */
+
+#ifndef __FORWARDERRORCORRECTION_H__
+#define __FORWARDERRORCORRECTION_H__
+
+#include <QVector>
+
+#include "jacktrip_types.h"
+
+
+/** \brief Parity packets over groups of audio packets, to rebuild lost packets
+ * without sending full copies of them.
+ *
+ * Each group of \b GroupSize packets gets \b ParityCount parity packets of the same
+ * size. Any \b ParityCount lost packets of a group (data or parity) can be rebuilt
+ * from the rest. The code is a systematic Reed-Solomon code over GF(256) built
+ * from a Cauchy matrix, scaled so the first parity packet is the XOR of the
+ * group: with one parity packet this is plain XOR parity.
+ */
+class ForwardErrorCorrection
+{
+public:
+
+    /** \brief The class constructor
+   * \param GroupSize Audio packets in each group
+   * \param ParityCount Parity packets for each group (GroupSize + ParityCount <= 256)
+   */
+    ForwardErrorCorrection(int GroupSize, int ParityCount);
+
+    int getGroupSize() const { return mGroupSize; }
+    int getParityCount() const { return mParityCount; }
+
+    /** \brief Computes the parity packets of a group
+   * \param data GroupSize packets of packet_size bytes, one after the other
+   * \param parity Returns ParityCount packets of packet_size bytes
+   * \param packet_size Size of each packet
+   */
+    void encode(const int8_t* data, int8_t* parity, int packet_size) const;
+
+    /** \brief Rebuilds the missing packets of a group in place
+   * \param data GroupSize packets of packet_size bytes, the missing ones are written
+   * \param data_present Which packets of data were received
+   * \param parity ParityCount parity packets of packet_size bytes
+   * \param parity_present Which parity packets were received
+   * \param packet_size Size of each packet
+   * \return false if too many packets are missing, data is unchanged then
+   */
+    bool decode(int8_t* data, const bool* data_present,
+                const int8_t* parity, const bool* parity_present,
+                int packet_size);
+
+private:
+
+    /// \brief Coefficient of data packet i in parity packet j
+    uint8_t coefficient(int j, int i) const
+    { return mCoefficients[j * mGroupSize + i]; }
+
+    static bool initTables();
+    static uint8_t mul(uint8_t a, uint8_t b);
+    static uint8_t inv(uint8_t a);
+    /// \brief dst ^= src
+    static void xorAdd(uint8_t* dst, const uint8_t* src, int size);
+    /// \brief dst ^= c * src, in GF(256)
+    static void mulAdd(uint8_t* dst, const uint8_t* src, uint8_t c, int size);
+
+    int mGroupSize; ///< Audio packets in each group
+    int mParityCount; ///< Parity packets for each group
+    QVector<uint8_t> mCoefficients; ///< ParityCount x GroupSize encoding matrix
+    QVector<uint8_t> mSyndromes; ///< Decoding buffer
+    QVector<uint8_t> mMatrix; ///< Decoding matrix and its inverse
+
+    static uint8_t sExp[512]; ///< Powers of the generator, doubled to skip a modulo
+    static uint8_t sLog[256]; ///< Discrete logarithms
+    static bool sSsse3; ///< The processor has SSSE3, checked at run time
+};
+
+#endif //__FORWARDERRORCORRECTION_H__
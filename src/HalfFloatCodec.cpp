@@ -0,0 +1,239 @@
+//*****************************************************************
+/*
+  JackTrip: A System for High-Quality Audio Network Performance
+  over the Internet
+
+  Copyright (c) 2008 Juan-Pablo Caceres, Chris Chafe.
+  SoundWIRE group at CCRMA, Stanford University.
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation
+  files (the "Software"), to deal in the Software without
+  restriction, including without limitation the rights to use,
+  copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following
+  conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+*/
+//*****************************************************************
+
+
+/**
+ * \file HalfFloatCodec.cpp
+ * \date October 2026
+ */
+
+#include "HalfFloatCodec.h"
+
+#include <cstring>
+#include <stdexcept>
+
+// The F16C code is compiled for every x86 build and used only if the processor has it
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__)
+#define HALF_X86
+#include <immintrin.h>
+#elif defined (__ARM_NEON) && defined (__aarch64__)
+#include <arm_neon.h>
+#endif
+
+
+//*******************************************************************************
+HalfFloatCodec::HalfFloatCodec(int NumChannels, int NumFrames) :
+    mNumChannels(NumChannels),
+    mFrames(NumFrames)
+{
+    if ( (NumChannels < 1) || (NumFrames < 1) ) {
+        throw std::invalid_argument("Half float packets need at least a channel and a frame");
+    }
+    mHalves.resize(mFrames);
+    mLastPacket.resize(getPacketSize());
+    mLastPacket.fill(0);
+}
+
+
+#if defined (HALF_X86)
+//*******************************************************************************
+/// \brief The processor has F16C (and the AVX registers it uses), checked once
+static bool hasF16c()
+{
+    static const bool f16c = ( __builtin_cpu_init(),
+                               __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c") );
+    return f16c;
+}
+
+//*******************************************************************************
+/// \brief Converts 8 samples at a time
+/// \return Samples done, the rest (less than 8) is left to the caller
+__attribute__((target("avx,f16c")))
+static int floatToHalfF16c(const sample_t* input, uint16_t* output, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(input + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), h);
+    }
+    return i;
+}
+
+//*******************************************************************************
+/// \brief Converts 8 half floats at a time
+/// \return Half floats done, the rest (less than 8) is left to the caller
+__attribute__((target("avx,f16c")))
+static int halfToFloatF16c(const uint16_t* input, sample_t* output, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        _mm256_storeu_ps(output + i, _mm256_cvtph_ps(h));
+    }
+    return i;
+}
+#endif
+
+
+//*******************************************************************************
+// Exact conversion, rounded to nearest even like the hardware
+static uint16_t floatToHalfScalar(float value)
+{
+    uint32_t f;
+    std::memcpy(&f, &value, sizeof(f));
+    uint16_t sign = static_cast<uint16_t>((f >> 16) & 0x8000);
+    uint32_t exponent = (f >> 23) & 0xFF;
+    uint32_t mantissa = f & 0x7FFFFF;
+
+    if (exponent == 0xFF) { // Inf, NaN (kept quiet)
+        return sign | 0x7C00 | (mantissa ? (0x200 | (mantissa >> 13)) : 0);
+    }
+    int e = static_cast<int>(exponent) - 127 + 15;
+    if (e >= 31) { return sign | 0x7C00; } // Overflow
+    if (e <= 0) {
+        // Subnormal half, or zero
+        if (e < -10) { return sign; }
+        mantissa |= 0x800000;
+        int shift = 14 - e;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if ( (rest > halfway) || ((rest == halfway) && (half & 1)) ) { ++half; }
+        return sign | static_cast<uint16_t>(half);
+    }
+    uint32_t half = (static_cast<uint32_t>(e) << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1FFF;
+    // (a carry into the exponent rounds up to the next power of 2, or to Inf)
+    if ( (rest > 0x1000) || ((rest == 0x1000) && (half & 1)) ) { ++half; }
+    return sign | static_cast<uint16_t>(half);
+}
+
+
+//*******************************************************************************
+static float halfToFloatScalar(uint16_t half)
+{
+    uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    uint32_t f;
+    if (exponent == 0x1F) { // Inf, NaN
+        f = sign | 0x7F800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        f = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        f = sign;
+    } else {
+        // Subnormal half, normal float
+        exponent = 127 - 15 + 1;
+        while ( !(mantissa & 0x400) ) {
+            mantissa <<= 1;
+            --exponent;
+        }
+        f = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+    float value;
+    std::memcpy(&value, &f, sizeof(value));
+    return value;
+}
+
+
+//*******************************************************************************
+void HalfFloatCodec::floatToHalf(const sample_t* input, uint16_t* output, int n)
+{
+    int i = 0;
+#if defined (HALF_X86)
+    if (hasF16c()) { i = floatToHalfF16c(input, output, n); }
+#elif defined (__ARM_NEON) && defined (__aarch64__)
+    for (; i + 4 <= n; i += 4) {
+        float16x4_t h = vcvt_f16_f32(vld1q_f32(input + i));
+        vst1_u16(output + i, vreinterpret_u16_f16(h));
+    }
+#endif
+    for (; i < n; i++) {
+        output[i] = floatToHalfScalar(input[i]);
+    }
+}
+
+
+//*******************************************************************************
+void HalfFloatCodec::halfToFloat(const uint16_t* input, sample_t* output, int n)
+{
+    int i = 0;
+#if defined (HALF_X86)
+    if (hasF16c()) { i = halfToFloatF16c(input, output, n); }
+#elif defined (__ARM_NEON) && defined (__aarch64__)
+    for (; i + 4 <= n; i += 4) {
+        float16x4_t h = vreinterpret_f16_u16(vld1_u16(input + i));
+        vst1q_f32(output + i, vcvt_f32_f16(h));
+    }
+#endif
+    for (; i < n; i++) {
+        output[i] = halfToFloatScalar(input[i]);
+    }
+}
+
+
+//*******************************************************************************
+void HalfFloatCodec::encode(sample_t* const* input, int8_t* output)
+{
+    int channel_size = mFrames * sizeof(uint16_t);
+    for (int ch = 0; ch < mNumChannels; ch++) {
+        floatToHalf(input[ch], mHalves.data(), mFrames);
+        std::memcpy(output + ch * channel_size, mHalves.data(), channel_size);
+    }
+}
+
+
+//*******************************************************************************
+void HalfFloatCodec::decode(const int8_t* input, sample_t* const* output)
+{
+    decodePacket(input, output);
+    std::memcpy(mLastPacket.data(), input, getPacketSize());
+}
+
+
+//*******************************************************************************
+void HalfFloatCodec::conceal(sample_t* const* output)
+{
+    decodePacket(mLastPacket.data(), output);
+}
+
+
+//*******************************************************************************
+void HalfFloatCodec::decodePacket(const int8_t* input, sample_t* const* output)
+{
+    // (the packet isn't aligned for uint16_t in the RingBuffer slots)
+    int channel_size = mFrames * sizeof(uint16_t);
+    for (int ch = 0; ch < mNumChannels; ch++) {
+        std::memcpy(mHalves.data(), input + ch * channel_size, channel_size);
+        halfToFloat(mHalves.data(), output[ch], mFrames);
+    }
+}
@@ -0,0 +1,92 @@
+//*****************************************************************
+/*
+  JackTrip: A System for High-Quality Audio Network Performance
+  over the Internet
+
+  Copyright (c) 2008 Juan-Pablo Caceres, Chris Chafe.
+  SoundWIRE group at CCRMA, Stanford University.
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation
+  files (the "Software"), to deal in the Software without
+  restriction, including without limitation the rights to use,
+  copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following
+  conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+*/
+//*****************************************************************
+
+
+/**
+ * \file HalfFloatCodec.h
+ * \date October 2026
+ */
+
+#ifndef __HALFFLOATCODEC_H__
+#define __HALFFLOATCODEC_H__
+
+#include <QVector>
+
+#include "AudioCodec.h"
+
+
+/** \brief Audio in 16 bit floating point (IEEE 754 binary16).
+ *
+ * Samples take 2 bytes like 16 bit audio, but with 11 significant bits at any
+ * level down to 2^-14 (and gradual underflow below), and headroom up to 65504
+ * instead of clipping at 1. Packets hold one audio period, so the codec adds no
+ * latency.
+ *
+ * Whole channels are converted with the F16C instructions on x86 (if the
+ * processor has them, checked at run time) or NEON on ARMv8, and with an exact
+ * scalar conversion elsewhere. All of them round to nearest even, so they give
+ * the same samples. A lost packet is concealed with the last one, like
+ * RingBufferWavetable.
+ */
+class HalfFloatCodec : public AudioCodec
+{
+public:
+
+    /** \brief The class constructor
+   * \param NumChannels Number of channels
+   * \param NumFrames Frames of each packet, the audio buffer size
+   */
+    HalfFloatCodec(int NumChannels, int NumFrames);
+    /// \brief The class destructor
+    virtual ~HalfFloatCodec() {}
+
+    virtual int getFrames() const { return mFrames; }
+    virtual int getPacketSize() const { return mNumChannels * mFrames * sizeof(uint16_t); }
+    virtual void encode(sample_t* const* input, int8_t* output);
+    virtual void decode(const int8_t* input, sample_t* const* output);
+    virtual void conceal(sample_t* const* output);
+
+    /// \brief Converts samples to half floats, rounded to nearest even
+    static void floatToHalf(const sample_t* input, uint16_t* output, int n);
+    /// \brief Converts half floats to samples
+    static void halfToFloat(const uint16_t* input, sample_t* output, int n);
+
+private:
+
+    void decodePacket(const int8_t* input, sample_t* const* output);
+
+    int mNumChannels; ///< Number of channels
+    int mFrames; ///< Frames of each packet
+    QVector<uint16_t> mHalves; ///< Half floats of a channel, aligned for the conversions
+    QVector<int8_t> mLastPacket; ///< Last decoded packet, to conceal the lost ones
+};
+
+#endif //__HALFFLOATCODEC_H__
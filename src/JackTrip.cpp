@@ -43,10 +43,16 @@
 #ifdef __RT_AUDIO__
 #include "RtAudioInterface.h"
 #endif
+#include "BlockFloatCodec.h"
+#include "HalfFloatCodec.h"
+#ifdef __OPUS__
+#include "OpusCodec.h"
+#endif
 
 #include <iostream>
 #include <cstdlib>
 #include <stdexcept>
+#include <algorithm>
 
 #include <QHostAddress>
 #include <QHostInfo>
@@ -83,6 +89,9 @@ JackTrip::JackTrip(jacktripModeT JacktripMode,
     mJackTripMode(JacktripMode),
     mDataProtocol(DataProtocolType),
     mPacketHeaderType(PacketHeaderType),
+    mHeaderSizeInBytes(0),
+    mHeaderHasLongSequenceNumbers(false),
+    mHeaderHasEcho(false),
     mAudiointerfaceMode(JackTrip::JACK),
     mNumChans(NumChans),
     #ifdef WAIR // WAIR
@@ -106,6 +115,37 @@ JackTrip::JackTrip(jacktripModeT JacktripMode,
     mReceiverPeerPort(receiver_peer_port),
     mTcpServerPort(4464),
     mRedundancy(redundancy),
+    mMultipath(false),
+    mSendOnly(false),
+    mReceiveOnly(false),
+    mHeartbeat(false),
+    mMtu(0),
+    mAggregation(1),
+    mSplit(1),
+    mFecGroupSize(0),
+    mFecParityCount(0),
+    mAdaptiveRedundancy(false),
+    mNack(false),
+    mLossless(false),
+    mDtx(false),
+    mDtxGateDb(0.0),
+    mAdaptiveBitrateBits(0),
+    mCodec(AudioCodec::PCM),
+    mCodecBitrate(0),
+    mCodecFrameUsec(0),
+    mCodecMantissaBits(0),
+    mAudioCodec(NULL),
+    mEncryption(false),
+    mSendPacketFrames(0),
+    mReceivePacketFrames(0),
+    mPeerBufferSize(0),
+    mSendPeriodPos(0),
+    mSendPeriodUsec(0),
+    mSendCaptureUsec(0),
+    mReceivePeriodFill(0),
+    mReceiveBitResolution(AudioBitResolution),
+    mReceiveSampleRateType(AudioInterface::UNDEF),
+    mReceiveConverter(NULL),
     mJackClientName(gJackDefaultClientName),
     mConnectionMode(JackTrip::NORMAL),
     mReceivedConnection(false),
@@ -125,9 +165,11 @@ JackTrip::~JackTrip()
     delete mDataProtocolSender;
     delete mDataProtocolReceiver;
     delete mAudioInterface;
+    delete mAudioCodec;
     delete mPacketHeader;
     delete mSendRingBuffer;
     delete mReceiveRingBuffer;
+    delete mReceiveConverter;
 }
 
 
@@ -227,18 +269,36 @@ void JackTrip::setupDataProtocol()
 {
     // Create DataProtocol Objects
     switch (mDataProtocol) {
-    case UDP:
+    case UDP: {
         std::cout << "Using UDP Protocol" << std::endl;
         std::cout << gPrintSeparator << std::endl;
         QThread::usleep(100);
-        mDataProtocolSender = new UdpDataProtocol(this, DataProtocol::SENDER,
-                                                  //mSenderPeerPort, mSenderBindPort,
-                                                  mSenderBindPort, mSenderPeerPort,
-                                                  mRedundancy);
-        mDataProtocolReceiver =  new UdpDataProtocol(this, DataProtocol::RECEIVER,
-                                                     mReceiverBindPort, mReceiverPeerPort,
-                                                     mRedundancy);
-        break;
+        UdpDataProtocol* udp_sender = new UdpDataProtocol(this, DataProtocol::SENDER,
+                                                          //mSenderPeerPort, mSenderBindPort,
+                                                          mSenderBindPort, mSenderPeerPort,
+                                                          mRedundancy);
+        UdpDataProtocol* udp_receiver = new UdpDataProtocol(this, DataProtocol::RECEIVER,
+                                                            mReceiverBindPort, mReceiverPeerPort,
+                                                            mRedundancy);
+        udp_sender->setMultipath(mMultipath, mMultipathLocalPaths);
+        udp_receiver->setMultipath(mMultipath);
+        udp_receiver->setHeartbeat(mHeartbeat);
+        udp_sender->setMtu(mMtu);
+        udp_sender->setFec(mFecGroupSize, mFecParityCount);
+        udp_sender->setAdaptiveRedundancy(mAdaptiveRedundancy);
+        udp_receiver->setAdaptiveRedundancy(mAdaptiveRedundancy);
+        udp_receiver->setNack(mNack);
+        udp_sender->setLossless(mLossless);
+        udp_sender->setDtx(mDtx, mDtxGateDb);
+        udp_sender->setAdaptiveBitrate(mAdaptiveBitrateBits);
+        udp_receiver->setAdaptiveBitrate(mAdaptiveBitrateBits);
+        if (mEncryption) {
+            udp_sender->setEncryptionKeys(mSendKey, mReceiveKey);
+            udp_receiver->setEncryptionKeys(mSendKey, mReceiveKey);
+        }
+        mDataProtocolSender = udp_sender;
+        mDataProtocolReceiver = udp_receiver;
+        break; }
     case TCP:
         throw std::invalid_argument("TCP Protocol is not implemented");
         break;
@@ -255,8 +315,43 @@ void JackTrip::setupDataProtocol()
     //  (mAudioInterface->getSizeInBytesPerChannel() * mNumChans);
     //mDataProtocolReceiver->setAudioPacketSize
     //  (mAudioInterface->getSizeInBytesPerChannel() * mNumChans);
-    mDataProtocolSender->setAudioPacketSize(getTotalAudioPacketSizeInBytes());
+    // The receiver resizes its packets once it knows the peer aggregation
+    mDataProtocolSender->setAudioPacketSize(getSendAudioPacketSizeInBytes());
     mDataProtocolReceiver->setAudioPacketSize(getTotalAudioPacketSizeInBytes());
+    mSendPeriod.resize(getTotalAudioPacketSizeInBytes());
+    mReceivePeriod.resize(getTotalAudioPacketSizeInBytes());
+    mSendPeriodPos = mAudioBufferSize;
+    mReceivePeriodFill = 0;
+}
+
+
+//*******************************************************************************
+void JackTrip::setupPacketFrames()
+{
+    if ( mAudioBufferSize % mSplit != 0 ) {
+        throw std::invalid_argument("The audio buffer size has to be a multiple of --split");
+    }
+    mSendPacketFrames = mAudioBufferSize * mAggregation / mSplit;
+    mReceivePacketFrames = mAudioBufferSize;
+    mReceiveBitResolution = mAudioBitResolution;
+    mReceiveSampleRateType = getSampleRateType();
+    delete mReceiveConverter;
+    mReceiveConverter = NULL;
+
+    // The hub server sends as many frames per packet as its client, when they
+    // are a multiple or a divisor of its own period
+    if ( (mAggregation == 1) && (mSplit == 1) && (mPeerBufferSize != 0) &&
+         ( (mPeerBufferSize % mAudioBufferSize == 0) || (mAudioBufferSize % mPeerBufferSize == 0) ) ) {
+        mSendPacketFrames = mPeerBufferSize;
+    }
+    if ( mSendPacketFrames > 0xFFFF ) {
+        throw std::invalid_argument("Too many audio frames per packet for this buffer size");
+    }
+    if ( mSendPacketFrames != mAudioBufferSize ) {
+        std::cout << "Sending " << mSendPacketFrames << " frames in each packet (audio buffer: "
+                  << mAudioBufferSize << " frames)" << std::endl;
+        std::cout << gPrintSeparator << std::endl;
+    }
 }
 
 
@@ -301,6 +396,58 @@ void JackTrip::setupRingBuffers()
 }
 
 
+//*******************************************************************************
+void JackTrip::setupCodec()
+{
+    delete mAudioCodec;
+    mAudioCodec = NULL;
+    switch (mCodec) {
+    case AudioCodec::PCM:
+        break;
+    case AudioCodec::OPUS:
+#ifdef __OPUS__
+        mAudioCodec = new OpusCodec(mNumChans, mSampleRate, mCodecFrameUsec, mCodecBitrate);
+        break;
+#else
+        throw std::invalid_argument("This JackTrip was built without Opus");
+#endif
+    case AudioCodec::BLOCKFLOAT:
+        mAudioCodec = new BlockFloatCodec(mNumChans, mAudioBufferSize, mCodecMantissaBits);
+        break;
+    case AudioCodec::HALFFLOAT:
+        mAudioCodec = new HalfFloatCodec(mNumChans, mAudioBufferSize);
+        break;
+    default:
+        throw std::invalid_argument("Codec undefined");
+        break;
+    }
+    mAudioInterface->setCodec(mAudioCodec);
+    if (mAudioCodec == NULL) { return; }
+#ifdef WAIR // WAIR
+    if (mNumNetRevChans) {
+        throw std::invalid_argument("Codecs can't be used with network reverb channels");
+    }
+#endif // endwhere
+
+    // Each packet holds a codec frame, whatever the audio buffer size
+    mSendPacketFrames = mAudioCodec->getFrames();
+    mReceivePacketFrames = mAudioCodec->getFrames();
+    if (mCodec == AudioCodec::OPUS) {
+        std::cout << "Coding the audio with Opus: " << mCodecBitrate / 1000 << " kb/s per channel, "
+                  << mCodecFrameUsec / 1000.0 << " ms packets of " << mAudioCodec->getPacketSize()
+                  << " bytes" << std::endl;
+    } else if (mCodec == AudioCodec::BLOCKFLOAT) {
+        std::cout << "Sending the audio in block floating point: " << mCodecMantissaBits
+                  << " bit mantissas, packets of " << mAudioCodec->getPacketSize()
+                  << " bytes" << std::endl;
+    } else {
+        std::cout << "Sending the audio in 16 bit floating point, packets of "
+                  << mAudioCodec->getPacketSize() << " bytes" << std::endl;
+    }
+    std::cout << gPrintSeparator << std::endl;
+}
+
+
 //*******************************************************************************
 void JackTrip::setPeerAddress(const char* PeerHostOrIP)
 {
@@ -349,6 +496,8 @@ void JackTrip::startProcess(
                 ID
             #endif // endwhere
                 );
+    setupPacketFrames();
+    setupCodec();
     //cc redundant with instance creator  createHeader(mPacketHeaderType); next line fixme
     createHeader(mPacketHeaderType);
     setupDataProtocol();
@@ -357,9 +506,16 @@ void JackTrip::startProcess(
     // -------------------------
     QObject::connect(mPacketHeader, SIGNAL(signalError(const char*)),
                      this, SLOT(slotStopProcesses()), Qt::QueuedConnection);
+    // After the connection, for the headers that check the settings
+    mPacketHeader->fillHeaderCommonFromAudio();
     QObject::connect(mDataProtocolReceiver, SIGNAL(signalReceivedConnectionFromPeer()),
                      this, SLOT(slotReceivedConnectionFromPeer()),
                      Qt::QueuedConnection);
+    QObject::connect(mDataProtocolReceiver, SIGNAL(signalPeerMigrated(const QString&, int)),
+                     this, SLOT(slotPeerMigrated(const QString&, int)),
+                     Qt::QueuedConnection);
+    QObject::connect(mDataProtocolReceiver, SIGNAL(signalPeerGone()),
+                     this, SLOT(slotPeerGone()), Qt::QueuedConnection);
     QObject::connect(this, SIGNAL(signalUdpTimeOut()),
                      this, SLOT(slotStopProcesses()), Qt::QueuedConnection);
 
@@ -379,6 +535,10 @@ void JackTrip::startProcess(
         break;
     case SERVER :
         if (gVerboseFlag) std::cout << "step 2s server only" << std::endl;
+        if ( !mMulticastGroup.isEmpty() ) {
+            multicastStart();
+            break;
+        }
         if (gVerboseFlag) std::cout << "  JackTrip:startProcess case SERVER before serverStart" << std::endl;
         serverStart();
         break;
@@ -410,15 +570,20 @@ void JackTrip::startProcess(
 #else
     int sock_fd = -1;
 #endif
-    mDataProtocolReceiver->setSocket(sock_fd);
+    // (A multicast source never receives, so it doesn't join the group.)
+    if (!mSendOnly) { mDataProtocolReceiver->setSocket(sock_fd); }
     mDataProtocolSender->setSocket(sock_fd);
 
     // Start Threads
-    if (gVerboseFlag) std::cout << "  JackTrip:startProcess before mDataProtocolReceiver->start" << std::endl;
-    mDataProtocolReceiver->start();
-    QThread::msleep(1);
-    if (gVerboseFlag) std::cout << "  JackTrip:startProcess before mDataProtocolSender->start" << std::endl;
-    mDataProtocolSender->start();
+    if (!mSendOnly) {
+        if (gVerboseFlag) std::cout << "  JackTrip:startProcess before mDataProtocolReceiver->start" << std::endl;
+        mDataProtocolReceiver->start();
+        QThread::msleep(1);
+    }
+    if (!mReceiveOnly) {
+        if (gVerboseFlag) std::cout << "  JackTrip:startProcess before mDataProtocolSender->start" << std::endl;
+        mDataProtocolSender->start();
+    }
     /*
      * changed order so that audio starts after receiver and sender
      * because UdpDataProtocol:run0 before setRealtimeProcessPriority()
@@ -482,8 +647,62 @@ void JackTrip::onStatTimer()
       << "/" << pkt_stat.revived
       << " tot: "
       << pkt_stat.tot
-      << " skew: " << skew
-      << endl;
+      << " skew: " << skew;
+    if (0 != pkt_stat.concealed) {
+        mIOStatLogStream << " conc: " << pkt_stat.concealed;
+    }
+    if (0 != pkt_stat.recovered) {
+        mIOStatLogStream << " fec: " << pkt_stat.recovered;
+    }
+    if (0 != pkt_stat.retransmitted) {
+        mIOStatLogStream << " nack: " << pkt_stat.retransmitted;
+    }
+    if (0 != pkt_stat.rttCount) {
+        mIOStatLogStream << " rtt: "
+          << QString::number(pkt_stat.rttMinMsec, 'f', 2).toLocal8Bit().constData()
+          << "/" << QString::number(pkt_stat.rttAvgMsec, 'f', 2).toLocal8Bit().constData()
+          << "/" << QString::number(pkt_stat.rttMaxMsec, 'f', 2).toLocal8Bit().constData()
+          << " ms lat: "
+          << QString::number(pkt_stat.latencyAvgMsec, 'f', 2).toLocal8Bit().constData()
+          << " ms";
+    }
+    if (0 != pkt_stat.migrations) {
+        mIOStatLogStream << " migr: " << pkt_stat.migrations
+          << "/" << pkt_stat.migrationGapMsec << " ms";
+    }
+    DataProtocol::SendStat send_stat;
+    if (mDataProtocolSender->getSendStats(&send_stat)) {
+        if (0 != send_stat.audioBytes) {
+            mIOStatLogStream << " dtx: " << send_stat.sentBytes << "/" << send_stat.audioBytes
+              << " B ("
+              << QString::number(100.0 * (send_stat.audioBytes - send_stat.sentBytes)
+                                 / send_stat.audioBytes, 'f', 1).toLocal8Bit().constData()
+              << "% saved)";
+        }
+        if (0 != send_stat.wireBits) {
+            mIOStatLogStream << " abr: " << static_cast<int>(send_stat.wireBits) << " bit ("
+              << send_stat.bitrateSwitches << " switches)";
+        }
+    }
+    mIOStatLogStream << endl;
+
+    QVector<DataProtocol::PathStat> path_stats;
+    if (mDataProtocolReceiver->getPathStats(&path_stats)) {
+        for (int i = 0; i < path_stats.size(); ++i) {
+            const DataProtocol::PathStat& path = path_stats[i];
+            mIOStatLogStream << now.toLocal8Bit().constData()
+              << " " << getPeerAddress().toLocal8Bit().constData()
+              << " path " << i << ": "
+              << path.address.toLocal8Bit().constData()
+              << " recv: " << path.received
+              << " first: " << path.firstArrivals
+              << " lost: " << path.lost
+              << " lag: " << QString::number(path.lagAvgMsec, 'f', 2).toLocal8Bit().constData()
+              << "/" << QString::number(path.lagMaxMsec, 'f', 2).toLocal8Bit().constData()
+              << " ms"
+              << endl;
+        }
+    }
 }
 
 //*******************************************************************************
@@ -497,6 +716,11 @@ void JackTrip::stop()
     mDataProtocolReceiver->stop();
     mDataProtocolReceiver->wait();
 
+    // Let the peer free the session now instead of waiting for a timeout
+    if (mReceivedConnection && !mSendOnly && !mReceiveOnly) {
+        mDataProtocolReceiver->sendGoodbye();
+    }
+
     // Stop the audio processes
     //mAudioInterface->stopProcess();
     closeAudio();
@@ -529,10 +753,32 @@ void JackTrip::clientStart()
         mDataProtocolReceiver->setPeerAddress( mPeerAddress.toLatin1().data() );
         cout << "Peer Address set to: " << mPeerAddress.toStdString() << std::endl;
         cout << gPrintSeparator << endl;
+        // A client of a multicast group is a listener only
+        if ( QHostAddress(mPeerAddress).isMulticast() ) {
+            mReceiveOnly = true;
+            cout << "Listening to multicast group: " << mPeerAddress.toStdString() << std::endl;
+            cout << gPrintSeparator << endl;
+        }
     }
 }
 
 
+//*******************************************************************************
+void JackTrip::multicastStart()
+{
+    if ( !QHostAddress(mMulticastGroup).isMulticast() ) {
+        throw std::invalid_argument("'" + mMulticastGroup.toStdString() + "' is not a multicast group address");
+    }
+    // Each packet is sent once to the group, whatever the number of listeners
+    mSendOnly = true;
+    mPeerAddress = mMulticastGroup;
+    mDataProtocolSender->setPeerAddress( mPeerAddress.toLatin1().data() );
+    cout << "Sending to multicast group: " << mPeerAddress.toStdString()
+         << " Port: " << mSenderPeerPort << std::endl;
+    cout << gPrintSeparator << endl;
+}
+
+
 //*******************************************************************************
 int JackTrip::serverStart(bool timeout, int udpTimeout) // udpTimeout unused
 {
@@ -630,6 +876,22 @@ int JackTrip::serverStart(bool timeout, int udpTimeout) // udpTimeout unused
 }
 
 
+//*******************************************************************************
+void JackTrip::setEncryptionKeys(const uint8_t* send_key, const uint8_t* receive_key)
+{
+    std::memcpy(mSendKey, send_key, PacketCipher::KeySize);
+    std::memcpy(mReceiveKey, receive_key, PacketCipher::KeySize);
+    mEncryption = true;
+    // The client gets the keys once the protocols exist
+    if (mDataProtocolSender != NULL) {
+        mDataProtocolSender->setEncryptionKeys(mSendKey, mReceiveKey);
+    }
+    if (mDataProtocolReceiver != NULL) {
+        mDataProtocolReceiver->setEncryptionKeys(mSendKey, mReceiveKey);
+    }
+}
+
+
 //*******************************************************************************
 int JackTrip::clientPingToServerStart()
 {
@@ -674,6 +936,13 @@ int JackTrip::clientPingToServerStart()
     std::memcpy(port_buf, &mReceiverBindPort, sizeof(mReceiverBindPort));
 
     tcpClient.write(port_buf, sizeof(mReceiverBindPort));
+    // With encryption, our half of the salt follows
+    uint8_t salt[2 * gCipherSaltSize];
+    bool encryption = !mEncryptionPassphrase.isEmpty();
+    if (encryption) {
+        PacketCipher::randomBytes(salt, gCipherSaltSize);
+        tcpClient.write(reinterpret_cast<const char*>(salt), gCipherSaltSize);
+    }
     while ( tcpClient.bytesToWrite() > 0 ) {
         tcpClient.waitForBytesWritten(-1);
     }
@@ -700,6 +969,23 @@ int JackTrip::clientPingToServerStart()
     std::memcpy(&udp_port, port_buf, size);
     //cout << "Received UDP Port Number: " << udp_port << endl;
 
+    // Read the server half of the salt, and derive the keys of both directions
+    // ------------------------------------------------------------------------
+    if (encryption) {
+        while (tcpClient.bytesAvailable() < gCipherSaltSize) {
+            if (!tcpClient.waitForReadyRead()) {
+                std::cerr << "TCP Socket ERROR: the server didn't answer the encryption handshake "
+                          << "(it must run with --encrypt too)" << endl;
+                return -1;
+            }
+        }
+        tcpClient.read(reinterpret_cast<char*>(salt + gCipherSaltSize), gCipherSaltSize);
+        uint8_t keys[2 * PacketCipher::KeySize];
+        PacketCipher::deriveKeys(mEncryptionPassphrase.toUtf8().constData(), salt, sizeof(salt),
+                                 gCipherKdfIterations, keys, sizeof(keys));
+        setEncryptionKeys(keys, keys + PacketCipher::KeySize);
+    }
+
     // Close the TCP Socket
     // --------------------
     tcpClient.close(); // Close the socket
@@ -841,24 +1127,43 @@ void JackTrip::createHeader(const DataProtocol::packetHeaderTypeT headertype)
     case DataProtocol::EMPTY :
         mPacketHeader = new EmptyHeader(this);
         break;
+    case DataProtocol::DEFAULT_V2 :
+        mPacketHeader = new DefaultHeaderV2(this);
+        break;
     default :
         throw std::invalid_argument("Undefined Header Type");
         break;
     }
+    // The per packet methods dispatch on the type without virtual calls
+    mPacketHeaderType = headertype;
+    mHeaderSizeInBytes = mPacketHeader->getHeaderSizeInBytes();
+    mHeaderHasLongSequenceNumbers = mPacketHeader->hasLongSequenceNumbers();
+    mHeaderHasEcho = mPacketHeader->hasEcho();
 }
 
 
 //*******************************************************************************
 void JackTrip::putHeaderInPacket(int8_t* full_packet, int8_t* audio_packet)
 {
-    mPacketHeader->fillHeaderCommonFromAudio();
-    mPacketHeader->putHeaderInPacket(full_packet);
+    // The fields that don't change were filled once, in startProcess
+    switch (mPacketHeaderType) {
+    case DataProtocol::DEFAULT :
+        static_cast<DefaultHeader*>(mPacketHeader)->setTimeStamp(getSendCaptureTime());
+        static_cast<DefaultHeader*>(mPacketHeader)->DefaultHeader::putHeaderInPacket(full_packet);
+        break;
+    case DataProtocol::DEFAULT_V2 :
+        static_cast<DefaultHeaderV2*>(mPacketHeader)->DefaultHeaderV2::putHeaderInPacket(full_packet);
+        break;
+    default :
+        mPacketHeader->putHeaderInPacket(full_packet);
+        break;
+    }
 
     int8_t* audio_part;
-    audio_part = full_packet + mPacketHeader->getHeaderSizeInBytes();
+    audio_part = full_packet + mHeaderSizeInBytes;
     //std::memcpy(audio_part, audio_packet, mAudioInterface->getBufferSizeInBytes());
     //std::memcpy(audio_part, audio_packet, mAudioInterface->getSizeInBytesPerChannel() * mNumChans);
-    std::memcpy(audio_part, audio_packet, getTotalAudioPacketSizeInBytes());
+    std::memcpy(audio_part, audio_packet, getSendAudioPacketSizeInBytes());
 }
 
 
@@ -868,8 +1173,16 @@ int JackTrip::getPacketSizeInBytes()
     //return (mAudioInterface->getBufferSizeInBytes() + mPacketHeader->getHeaderSizeInBytes());
     //return (mAudioInterface->getSizeInBytesPerChannel() * mNumChans  +
     //mPacketHeader->getHeaderSizeInBytes());
-    return (getTotalAudioPacketSizeInBytes()  +
-            mPacketHeader->getHeaderSizeInBytes());
+    return (getSendAudioPacketSizeInBytes()  +
+            mHeaderSizeInBytes);
+}
+
+
+//*******************************************************************************
+int JackTrip::getReceivePacketSizeInBytes()
+{
+    return (getReceiveAudioPacketSizeInBytes()  +
+            mHeaderSizeInBytes);
 }
 
 
@@ -877,10 +1190,167 @@ int JackTrip::getPacketSizeInBytes()
 void JackTrip::parseAudioPacket(int8_t* full_packet, int8_t* audio_packet)
 {
     int8_t* audio_part;
-    audio_part = full_packet + mPacketHeader->getHeaderSizeInBytes();
+    audio_part = full_packet + mHeaderSizeInBytes;
     //std::memcpy(audio_packet, audio_part, mAudioInterface->getBufferSizeInBytes());
     //std::memcpy(audio_packet, audio_part, mAudioInterface->getSizeInBytesPerChannel() * mNumChans);
-    std::memcpy(audio_packet, audio_part, getTotalAudioPacketSizeInBytes());
+    std::memcpy(audio_packet, audio_part, getReceiveAudioPacketSizeInBytes());
+}
+
+
+//*******************************************************************************
+// Packets keep the planar layout whatever frames they hold: each channel has
+// its packet frames back to back. The sender cuts them out of consecutive
+// periods, and the receiver joins them back into periods of its own size, so
+// packets can hold several periods, part of a period, or a peer period that
+// differs from ours.
+void JackTrip::readAudioBuffer(int8_t* ptrToReadSlot)
+{
+    // (The codec already sends packets of its frames)
+    if ( (mAudioCodec != NULL) || (mSendPacketFrames == mAudioBufferSize) ) {
+        mSendRingBuffer->readSlotBlocking(ptrToReadSlot, &mSendCaptureUsec);
+        return;
+    }
+    int channel_size = getSizeInBytesPerChannel();
+    int num_channels = getTotalAudioPacketSizeInBytes() / channel_size;
+    int sample_size = channel_size / mAudioBufferSize;
+    uint32_t frames = 0;
+    while (frames < mSendPacketFrames) {
+        if (mSendPeriodPos == mAudioBufferSize) {
+            mSendRingBuffer->readSlotBlocking(mSendPeriod.data(), &mSendPeriodUsec);
+            mSendPeriodPos = 0;
+        }
+        if (frames == 0) {
+            mSendCaptureUsec = (mSendPeriodUsec == 0) ? 0 :
+                    mSendPeriodUsec + static_cast<uint64_t>(mSendPeriodPos) * 1000000 / mSampleRate;
+        }
+        uint32_t n = std::min(mSendPacketFrames - frames, mAudioBufferSize - mSendPeriodPos);
+        for (int c = 0; c < num_channels; c++) {
+            std::memcpy(ptrToReadSlot + (c * mSendPacketFrames + frames) * sample_size,
+                        mSendPeriod.data() + (c * mAudioBufferSize + mSendPeriodPos) * sample_size,
+                        n * sample_size);
+        }
+        frames += n;
+        mSendPeriodPos += n;
+    }
+}
+
+
+//*******************************************************************************
+void JackTrip::writeAudioBuffer(const int8_t* ptrToSlot)
+{
+    if (mAudioCodec != NULL) {
+        mReceiveRingBuffer->insertSlotNonBlocking(ptrToSlot);
+        return;
+    }
+    if (mReceiveConverter != NULL) {
+        uint32_t stride = mReceiveConverter->getMaxOutputFrames(mReceivePacketFrames);
+        uint32_t frames = mReceiveConverter->convert(ptrToSlot, mReceivePacketFrames,
+                                                     mReceiveConverted.data(), stride);
+        joinReceiveFrames(mReceiveConverted.data(), frames, stride);
+        return;
+    }
+    if (mReceivePacketFrames == mAudioBufferSize) {
+        mReceiveRingBuffer->insertSlotNonBlocking(ptrToSlot);
+        return;
+    }
+    joinReceiveFrames(ptrToSlot, mReceivePacketFrames, mReceivePacketFrames);
+}
+
+
+//*******************************************************************************
+void JackTrip::joinReceiveFrames(const int8_t* frames_ptr, uint32_t frames, uint32_t stride)
+{
+    int channel_size = getSizeInBytesPerChannel();
+    int num_channels = getTotalAudioPacketSizeInBytes() / channel_size;
+    int sample_size = channel_size / mAudioBufferSize;
+    uint32_t done = 0;
+    while (done < frames) {
+        uint32_t n = std::min(frames - done, mAudioBufferSize - mReceivePeriodFill);
+        for (int c = 0; c < num_channels; c++) {
+            std::memcpy(mReceivePeriod.data() + (c * mAudioBufferSize + mReceivePeriodFill) * sample_size,
+                        frames_ptr + (c * stride + done) * sample_size,
+                        n * sample_size);
+        }
+        done += n;
+        mReceivePeriodFill += n;
+        if (mReceivePeriodFill == mAudioBufferSize) {
+            mReceiveRingBuffer->insertSlotNonBlocking(mReceivePeriod.data());
+            mReceivePeriodFill = 0;
+        }
+    }
+}
+
+
+//*******************************************************************************
+// Each side sends its own audio format and announces it in every header, so
+// there is nothing to negotiate: the receiver converts what the peer sends.
+void JackTrip::setReceiveFormat(int8_t* full_packet)
+{
+    // Headers without a buffer size (JamLink, empty) always carry one period
+    // in the local format
+    uint32_t peer_buffer_size = getPeerBufferSize(full_packet);
+    mReceivePacketFrames = (peer_buffer_size == 0) ? mAudioBufferSize : peer_buffer_size;
+    mReceivePeriodFill = 0;
+    mReceiveBitResolution = mAudioBitResolution;
+    mReceiveSampleRateType = getSampleRateType();
+    // (checkPeerSettings reports the formats that can't be converted)
+    uint8_t peer_bits = getPeerBitResolution(full_packet);
+    uint8_t peer_rate_type = getPeerSamplingRate(full_packet);
+    if ( (peer_buffer_size != 0) && (peer_bits % 8 == 0) &&
+         (peer_bits >= 8) && (peer_bits <= 32) && (peer_rate_type < AudioInterface::UNDEF) ) {
+        mReceiveBitResolution = static_cast<AudioInterface::audioBitResolutionT>(peer_bits / 8);
+        mReceiveSampleRateType = static_cast<AudioInterface::samplingRateT>(peer_rate_type);
+    }
+    delete mReceiveConverter;
+    mReceiveConverter = NULL;
+
+    int peer_rate = AudioInterface::getSampleRateFromType(mReceiveSampleRateType);
+
+    // Coded packets are decoded at the local rate by the audio interface. A peer
+    // with other settings sends packets of another duration.
+    if (mAudioCodec != NULL) {
+        mReceivePacketFrames = mAudioCodec->getFrames();
+        if ( (peer_buffer_size != 0) &&
+             ((static_cast<int>(peer_buffer_size) != mAudioCodec->getFrames()) || (peer_rate != getSampleRate())) ) {
+            std::cout << "WARNING: the peer sends " << peer_buffer_size << " frames at " << peer_rate
+                      << " Hz, the peer has to use the same codec settings" << std::endl;
+            std::cout << gPrintSeparator << std::endl;
+        }
+        return;
+    }
+    bool convert_rate = (mReceiveSampleRateType != getSampleRateType()) && (peer_rate > 0);
+    if ( (mReceiveBitResolution != mAudioBitResolution) || convert_rate ) {
+        int channel_size = getSizeInBytesPerChannel();
+        int num_channels = getTotalAudioPacketSizeInBytes() / channel_size;
+        mReceiveConverter = new AudioConverter(num_channels,
+                                               mReceiveBitResolution,
+                                               convert_rate ? peer_rate : getSampleRate(),
+                                               mAudioBitResolution, getSampleRate());
+        mReceiveConverted.resize(num_channels * mAudioBitResolution
+                                 * mReceiveConverter->getMaxOutputFrames(mReceivePacketFrames));
+        std::cout << "Converting the peer audio from " << mReceiveBitResolution * 8 << " bits";
+        if (convert_rate) { std::cout << " and " << peer_rate << " Hz"; }
+        std::cout << " to " << getAudioBitResolution() << " bits";
+        if (convert_rate) { std::cout << " and " << getSampleRate() << " Hz"; }
+        std::cout << std::endl;
+        std::cout << gPrintSeparator << std::endl;
+    }
+
+    // A packet can fill several periods at once
+    uint32_t frames = (mReceiveConverter != NULL) ?
+                mReceiveConverter->getMaxOutputFrames(mReceivePacketFrames) : mReceivePacketFrames;
+    int periods = (frames + mAudioBufferSize - 1) / mAudioBufferSize;
+    if (mReceivePacketFrames != mAudioBufferSize) {
+        std::cout << "Peer sends " << mReceivePacketFrames << " frames in each packet (audio buffer: "
+                  << mAudioBufferSize << " frames)" << std::endl;
+    }
+    if (periods >= mBufferQueueLength) {
+        std::cout << "WARNING: the queue (-q) is too short for the peer packets, set it to at least "
+                  << periods + 1 << std::endl;
+    }
+    if ( (mReceivePacketFrames != mAudioBufferSize) || (periods >= mBufferQueueLength) ) {
+        std::cout << gPrintSeparator << std::endl;
+    }
 }
 
 
@@ -891,6 +1361,25 @@ void JackTrip::checkPeerSettings(int8_t* full_packet)
 }
 
 
+//*******************************************************************************
+uint16_t JackTrip::getCapabilities() const
+{
+    uint16_t capabilities = 0;
+    if (mHeartbeat) { capabilities |= DataProtocol::CAP_HEARTBEAT; }
+    if (mMtu) { capabilities |= DataProtocol::CAP_FRAGMENTS; }
+    if (mFecGroupSize) { capabilities |= DataProtocol::CAP_FEC; }
+    if (mAdaptiveRedundancy) { capabilities |= DataProtocol::CAP_LOSS_REPORTS; }
+    if (mNack) { capabilities |= DataProtocol::CAP_NACK; }
+    if (mLossless) { capabilities |= DataProtocol::CAP_LOSSLESS; }
+    if (mCodec == AudioCodec::OPUS) { capabilities |= DataProtocol::CAP_OPUS; }
+    if (mCodec == AudioCodec::BLOCKFLOAT) { capabilities |= DataProtocol::CAP_BLOCKFLOAT; }
+    if (mDtx) { capabilities |= DataProtocol::CAP_DTX; }
+    if (mCodec == AudioCodec::HALFFLOAT) { capabilities |= DataProtocol::CAP_HALFFLOAT; }
+    if (mAdaptiveBitrateBits) { capabilities |= DataProtocol::CAP_ADAPTIVE_BITRATE; }
+    return capabilities;
+}
+
+
 //*******************************************************************************
 void JackTrip::checkIfPortIsBinded(int port)
 {
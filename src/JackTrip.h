@@ -43,16 +43,20 @@
 
 #include <QObject>
 #include <QString>
+#include <QStringList>
 #include <QUdpSocket>
 
 #include "DataProtocol.h"
 #include "AudioInterface.h"
+#include "AudioConverter.h"
+#include "AudioCodec.h"
 
 #ifndef __NO_JACK__
 #include "JackAudioInterface.h"
 #endif //__NO_JACK__
 
 #include "PacketHeader.h"
+#include "PacketCipher.h"
 #include "RingBuffer.h"
 
 #include <signal.h>
@@ -232,6 +236,71 @@ public:
     virtual void setNumChannels(int num_chans)
     { mNumChans = num_chans; }
 
+    /// \brief Runs the SERVER as a multicast source that sends to the group address
+    virtual void setMulticastGroup(const QString& group)
+    { mMulticastGroup = group; }
+    /// \brief Enables multipath mode (see UdpDataProtocol::setMultipath)
+    virtual void setMultipath(bool multipath, const QStringList& local_paths = QStringList())
+    { mMultipath = multipath; mMultipathLocalPaths = local_paths; }
+    /// \brief Enables heartbeat and goodbye packets (see UdpDataProtocol::setHeartbeat)
+    virtual void setHeartbeat(bool heartbeat)
+    { mHeartbeat = heartbeat; }
+    /// \brief Splits packets larger than the path MTU (see UdpDataProtocol::setMtu)
+    virtual void setMtu(int mtu)
+    { mMtu = mtu; }
+    /// \brief Sends several consecutive audio periods in each network packet
+    ///
+    /// The header BufferSize announces the frames in each packet, so the peer
+    /// splits them back into its own periods.
+    virtual void setAggregation(int aggregation)
+    { mAggregation = aggregation; }
+    /// \brief Splits each audio period into several network packets, each
+    /// with its own sequence number
+    virtual void setSplit(int split)
+    { mSplit = split; }
+    /// \brief Sends parity packets for groups of packets (see UdpDataProtocol::setFec)
+    virtual void setFec(int group_size, int parity_count)
+    { mFecGroupSize = group_size; mFecParityCount = parity_count; }
+    /// \brief Adapts the redundancy to the peer loss (see UdpDataProtocol::setAdaptiveRedundancy)
+    virtual void setAdaptiveRedundancy(bool adaptive)
+    { mAdaptiveRedundancy = adaptive; }
+    /// \brief Asks the peer for lost packets (see UdpDataProtocol::setNack)
+    virtual void setNack(bool nack)
+    { mNack = nack; }
+    /// \brief Codes the audio losslessly (see UdpDataProtocol::setLossless)
+    virtual void setLossless(bool lossless)
+    { mLossless = lossless; }
+    /// \brief Leaves the silent channels out of the packets (see UdpDataProtocol::setDtx)
+    virtual void setDtx(bool dtx, double gate_db)
+    { mDtx = dtx; mDtxGateDb = gate_db; }
+    /// \brief Lowers the bit resolution sent on congestion (see UdpDataProtocol::setAdaptiveBitrate)
+    virtual void setAdaptiveBitrate(int min_bits)
+    { mAdaptiveBitrateBits = min_bits; }
+    /** \brief Codes the network audio with a codec (see AudioCodec). Both sides
+   * have to use the same codec settings.
+   * \param codec Codec, AudioCodec::PCM to send PCM audio
+   * \param bitrate Bitrate of each channel, in bits/second (Opus)
+   * \param frame_usec Duration of each packet, in microseconds (Opus)
+   */
+    virtual void setCodec(AudioCodec::codecT codec, int bitrate, int frame_usec)
+    { mCodec = codec; mCodecBitrate = bitrate; mCodecFrameUsec = frame_usec; }
+    /** \brief Sends the audio in block floating point (see BlockFloatCodec), in
+   * packets of one period
+   * \param mantissa_bits Bits of each sample mantissa, 10 to 14
+   */
+    virtual void setBlockFloat(int mantissa_bits)
+    { mCodec = AudioCodec::BLOCKFLOAT; mCodecMantissaBits = mantissa_bits; }
+    /// \brief Encrypts the packets with keys derived from passphrase in the TCP
+    /// handshake with the hub server (CLIENTTOPINGSERVER mode)
+    virtual void setEncryptionPassphrase(const QString& passphrase)
+    { mEncryptionPassphrase = passphrase; }
+    /// \brief Encrypts the packets with these keys (PacketCipher::KeySize bytes each)
+    virtual void setEncryptionKeys(const uint8_t* send_key, const uint8_t* receive_key);
+    /// \brief Sends as many frames per packet as a peer that announces
+    /// peer_buffer_size frames per packet (the hub server follows its clients)
+    virtual void setPeerBufferSize(uint32_t peer_buffer_size)
+    { mPeerBufferSize = peer_buffer_size; }
+
     /// Set to connect or not default audio ports (only implemented in Jack)
     virtual void setConnectDefaultAudioPorts(bool connect)
     {mConnectDefaultAudioPorts = connect;}
@@ -267,7 +336,7 @@ public:
     { mPacketHeader = PacketHeader; }
 
     virtual int getRingBuffersSlotSize()
-    { return getTotalAudioPacketSizeInBytes(); }
+    { return (mAudioCodec != NULL) ? mAudioCodec->getPacketSize() : getTotalAudioPacketSizeInBytes(); }
 
     virtual void setAudiointerfaceMode(JackTrip::audiointerfaceModeT audiointerface_mode)
     { mAudiointerfaceMode = audiointerface_mode; }
@@ -316,16 +385,39 @@ public:
     void putHeaderInPacket(int8_t* full_packet, int8_t* audio_packet);
     virtual int getPacketSizeInBytes();
     void parseAudioPacket(int8_t* full_packet, int8_t* audio_packet);
-    virtual void sendNetworkPacket(const int8_t* ptrToSlot)
-    { mSendRingBuffer->insertSlotNonBlocking(ptrToSlot); }
-    virtual void receiveNetworkPacket(int8_t* ptrToReadSlot)
-    { mReceiveRingBuffer->readSlotNonBlocking(ptrToReadSlot); }
-    virtual void readAudioBuffer(int8_t* ptrToReadSlot)
-    { mSendRingBuffer->readSlotBlocking(ptrToReadSlot); }
-    virtual void writeAudioBuffer(const int8_t* ptrToSlot)
-    { mReceiveRingBuffer->insertSlotNonBlocking(ptrToSlot); }
+    /// \param capture_usec Capture time of the period, in PacketHeader::steadyUsecTime(), 0 if unknown
+    virtual void sendNetworkPacket(const int8_t* ptrToSlot, uint64_t capture_usec = 0)
+    { if (!mReceiveOnly) { mSendRingBuffer->insertSlotNonBlocking(ptrToSlot, capture_usec); } }
+    /// \return false if no packet arrived in time, the slot is filled for the underrun then
+    virtual bool receiveNetworkPacket(int8_t* ptrToReadSlot)
+    { return mReceiveRingBuffer->readSlotNonBlocking(ptrToReadSlot); }
+    virtual void readAudioBuffer(int8_t* ptrToReadSlot);
+    virtual void writeAudioBuffer(const int8_t* ptrToSlot);
     uint32_t getBufferSizeInSamples() const
     { return mAudioBufferSize; /*return mAudioInterface->getBufferSizeInSamples();*/ }
+    /// \brief Slots (audio periods) of the receiving audio buffer
+    int getBufferQueueLength() const
+    { return mBufferQueueLength; }
+    /// \brief Frames in each packet sent to the peer
+    uint32_t getSendPacketFrames() const
+    { return mSendPacketFrames; }
+    /// \brief Capture time of the first frame of the last packet read with readAudioBuffer(),
+    /// in PacketHeader::steadyUsecTime(), or the current time if unknown
+    uint64_t getSendCaptureTime() const
+    { return (mSendCaptureUsec != 0) ? mSendCaptureUsec : PacketHeader::steadyUsecTime(); }
+    /// \brief Frames in each packet received from the peer
+    uint32_t getReceivePacketFrames() const
+    { return mReceivePacketFrames; }
+    /// \brief Sets the frames, bit resolution and sampling rate of the peer
+    /// packets, from their header
+    void setReceiveFormat(int8_t* full_packet);
+    /// \brief Bit resolution of the peer audio, in bits
+    int getReceiveAudioBitResolution() const
+    { return mReceiveBitResolution*8; }
+    /// \brief Sampling rate of the peer audio
+    AudioInterface::samplingRateT getReceiveSampleRateType() const
+    { return mReceiveSampleRateType; }
+    int getReceivePacketSizeInBytes();
     uint32_t getDeviceID() const
     { return mDeviceID; /*return mAudioInterface->mDeviceID();*/ }
 
@@ -347,16 +439,92 @@ public:
         else { return 0; }
     }
     virtual void checkPeerSettings(int8_t* full_packet);
+    bool matchesPeerSettings(int8_t* full_packet) const
+    { return mPacketHeader->matchesPeerSettings(full_packet); }
+    // The methods called for every packet switch on the header type, fixed for
+    // the session, and call the header classes without virtual calls (see HeaderCodec)
     void increaseSequenceNumber()
-    { mPacketHeader->increaseSequenceNumber(); }
+    {
+        switch (mPacketHeaderType) {
+        case DataProtocol::DEFAULT :
+            static_cast<DefaultHeader*>(mPacketHeader)->DefaultHeader::increaseSequenceNumber();
+            break;
+        case DataProtocol::DEFAULT_V2 :
+            static_cast<DefaultHeaderV2*>(mPacketHeader)->DefaultHeaderV2::increaseSequenceNumber();
+            break;
+        default :
+            mPacketHeader->increaseSequenceNumber();
+            break;
+        }
+    }
     int getSequenceNumber() const
     { return mPacketHeader->getSequenceNumber(); }
 
     uint64_t getPeerTimeStamp(int8_t* full_packet) const
-    { return mPacketHeader->getPeerTimeStamp(full_packet); }
+    {
+        switch (mPacketHeaderType) {
+        case DataProtocol::DEFAULT : return HeaderCodec<DefaultHeader>::getTimeStamp(full_packet);
+        case DataProtocol::DEFAULT_V2 : return HeaderCodec<DefaultHeaderV2>::getTimeStamp(full_packet);
+        default : return HeaderCodec<PacketHeader>::getTimeStamp(full_packet);
+        }
+    }
+
+    /// \brief Time the peer sent a packet, in microseconds on its own clock (capture
+    /// time or media clock), -1 if the header has no time stamp
+    int64_t getPeerSendUsec(int8_t* full_packet) const
+    {
+        switch (mPacketHeaderType) {
+        case DataProtocol::DEFAULT :
+            return static_cast<int64_t>(HeaderCodec<DefaultHeader>::getTimeStamp(full_packet));
+        case DataProtocol::DEFAULT_V2 : {
+            int64_t rate = AudioInterface::getSampleRateFromType(mReceiveSampleRateType);
+            if (rate <= 0) { return -1; }
+            return static_cast<int64_t>(HeaderCodec<DefaultHeaderV2>::getTimeStamp(full_packet)) * 1000000 / rate; }
+        default : return -1;
+        }
+    }
 
     uint16_t getPeerSequenceNumber(int8_t* full_packet) const
-    { return mPacketHeader->getPeerSequenceNumber(full_packet); }
+    {
+        switch (mPacketHeaderType) {
+        case DataProtocol::DEFAULT : return HeaderCodec<DefaultHeader>::getSequenceNumber(full_packet);
+        case DataProtocol::DEFAULT_V2 : return HeaderCodec<DefaultHeaderV2>::getSequenceNumber(full_packet);
+        default : return HeaderCodec<PacketHeader>::getSequenceNumber(full_packet);
+        }
+    }
+
+    uint32_t getPeerLongSequenceNumber(int8_t* full_packet) const
+    {
+        switch (mPacketHeaderType) {
+        case DataProtocol::DEFAULT : return HeaderCodec<DefaultHeader>::getLongSequenceNumber(full_packet);
+        case DataProtocol::DEFAULT_V2 : return HeaderCodec<DefaultHeaderV2>::getLongSequenceNumber(full_packet);
+        default : return HeaderCodec<PacketHeader>::getLongSequenceNumber(full_packet);
+        }
+    }
+
+    bool hasLongSequenceNumbers() const
+    { return mHeaderHasLongSequenceNumbers; }
+
+    uint16_t getPeerCapabilities(int8_t* full_packet) const
+    { return mPacketHeader->getPeerCapabilities(full_packet); }
+
+    bool hasHeaderEcho() const
+    { return mHeaderHasEcho; }
+
+    void setHeaderEcho(uint32_t peer_time_stamp, uint32_t delay_usec)
+    {
+        if (mPacketHeaderType == DataProtocol::DEFAULT_V2) {
+            static_cast<DefaultHeaderV2*>(mPacketHeader)->DefaultHeaderV2::setEcho(peer_time_stamp, delay_usec);
+        } else {
+            mPacketHeader->setEcho(peer_time_stamp, delay_usec);
+        }
+    }
+
+    bool getPeerEcho(int8_t* full_packet, uint32_t& time_stamp, uint32_t& delay_usec) const
+    { return mPacketHeader->getPeerEcho(full_packet, time_stamp, delay_usec); }
+
+    /// \brief Returns the DataProtocol::capabilityT bits of the features set locally
+    uint16_t getCapabilities() const;
 
     uint16_t getPeerBufferSize(int8_t* full_packet) const
     { return mPacketHeader->getPeerBufferSize(full_packet); }
@@ -367,7 +535,7 @@ public:
     uint8_t getPeerBitResolution(int8_t* full_packet) const
     { return mPacketHeader->getPeerBitResolution(full_packet); }
 
-    uint8_t  getPeerNumChannels(int8_t* full_packet) const
+    uint16_t getPeerNumChannels(int8_t* full_packet) const
     { return mPacketHeader->getPeerNumChannels(full_packet); }
 
     uint8_t  getPeerConnectionMode(int8_t* full_packet) const
@@ -376,7 +544,7 @@ public:
     size_t getSizeInBytesPerChannel() const
     { return mAudioInterface->getSizeInBytesPerChannel(); }
     int getHeaderSizeInBytes() const
-    { return mPacketHeader->getHeaderSizeInBytes(); }
+    { return mHeaderSizeInBytes; }
     virtual int getTotalAudioPacketSizeInBytes() const
     {
 #ifdef WAIR // WAIR
@@ -386,6 +554,17 @@ public:
 #endif // endwhere
             return mAudioInterface->getSizeInBytesPerChannel() * mNumChans;
     }
+    int getSendAudioPacketSizeInBytes() const
+    {
+        if (mAudioCodec != NULL) { return mAudioCodec->getPacketSize(); }
+        return getTotalAudioPacketSizeInBytes() / mAudioBufferSize * mSendPacketFrames;
+    }
+    int getReceiveAudioPacketSizeInBytes() const
+    {
+        if (mAudioCodec != NULL) { return mAudioCodec->getPacketSize(); }
+        return getTotalAudioPacketSizeInBytes() / mAudioBufferSize / mAudioBitResolution
+                * mReceiveBitResolution * mReceivePacketFrames;
+    }
     //@}
     //------------------------------------------------------------------------------------
 
@@ -416,10 +595,20 @@ public slots:
             emit signalNoUdpPacketsForSeconds();
         }
     }
+    /// \brief The peer said goodbye or its heartbeats stopped, there's no need
+    /// to wait for the UDP timeout
+    void slotPeerGone()
+    {
+        std::cerr << "Peer is gone." << std::endl;
+        emit signalNoUdpPacketsForSeconds();
+    }
     void slotPrintTest()
     { std::cout << "=== TESTING ===" << std::endl; }
     void slotReceivedConnectionFromPeer()
     { mReceivedConnection = true; }
+    /// \brief Keeps the peer address up to date when the peer moves to a new address
+    void slotPeerMigrated(const QString& address, int /*port*/)
+    { mPeerAddress = address; }
     void onStatTimer();
 
 
@@ -428,7 +617,8 @@ signals:
     void signalUdpTimeOut();
     /// \brief Signal emitted when all the processes and threads are stopped
     void signalProcessesStopped();
-    /// \brief Signal emitted when no UDP Packets have been received for a while
+    /// \brief Signal emitted when no UDP Packets have been received for a while,
+    /// or when the peer is gone
     void signalNoUdpPacketsForSeconds();
     void signalTcpClientConnected();
 
@@ -443,12 +633,18 @@ public:
             );
     /// \brief Close the JackAudioInteface and disconnects it from JACK
     void closeAudio();
+    /// \brief Set the frames in each network packet (after setupAudio)
+    void setupPacketFrames();
+    /// \brief Create the codec of the network audio, if any (after setupAudio)
+    void setupCodec();
     /// \brief Set the DataProtocol objects
     virtual void setupDataProtocol();
     /// \brief Set the RingBuffer objects
     void setupRingBuffers();
     /// \brief Starts for the CLIENT mode
     void clientStart();
+    /// \brief Starts the SERVER mode as a multicast source
+    void multicastStart();
     /// \brief Starts for the SERVER mode
     /// \param timout Set the server to timeout after 2 seconds if no client connections are received.
     /// Usefull for the multithreaded server
@@ -463,10 +659,17 @@ private:
     //                       QHostAddress PeerHostAddress, int peer_port)
     //throw(std::runtime_error);
 
+    /// \brief Joins planar frames in the local format into periods of the receive RingBuffer
+    /// \param stride Frames of each channel in frames_ptr
+    void joinReceiveFrames(const int8_t* frames_ptr, uint32_t frames, uint32_t stride);
+
 
     jacktripModeT mJackTripMode; ///< JackTrip::jacktripModeT
     dataProtocolT mDataProtocol; ///< Data Protocol Tipe
     DataProtocol::packetHeaderTypeT mPacketHeaderType; ///< Packet Header Type
+    int mHeaderSizeInBytes; ///< Size of mPacketHeader, fixed for its type
+    bool mHeaderHasLongSequenceNumbers; ///< mPacketHeader has 32-bit sequence numbers
+    bool mHeaderHasEcho; ///< mPacketHeader echoes the peer time stamps
     JackTrip::audiointerfaceModeT mAudiointerfaceMode;
 
     int mNumChans; ///< Number of Channels (inputs = outputs)
@@ -500,6 +703,45 @@ private:
     int mTcpServerPort;
 
     unsigned int mRedundancy; ///< Redundancy factor in network data
+    bool mMultipath; ///< Multipath mode
+    QStringList mMultipathLocalPaths; ///< Local addresses used to send packet copies
+    QString mMulticastGroup; ///< Multicast group to send to in SERVER mode
+    bool mSendOnly; ///< Multicast source, nothing is received
+    bool mReceiveOnly; ///< Multicast listener, nothing is sent
+    bool mHeartbeat; ///< Send heartbeat and goodbye packets
+    int mMtu; ///< Path MTU to split packets for, 0 to send them whole
+    int mAggregation; ///< Audio periods sent in each packet
+    int mSplit; ///< Packets sent for each audio period
+    int mFecGroupSize; ///< Packets per FEC group, 0 without FEC
+    int mFecParityCount; ///< Parity packets per FEC group
+    bool mAdaptiveRedundancy; ///< Adapt the redundancy to the peer loss, up to mRedundancy
+    bool mNack; ///< Ask the peer for lost packets
+    bool mLossless; ///< Code the audio losslessly
+    bool mDtx; ///< Leave the silent channels out of the packets
+    double mDtxGateDb; ///< Peak level under which a channel is silent, in dBFS
+    int mAdaptiveBitrateBits; ///< Lowest bit resolution sent on congestion, 0 to send the session one
+    AudioCodec::codecT mCodec; ///< Codec of the network audio
+    int mCodecBitrate; ///< Bitrate of each channel with a codec, in bits/second
+    int mCodecFrameUsec; ///< Duration of each packet with a codec, in microseconds
+    int mCodecMantissaBits; ///< Mantissa bits of the block floating point codec
+    AudioCodec* mAudioCodec; ///< Codec of the network audio, NULL for PCM
+    QString mEncryptionPassphrase; ///< Passphrase for the hub server handshake
+    bool mEncryption; ///< Encrypt the packets
+    uint8_t mSendKey[PacketCipher::KeySize]; ///< Key of the packets to the peer
+    uint8_t mReceiveKey[PacketCipher::KeySize]; ///< Key of the packets from the peer
+    uint32_t mSendPacketFrames; ///< Frames in each packet sent to the peer
+    uint32_t mReceivePacketFrames; ///< Frames in each packet from the peer
+    uint32_t mPeerBufferSize; ///< Frames per packet announced by the peer, 0 if unknown
+    QVector<int8_t> mSendPeriod; ///< Period read from the send RingBuffer (sender thread)
+    uint32_t mSendPeriodPos; ///< Frames of mSendPeriod already sent
+    uint64_t mSendPeriodUsec; ///< Capture time of mSendPeriod, 0 if unknown
+    uint64_t mSendCaptureUsec; ///< Capture time of the packet read last, 0 if unknown
+    QVector<int8_t> mReceivePeriod; ///< Period rebuilt from peer packets (receiver thread)
+    uint32_t mReceivePeriodFill; ///< Frames of mReceivePeriod already received
+    AudioInterface::audioBitResolutionT mReceiveBitResolution; ///< Bit resolution of the peer audio
+    AudioInterface::samplingRateT mReceiveSampleRateType; ///< Sampling rate of the peer audio
+    AudioConverter* mReceiveConverter; ///< Converts the peer audio, NULL if it has the local format
+    QVector<int8_t> mReceiveConverted; ///< Peer packet in the local format (receiver thread)
     const char* mJackClientName; ///< JackAudio Client Name
 
     JackTrip::connectionModeT mConnectionMode; ///< Connection Mode
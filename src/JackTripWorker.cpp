@@ -37,6 +37,7 @@
 
 #include <iostream>
 #include <unistd.h>
+#include <cstring>
 
 #include <QTimer>
 #include <QMutexLocker>
@@ -45,6 +46,7 @@
 #include "JackTripWorker.h"
 #include "JackTrip.h"
 #include "UdpHubListener.h"
+#include "UdpDataProtocol.h"
 #include "NetKS.h"
 #include "LoopBack.h"
 #include "Settings.h"
@@ -64,6 +66,7 @@ JackTripWorker::JackTripWorker(UdpHubListener* udpmasterlistener, int BufferQueu
     mBufferQueueLength(BufferQueueLength),
     mUnderRunMode(UnderRunMode),
     mSpawning(false),
+    mEncryption(false),
     mID(0),
     mNumChans(1)
   #ifdef WAIR // wair
@@ -107,6 +110,15 @@ void JackTripWorker::setJackTrip(int id,
 }
 
 
+//*******************************************************************************
+void JackTripWorker::setEncryptionKeys(const uint8_t* send_key, const uint8_t* receive_key)
+{
+    std::memcpy(mSendKey, send_key, PacketCipher::KeySize);
+    std::memcpy(mReceiveKey, receive_key, PacketCipher::KeySize);
+    mEncryption = true;
+}
+
+
 //*******************************************************************************
 void JackTripWorker::run()
 {
@@ -185,6 +197,37 @@ void JackTripWorker::run()
         // Set our underrun mode
         jacktrip.setUnderRunMode(mUnderRunMode);
 
+        // Accept (and send) packet copies over several paths
+        if (settings->isMultipath()) {
+            jacktrip.setMultipath(true, settings->getMultipathLocalPaths());
+        }
+
+        // Heartbeats are also sent to the clients that send them
+        jacktrip.setHeartbeat(settings->isHeartbeat());
+        jacktrip.setMtu(settings->getMtu());
+        jacktrip.setAggregation(settings->getAggregation());
+        jacktrip.setSplit(settings->getSplit());
+        jacktrip.setFec(settings->getFecGroupSize(), settings->getFecParityCount());
+        // Loss reports are also sent to the clients that send them
+        jacktrip.setAdaptiveRedundancy(settings->isAdaptiveRedundancy());
+        jacktrip.setNack(settings->isNack());
+        jacktrip.setLossless(settings->isLossless());
+        if (settings->getOpusBitrate()) {
+            jacktrip.setCodec(AudioCodec::OPUS, settings->getOpusBitrate() * 1000,
+                              settings->getOpusFrameUsec());
+        }
+        if (settings->getBlockFloatBits()) {
+            jacktrip.setBlockFloat(settings->getBlockFloatBits());
+        }
+        if (settings->isHalfFloat()) {
+            jacktrip.setCodec(AudioCodec::HALFFLOAT, 0, 0);
+        }
+        jacktrip.setDtx(settings->isDtx(), settings->getDtxGateDb());
+        jacktrip.setAdaptiveBitrate(settings->getAdaptiveBitrateBits());
+        if (mEncryption) {
+            jacktrip.setEncryptionKeys(mSendKey, mReceiveKey);
+        }
+
         // Connect signals and slots
         // -------------------------
         if (gVerboseFlag) cout << "---> JackTripWorker: Connecting signals and slots..." << endl;
@@ -305,8 +348,23 @@ int JackTripWorker::setJackTripFromClientHeader(JackTrip& jacktrip)
     char packet[packet_size];
     UdpSockTemp.readDatagram(packet, packet_size);
     UdpSockTemp.close(); // close the socket
+    // With encryption, the header can only be read once the packet is authenticated
+    if (mEncryption) {
+        packet_size = UdpDataProtocol::openPacket(PacketCipher(mReceiveKey), packet, packet_size);
+        if (packet_size < 0) {
+            std::cerr << "--->JackTripWorker: the first packet of the client fails authentication "
+                      << "(is the --encrypt passphrase the same?)" << endl;
+            return -1;
+        }
+    }
     int8_t* full_packet = reinterpret_cast<int8_t*>(packet);
 
+    // Answer each client with its own header version
+    if ( DefaultHeaderV2::isVersion2(full_packet, packet_size) ) {
+        cout << "--->JackTripWorker: the client sends version 2 headers" << endl;
+        jacktrip.setPacketHeaderType(DataProtocol::DEFAULT_V2);
+    }
+
     int PeerBufferSize = jacktrip.getPeerBufferSize(full_packet);
     int PeerSamplingRate = jacktrip.getPeerSamplingRate(full_packet);
     int PeerBitResolution = jacktrip.getPeerBitResolution(full_packet);
@@ -320,6 +378,8 @@ int JackTripWorker::setJackTripFromClientHeader(JackTrip& jacktrip)
     if (gVerboseFlag) cout << "--->JackTripWorker: getPeerConnectionMode = " << PeerConnectionMode << endl;
 
     jacktrip.setNumChannels(PeerNumChannels);
+    // Unless the hub sets its own, answer with as many frames per packet as the client
+    jacktrip.setPeerBufferSize(PeerBufferSize);
     return PeerConnectionMode;
 }
 
@@ -90,6 +90,10 @@ public:
                      int num_channels,
                      bool connectDefaultAudioPorts
                      );
+    /// \brief Encrypts the session with keys agreed in the TCP handshake
+    /// \param send_key Key of the server to client direction
+    /// \param receive_key Key of the client to server direction
+    void setEncryptionKeys(const uint8_t* send_key, const uint8_t* receive_key);
     /// Stop and remove thread from pool
     void stopThread();
     int getID()
@@ -127,6 +131,10 @@ private:
     JackTrip::underrunModeT mUnderRunMode;
     int mBufferQueueLength;
 
+    bool mEncryption; ///< Encrypt the session with the keys below
+    uint8_t mSendKey[PacketCipher::KeySize];
+    uint8_t mReceiveKey[PacketCipher::KeySize];
+
     int mID; ///< ID thread number
     int mNumChans; ///< Number of Channels
 #ifdef WAIR // wair
@@ -0,0 +1,376 @@
+//*****************************************************************
+/*
+  JackTrip: A System for High-Quality Audio Network Performance
+  over the Internet
+
+  Copyright (c) 2008 Juan-Pablo Caceres, Chris Chafe.
+  SoundWIRE group at CCRMA, Stanford University.
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation
+  files (the "Software"), to deal in the Software without
+  restriction, including without limitation the rights to use,
+  copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following
+  conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+*/
+//*****************************************************************
+
+
+/**
+ * \file LosslessCodec.cpp
+ * \date October 2026
+ */
+
+#include "LosslessCodec.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+// The SSSE3 code is compiled for every x86 build and used only if the
+// processor has it
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__)
+#define LOSSLESS_X86
+#include <tmmintrin.h>
+#endif
+
+namespace {
+
+// Each channel starts with a 3-bit mode (predictor order, or verbatim) and a
+// 5-bit Rice parameter
+const int sModeBits = 3;
+const int sRiceBits = 5;
+const uint32_t sVerbatimMode = 7;
+const int sMaxOrder = 3;
+const int sMaxRice = 24;
+// Quotients this large are sent as that many ones and the 32-bit value
+const uint32_t sEscapeQuotient = 24;
+
+/// \brief Writes bits, most significant first, and counts the ones that don't fit
+struct BitWriter {
+    uint8_t* out;
+    int size;
+    int pos;
+    uint64_t acc;
+    int bits;
+
+    BitWriter(int8_t* output, int output_size) :
+        out(reinterpret_cast<uint8_t*>(output)), size(output_size), pos(0), acc(0), bits(0) {}
+
+    /// \brief Writes the low n bits of value, n <= 32
+    void put(uint32_t value, int n) {
+        acc = (acc << n) | (value & ((uint64_t(1) << n) - 1));
+        bits += n;
+        while (bits >= 8) {
+            bits -= 8;
+            if (pos < size) { out[pos] = static_cast<uint8_t>(acc >> bits); }
+            ++pos;
+        }
+    }
+    /// \brief Pads the last byte with zeros, returns the bytes written (more than size if they didn't fit)
+    int flush() {
+        if (bits > 0) { put(0, 8 - bits); }
+        return pos;
+    }
+};
+
+/// \brief Reads bits, most significant first, without reading past the end
+struct BitReader {
+    const uint8_t* in;
+    int size;
+    int pos;
+    uint64_t acc;
+    int bits;
+    bool overrun;
+
+    BitReader(const int8_t* input, int input_size) :
+        in(reinterpret_cast<const uint8_t*>(input)), size(input_size), pos(0), acc(0), bits(0),
+        overrun(false) {}
+
+    /// \brief Reads n bits, n <= 32
+    uint32_t get(int n) {
+        while (bits < n) {
+            if (pos < size) { acc = (acc << 8) | in[pos++]; }
+            else { acc <<= 8; overrun = true; }
+            bits += 8;
+        }
+        bits -= n;
+        return static_cast<uint32_t>( (acc >> bits) & ((uint64_t(1) << n) - 1) );
+    }
+};
+
+inline uint32_t zigzag(int32_t e)
+{ return (static_cast<uint32_t>(e) << 1) ^ static_cast<uint32_t>(e >> 31); }
+
+inline int32_t unzigzag(uint32_t z)
+{ return static_cast<int32_t>(z >> 1) ^ -static_cast<int32_t>(z & 1); }
+
+/// \brief Prediction of x[n] with the fixed predictor of an order
+inline int64_t predict(const int32_t* x, int n, int order)
+{
+    switch (order) {
+    case 1 : return x[n-1];
+    case 2 : return 2 * int64_t(x[n-1]) - x[n-2];
+    case 3 : return 3 * (int64_t(x[n-1]) - x[n-2]) + x[n-3];
+    default : return 0;
+    }
+}
+
+#if defined (LOSSLESS_X86)
+bool hasSsse3()
+{
+    static const bool ssse3 = ( __builtin_cpu_init(), __builtin_cpu_supports("ssse3") );
+    return ssse3;
+}
+
+/// \brief Adds the absolute residuals of the orders 0 to 3 from sample n (at
+/// least sMaxOrder) to sums, and returns the sample it stopped at
+__attribute__((target("ssse3")))
+int residualSumsSsse3(const int32_t* x, int n, int num_frames, uint64_t* sums)
+{
+    // 4 samples at a time from n, the 4 residuals are differences of
+    // differences. The absolute values are added in 64 bits, so any number of
+    // frames fits.
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc[sMaxOrder + 1];
+    for (int order = 0; order <= sMaxOrder; order++) { acc[order] = zero; }
+    for (; n + 4 <= num_frames; n += 4) {
+        __m128i x0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + n));
+        __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + n - 1));
+        __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + n - 2));
+        __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + n - 3));
+        __m128i d1 = _mm_sub_epi32(x1, x2);
+        __m128i e[sMaxOrder + 1];
+        e[0] = x0;
+        e[1] = _mm_sub_epi32(x0, x1);
+        e[2] = _mm_sub_epi32(e[1], d1);
+        e[3] = _mm_sub_epi32(e[2], _mm_sub_epi32(d1, _mm_sub_epi32(x2, x3)));
+        for (int order = 0; order <= sMaxOrder; order++) {
+            __m128i a = _mm_abs_epi32(e[order]);
+            acc[order] = _mm_add_epi64(acc[order], _mm_unpacklo_epi32(a, zero));
+            acc[order] = _mm_add_epi64(acc[order], _mm_unpackhi_epi32(a, zero));
+        }
+    }
+    for (int order = 0; order <= sMaxOrder; order++) {
+        uint64_t lanes[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc[order]);
+        sums[order] += lanes[0] + lanes[1];
+    }
+    return n;
+}
+#endif
+
+} // namespace
+
+
+//*******************************************************************************
+LosslessCodec::LosslessCodec(int NumChannels, int BytesPerSample, int NumFrames) :
+    mNumChannels(NumChannels),
+    mBytesPerSample(BytesPerSample),
+    mNumFrames(NumFrames)
+{
+    if ( (NumChannels < 1) || (NumFrames < 1) || !isSupported(BytesPerSample) ) {
+        throw std::invalid_argument("Lossless coding needs 8, 16 or 24 bit audio, with channels and frames");
+    }
+    mSamples.resize(mNumFrames);
+}
+
+
+//*******************************************************************************
+void LosslessCodec::readSamples(const int8_t* audio, int32_t* x) const
+{
+    switch (mBytesPerSample) {
+    case 1 :
+        for (int n = 0; n < mNumFrames; n++) { x[n] = audio[n]; }
+        break;
+    case 2 :
+        for (int n = 0; n < mNumFrames; n++) {
+            int16_t s;
+            std::memcpy(&s, audio + 2*n, 2);
+            x[n] = s;
+        }
+        break;
+    default :
+        // 24 bits are a 16-bit sample and an unsigned 8-bit remainder (AudioInterface::BIT24)
+        for (int n = 0; n < mNumFrames; n++) {
+            int16_t s;
+            std::memcpy(&s, audio + 3*n, 2);
+            x[n] = s * 256 + static_cast<uint8_t>(audio[3*n + 2]);
+        }
+        break;
+    }
+}
+
+
+//*******************************************************************************
+void LosslessCodec::writeSamples(const int32_t* x, int8_t* audio) const
+{
+    switch (mBytesPerSample) {
+    case 1 :
+        for (int n = 0; n < mNumFrames; n++) { audio[n] = static_cast<int8_t>(x[n]); }
+        break;
+    case 2 :
+        for (int n = 0; n < mNumFrames; n++) {
+            int16_t s = static_cast<int16_t>(x[n]);
+            std::memcpy(audio + 2*n, &s, 2);
+        }
+        break;
+    default :
+        for (int n = 0; n < mNumFrames; n++) {
+            int16_t s = static_cast<int16_t>(x[n] >> 8);
+            std::memcpy(audio + 3*n, &s, 2);
+            audio[3*n + 2] = static_cast<int8_t>(x[n] & 0xFF);
+        }
+        break;
+    }
+}
+
+
+//*******************************************************************************
+void LosslessCodec::residualSums(const int32_t* x, uint64_t* sums) const
+{
+    for (int order = 0; order <= sMaxOrder; order++) { sums[order] = 0; }
+
+    // The first samples use the orders their history allows
+    int n = 0;
+    for (; (n < sMaxOrder) && (n < mNumFrames); n++) {
+        for (int order = 0; order <= sMaxOrder; order++) {
+            int64_t e = x[n] - predict(x, n, std::min(n, order));
+            sums[order] += (e < 0) ? -e : e;
+        }
+    }
+#if defined (LOSSLESS_X86)
+    if (hasSsse3()) { n = residualSumsSsse3(x, n, mNumFrames, sums); }
+#endif
+    for (; n < mNumFrames; n++) {
+        for (int order = 0; order <= sMaxOrder; order++) {
+            int64_t e = x[n] - predict(x, n, order);
+            sums[order] += (e < 0) ? -e : e;
+        }
+    }
+}
+
+
+//*******************************************************************************
+int LosslessCodec::encode(const int8_t* audio, int8_t* output)
+{
+    const int audio_size = getAudioSize();
+    const int sample_bits = 8 * mBytesPerSample;
+    const int channel_size = mNumFrames * mBytesPerSample;
+    int32_t* x = mSamples.data();
+    BitWriter writer(output, audio_size);
+
+    for (int ch = 0; ch < mNumChannels; ch++) {
+        readSamples(audio + ch * channel_size, x);
+
+        uint64_t sums[sMaxOrder + 1];
+        residualSums(x, sums);
+        int order = 0;
+        for (int o = 1; o <= sMaxOrder; o++) {
+            if (sums[o] < sums[order]) { order = o; }
+        }
+        // The zigzag residuals average twice the absolute ones, k is about
+        // log2 of that average
+        uint64_t zigzag_sum = 2 * sums[order];
+        int k = 0;
+        while ( (k < sMaxRice) &&
+                ((static_cast<uint64_t>(mNumFrames) << (k + 1)) <= zigzag_sum) ) { ++k; }
+
+        // Estimated size, channels that don't shrink are stored verbatim
+        uint64_t estimate = static_cast<uint64_t>(mNumFrames) * (k + 1) + (zigzag_sum >> k);
+        if ( estimate >= static_cast<uint64_t>(mNumFrames) * sample_bits ) {
+            writer.put(sVerbatimMode, sModeBits);
+            writer.put(0, sRiceBits);
+            for (int n = 0; n < mNumFrames; n++) {
+                writer.put(static_cast<uint32_t>(x[n]), sample_bits);
+            }
+            continue;
+        }
+
+        writer.put(order, sModeBits);
+        writer.put(k, sRiceBits);
+        for (int n = 0; n < mNumFrames; n++) {
+            int32_t e = static_cast<int32_t>( x[n] - predict(x, n, std::min(n, order)) );
+            uint32_t z = zigzag(e);
+            uint32_t q = z >> k;
+            if (q < sEscapeQuotient) {
+                // q ones and a zero, then the k low bits
+                writer.put( (1u << (q + 1)) - 2, q + 1 );
+                if (k > 0) { writer.put(z, k); }
+            } else {
+                writer.put( (1u << sEscapeQuotient) - 1, sEscapeQuotient );
+                writer.put(z, 32);
+            }
+        }
+        // Stop early if the packet can't shrink anymore
+        if (writer.pos >= audio_size) { break; }
+    }
+
+    int coded_size = writer.flush();
+    if (coded_size >= audio_size) {
+        std::memcpy(output, audio, audio_size);
+        return audio_size;
+    }
+    return coded_size;
+}
+
+
+//*******************************************************************************
+bool LosslessCodec::decode(const int8_t* input, int input_size, int8_t* audio)
+{
+    const int audio_size = getAudioSize();
+    if (input_size == audio_size) {
+        std::memcpy(audio, input, audio_size);
+        return true;
+    }
+    if ( (input_size <= 0) || (input_size > audio_size) ) { return false; }
+
+    const int sample_bits = 8 * mBytesPerSample;
+    const int channel_size = mNumFrames * mBytesPerSample;
+    const int64_t max_sample = (int64_t(1) << (sample_bits - 1)) - 1;
+    const int64_t min_sample = -max_sample - 1;
+    int32_t* x = mSamples.data();
+    BitReader reader(input, input_size);
+
+    for (int ch = 0; ch < mNumChannels; ch++) {
+        uint32_t mode = reader.get(sModeBits);
+        int k = static_cast<int>( reader.get(sRiceBits) );
+        if (mode == sVerbatimMode) {
+            for (int n = 0; n < mNumFrames; n++) {
+                // Sign extend
+                uint32_t v = reader.get(sample_bits);
+                x[n] = static_cast<int32_t>(v << (32 - sample_bits)) >> (32 - sample_bits);
+            }
+        } else {
+            int order = static_cast<int>(mode);
+            if ( (order > sMaxOrder) || (k > sMaxRice) ) { return false; }
+            for (int n = 0; n < mNumFrames; n++) {
+                uint32_t q = 0;
+                while ( (q < sEscapeQuotient) && reader.get(1) ) { ++q; }
+                uint32_t z = (q == sEscapeQuotient) ? reader.get(32)
+                                                   : ( (q << k) | (k > 0 ? reader.get(k) : 0) );
+                int64_t sample = unzigzag(z) + predict(x, n, std::min(n, order));
+                if ( (sample < min_sample) || (sample > max_sample) || reader.overrun ) {
+                    return false;
+                }
+                x[n] = static_cast<int32_t>(sample);
+            }
+        }
+        if (reader.overrun) { return false; }
+        writeSamples(x, audio + ch * channel_size);
+    }
+    return true;
+}
@@ -0,0 +1,108 @@
+//*****************************************************************
+/*
+  JackTrip: A System for High-Quality Audio Network Performance
+  over the Internet
+
+  Copyright (c) 2008 Juan-Pablo Caceres, Chris Chafe.
+  SoundWIRE group at CCRMA, Stanford University.
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation
+  files (the "Software"), to deal in the Software without
+  restriction, including without limitation the rights to use,
+  copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following
+  conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+*/
+//*****************************************************************
+
+
+/**
+ * \file LosslessCodec.h
+ * \date October 2026
+ */
+
+#ifndef __LOSSLESSCODEC_H__
+#define __LOSSLESSCODEC_H__
+
+#include <QVector>
+
+#include "jacktrip_types.h"
+
+
+/** \brief Lossless compression of the audio of one packet, with no lookahead.
+ *
+ * Each channel is predicted with the fixed polynomial predictor (order 0 to 3)
+ * that leaves the smallest residuals, and the residuals are Rice coded. The
+ * first samples of a channel use the orders their history allows, so packets
+ * are coded on their own and a lost packet doesn't affect the next ones.
+ *
+ * A channel that doesn't shrink is stored verbatim, and a packet that doesn't
+ * shrink is sent raw (encode() returns the audio size then). Only 8, 16 and 24
+ * bit audio is coded, 32 bit float audio is always raw.
+ *
+ * Audio is planar, like the packets: each channel has its frames back to back.
+ */
+class LosslessCodec
+{
+public:
+
+    /** \brief The class constructor
+   * \param NumChannels Number of channels
+   * \param BytesPerSample Bytes per sample in the packets (AudioInterface::audioBitResolutionT)
+   * \param NumFrames Frames of each channel in a packet
+   */
+    LosslessCodec(int NumChannels, int BytesPerSample, int NumFrames);
+
+    /// \brief Audio can be coded in this bit resolution
+    static bool isSupported(int BytesPerSample)
+    { return (BytesPerSample >= 1) && (BytesPerSample <= 3); }
+
+    int getNumChannels() const { return mNumChannels; }
+    int getBytesPerSample() const { return mBytesPerSample; }
+    int getNumFrames() const { return mNumFrames; }
+    /// \brief Size of the raw audio of a packet, the most encode() writes
+    int getAudioSize() const { return mNumChannels * mNumFrames * mBytesPerSample; }
+
+    /** \brief Codes the audio of a packet
+   * \param audio Raw audio, getAudioSize() bytes
+   * \param output Returns the coded audio, room for getAudioSize() bytes
+   * \return Size of the coded audio, getAudioSize() if the audio is copied raw
+   */
+    int encode(const int8_t* audio, int8_t* output);
+
+    /** \brief Decodes the audio of a packet
+   * \param input Coded audio
+   * \param input_size Size of the coded audio, getAudioSize() if it's raw
+   * \param audio Returns the raw audio, getAudioSize() bytes
+   * \return false if the coded audio is corrupted
+   */
+    bool decode(const int8_t* input, int input_size, int8_t* audio);
+
+private:
+
+    /// \brief Sums of the absolute residuals of the predictors of order 0 to 3
+    void residualSums(const int32_t* x, uint64_t* sums) const;
+    void readSamples(const int8_t* audio, int32_t* x) const;
+    void writeSamples(const int32_t* x, int8_t* audio) const;
+
+    int mNumChannels; ///< Number of channels
+    int mBytesPerSample; ///< Bytes per sample
+    int mNumFrames; ///< Frames of each channel
+    QVector<int32_t> mSamples; ///< Samples of a channel
+};
+
+#endif //__LOSSLESSCODEC_H__
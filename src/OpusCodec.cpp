@@ -0,0 +1,134 @@
+//*****************************************************************
+/*
+  JackTrip: A System for High-Quality Audio Network Performance
+  over the Internet
+
+  Copyright (c) 2008 Juan-Pablo Caceres, Chris Chafe.
+  SoundWIRE group at CCRMA, Stanford University.
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation
+  files (the "Software"), to deal in the Software without
+  restriction, including without limitation the rights to use,
+  copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following
+  conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+*/
+//*****************************************************************
+
+
+/**
+ * \file OpusCodec.cpp
+ * \date October 2026
+ */
+
+#include "OpusCodec.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+
+//*******************************************************************************
+OpusCodec::OpusCodec(int NumChannels, int SampleRate, int FrameUsec, int Bitrate) :
+    mNumChannels(NumChannels),
+    mFrames(static_cast<int>(static_cast<int64_t>(SampleRate) * FrameUsec / 1000000)),
+    mChannelPacketSize(static_cast<int>(static_cast<int64_t>(Bitrate) * FrameUsec / 8000000))
+{
+    if ( (SampleRate != 8000) && (SampleRate != 12000) && (SampleRate != 16000) &&
+         (SampleRate != 24000) && (SampleRate != 48000) ) {
+        throw std::invalid_argument("Opus needs a sampling rate of 48000 Hz (or 8000, 12000, 16000, 24000 Hz)");
+    }
+    if ( (FrameUsec != 2500) && (FrameUsec != 5000) && (FrameUsec != 10000) && (FrameUsec != 20000) ) {
+        throw std::invalid_argument("Opus packets have to last 2.5, 5, 10 or 20 ms");
+    }
+    if ( (NumChannels < 1) || (mChannelPacketSize < 3) || (mChannelPacketSize > 1275) ) {
+        throw std::invalid_argument("The Opus bitrate is out of range for this packet duration");
+    }
+
+    mEncoders.resize(mNumChannels);
+    mDecoders.resize(mNumChannels);
+    mEncoders.fill(NULL);
+    mDecoders.fill(NULL);
+    int error = OPUS_OK;
+    for (int i = 0; (i < mNumChannels) && (error == OPUS_OK); i++) {
+        mEncoders[i] = opus_encoder_create(SampleRate, 1, OPUS_APPLICATION_RESTRICTED_LOWDELAY, &error);
+        if (error != OPUS_OK) { break; }
+        opus_encoder_ctl(mEncoders[i], OPUS_SET_BITRATE(Bitrate));
+        opus_encoder_ctl(mEncoders[i], OPUS_SET_VBR(0));
+        opus_encoder_ctl(mEncoders[i], OPUS_SET_SIGNAL(OPUS_SIGNAL_MUSIC));
+        mDecoders[i] = opus_decoder_create(SampleRate, 1, &error);
+    }
+    if (error != OPUS_OK) {
+        for (int i = 0; i < mNumChannels; i++) {
+            if (mEncoders[i] != NULL) { opus_encoder_destroy(mEncoders[i]); }
+            if (mDecoders[i] != NULL) { opus_decoder_destroy(mDecoders[i]); }
+        }
+        throw std::runtime_error(std::string("Opus error: ") + opus_strerror(error));
+    }
+}
+
+
+//*******************************************************************************
+OpusCodec::~OpusCodec()
+{
+    for (int i = 0; i < mNumChannels; i++) {
+        opus_encoder_destroy(mEncoders[i]);
+        opus_decoder_destroy(mDecoders[i]);
+    }
+}
+
+
+//*******************************************************************************
+void OpusCodec::encode(sample_t* const* input, int8_t* output)
+{
+    for (int i = 0; i < mNumChannels; i++) {
+        unsigned char* packet = reinterpret_cast<unsigned char*>(output + i * mChannelPacketSize);
+        int size = opus_encode_float(mEncoders[i], input[i], mFrames, packet, mChannelPacketSize);
+        // Packets a little shorter than the bitrate are padded, so all have the
+        // same size. The peer conceals the ones that failed.
+        if (size <= 0) {
+            std::memset(packet, 0, mChannelPacketSize);
+        } else if (size < mChannelPacketSize) {
+            opus_packet_pad(packet, size, mChannelPacketSize);
+        }
+    }
+}
+
+
+//*******************************************************************************
+void OpusCodec::decode(const int8_t* input, sample_t* const* output)
+{
+    for (int i = 0; i < mNumChannels; i++) {
+        const unsigned char* packet = reinterpret_cast<const unsigned char*>(input + i * mChannelPacketSize);
+        // A packet that can't be decoded is concealed like a lost one
+        if ( (opus_decode_float(mDecoders[i], packet, mChannelPacketSize, output[i], mFrames, 0) != mFrames) &&
+             (opus_decode_float(mDecoders[i], NULL, 0, output[i], mFrames, 0) != mFrames) ) {
+            std::memset(output[i], 0, sizeof(sample_t) * mFrames);
+        }
+    }
+}
+
+
+//*******************************************************************************
+void OpusCodec::conceal(sample_t* const* output)
+{
+    for (int i = 0; i < mNumChannels; i++) {
+        if ( opus_decode_float(mDecoders[i], NULL, 0, output[i], mFrames, 0) != mFrames ) {
+            std::memset(output[i], 0, sizeof(sample_t) * mFrames);
+        }
+    }
+}
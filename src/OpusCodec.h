@@ -0,0 +1,87 @@
+//*****************************************************************
+/*
+  JackTrip: A System for High-Quality Audio Network Performance
+  over the Internet
+
+  Copyright (c) 2008 Juan-Pablo Caceres, Chris Chafe.
+  SoundWIRE group at CCRMA, Stanford University.
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation
+  files (the "Software"), to deal in the Software without
+  restriction, including without limitation the rights to use,
+  copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following
+  conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+*/
+//*****************************************************************
+
+
+/**
+ * \file OpusCodec.h
+ * \date October 2026
+ */
+
+#ifndef __OPUSCODEC_H__
+#define __OPUSCODEC_H__
+
+#include <QVector>
+
+#include <opus/opus.h>
+
+#include "AudioCodec.h"
+
+
+/** \brief Opus codec, in its restricted low delay mode (CELT only).
+ *
+ * Each channel has its own mono encoder and decoder, so any number of channels
+ * can be sent, and a packet holds the Opus packet of each channel one after the
+ * other. The encoders run at a constant bitrate and the Opus packets are padded
+ * to the size of that bitrate, so every packet has the same size.
+ *
+ * Lost packets are concealed by the Opus decoder. Opus runs at 8, 12, 16, 24 or
+ * 48 kHz, with packets of 2.5, 5, 10 or 20 ms.
+ */
+class OpusCodec : public AudioCodec
+{
+public:
+
+    /** \brief The class constructor
+   * \param NumChannels Number of channels
+   * \param SampleRate Sampling rate, in Hz
+   * \param FrameUsec Duration of each packet, in microseconds
+   * \param Bitrate Bitrate of each channel, in bits/second
+   */
+    OpusCodec(int NumChannels, int SampleRate, int FrameUsec, int Bitrate);
+    /// \brief The class destructor
+    virtual ~OpusCodec();
+
+    virtual int getFrames() const { return mFrames; }
+    virtual int getPacketSize() const { return mNumChannels * mChannelPacketSize; }
+    virtual void encode(sample_t* const* input, int8_t* output);
+    virtual void decode(const int8_t* input, sample_t* const* output);
+    virtual void conceal(sample_t* const* output);
+
+private:
+
+    int mNumChannels; ///< Number of channels
+    int mFrames; ///< Frames of each packet
+    int mChannelPacketSize; ///< Bytes of the Opus packet of each channel
+    QVector<OpusEncoder*> mEncoders; ///< Encoder of each channel
+    QVector<OpusDecoder*> mDecoders; ///< Decoder of each channel
+};
+
+#endif //__OPUSCODEC_H__
@@ -0,0 +1,172 @@
+//*****************************************************************
+/*
+  JackTrip: A System for High-Quality Audio Network Performance
+  over the Internet
+
+  Copyright (c) 2008 Juan-Pablo Caceres, Chris Chafe.
+  SoundWIRE group at CCRMA, Stanford University.
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation
+  files (the "Software"), to deal in the Software without
+  restriction, including without limitation the rights to use,
+  copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following
+  conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+*/
+//*****************************************************************
+
+/**
+ * \file PacketCipher.cpp
+ * \date October 2026
+ */
+
+#include "PacketCipher.h"
+
+#include <stdexcept>
+
+#if defined (__OPENSSL__)
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#endif
+
+
+#if defined (__OPENSSL__)
+//*******************************************************************************
+PacketCipher::PacketCipher(const uint8_t* key) :
+    mEncryptContext(EVP_CIPHER_CTX_new()),
+    mDecryptContext(EVP_CIPHER_CTX_new())
+{
+    // The key is expanded here once, each packet only sets its nonce (the
+    // default nonce size of GCM is NonceSize)
+    if ( (mEncryptContext == NULL) || (mDecryptContext == NULL) ||
+         !EVP_EncryptInit_ex(mEncryptContext, EVP_aes_128_gcm(), NULL, key, NULL) ||
+         !EVP_DecryptInit_ex(mDecryptContext, EVP_aes_128_gcm(), NULL, key, NULL) ) {
+        EVP_CIPHER_CTX_free(mEncryptContext);
+        EVP_CIPHER_CTX_free(mDecryptContext);
+        throw std::runtime_error("PacketCipher: OpenSSL can't set up AES-128-GCM");
+    }
+}
+
+
+//*******************************************************************************
+PacketCipher::~PacketCipher()
+{
+    EVP_CIPHER_CTX_free(mEncryptContext);
+    EVP_CIPHER_CTX_free(mDecryptContext);
+}
+
+
+//*******************************************************************************
+void PacketCipher::seal(const uint8_t* nonce, const uint8_t* aad, int aad_size,
+                        uint8_t* data, int size, uint8_t* tag) const
+{
+    int length;
+    if ( !EVP_EncryptInit_ex(mEncryptContext, NULL, NULL, NULL, nonce) ||
+         !EVP_EncryptUpdate(mEncryptContext, NULL, &length, aad, aad_size) ||
+         !EVP_EncryptUpdate(mEncryptContext, data, &length, data, size) ||
+         !EVP_EncryptFinal_ex(mEncryptContext, data + length, &length) ||
+         !EVP_CIPHER_CTX_ctrl(mEncryptContext, EVP_CTRL_GCM_GET_TAG, TagSize, tag) ) {
+        throw std::runtime_error("PacketCipher: OpenSSL can't encrypt the packet");
+    }
+}
+
+
+//*******************************************************************************
+bool PacketCipher::open(const uint8_t* nonce, const uint8_t* aad, int aad_size,
+                        uint8_t* data, int size, const uint8_t* tag) const
+{
+    // The tag is checked (in constant time) by the final call, data is only
+    // used if it passes
+    int length;
+    return ( EVP_DecryptInit_ex(mDecryptContext, NULL, NULL, NULL, nonce) &&
+             EVP_DecryptUpdate(mDecryptContext, NULL, &length, aad, aad_size) &&
+             EVP_DecryptUpdate(mDecryptContext, data, &length, data, size) &&
+             EVP_CIPHER_CTX_ctrl(mDecryptContext, EVP_CTRL_GCM_SET_TAG, TagSize,
+                                 const_cast<uint8_t*>(tag)) &&
+             (EVP_DecryptFinal_ex(mDecryptContext, data + length, &length) > 0) );
+}
+
+
+//*******************************************************************************
+bool PacketCipher::isAvailable()
+{
+    return true;
+}
+
+
+//*******************************************************************************
+void PacketCipher::deriveKeys(const char* passphrase, const uint8_t* salt, int salt_size,
+                              int iterations, uint8_t* keys, int keys_size)
+{
+    if ( !PKCS5_PBKDF2_HMAC(passphrase, -1, salt, salt_size, iterations, EVP_sha256(),
+                            keys_size, keys) ) {
+        throw std::runtime_error("PacketCipher: OpenSSL can't derive the keys");
+    }
+}
+
+
+//*******************************************************************************
+void PacketCipher::randomBytes(uint8_t* buffer, int size)
+{
+    if ( RAND_bytes(buffer, size) != 1 ) {
+        throw std::runtime_error("PacketCipher: OpenSSL has no random bytes");
+    }
+}
+
+
+#else // __OPENSSL__
+//*******************************************************************************
+// Without OpenSSL, Settings refuses --encrypt and none of this is called
+//*******************************************************************************
+PacketCipher::PacketCipher(const uint8_t* /*key*/) :
+    mEncryptContext(NULL),
+    mDecryptContext(NULL)
+{
+    throw std::runtime_error("PacketCipher: this JackTrip was built without OpenSSL");
+}
+
+PacketCipher::~PacketCipher()
+{
+}
+
+void PacketCipher::seal(const uint8_t* /*nonce*/, const uint8_t* /*aad*/, int /*aad_size*/,
+                        uint8_t* /*data*/, int /*size*/, uint8_t* /*tag*/) const
+{
+}
+
+bool PacketCipher::open(const uint8_t* /*nonce*/, const uint8_t* /*aad*/, int /*aad_size*/,
+                        uint8_t* /*data*/, int /*size*/, const uint8_t* /*tag*/) const
+{
+    return false;
+}
+
+bool PacketCipher::isAvailable()
+{
+    return false;
+}
+
+void PacketCipher::deriveKeys(const char* /*passphrase*/, const uint8_t* /*salt*/, int /*salt_size*/,
+                              int /*iterations*/, uint8_t* /*keys*/, int /*keys_size*/)
+{
+    throw std::runtime_error("PacketCipher: this JackTrip was built without OpenSSL");
+}
+
+void PacketCipher::randomBytes(uint8_t* /*buffer*/, int /*size*/)
+{
+    throw std::runtime_error("PacketCipher: this JackTrip was built without OpenSSL");
+}
+#endif // __OPENSSL__
@@ -0,0 +1,113 @@
+//*****************************************************************
+/*
+  JackTrip: A System for High-Quality Audio Network Performance
+  over the Internet
+
+  Copyright (c) 2008 Juan-Pablo Caceres, Chris Chafe.
+  SoundWIRE group at CCRMA, Stanford University.
+
+  Permission is hereby granted, free of charge, to any person
+  obtaining a copy of this software and associated documentation
+  files (the "Software"), to deal in the Software without
+  restriction, including without limitation the rights to use,
+  copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the
+  Software is furnished to do so, subject to the following
+  conditions:
+
+  The above copyright notice and this permission notice shall be
+  included in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+  OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+  NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+  WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+*/
+//*****************************************************************
+
+/**
+ * \file PacketCipher.h
+ * \date October 2026
+ */
+
+#ifndef __PACKETCIPHER_H__
+#define __PACKETCIPHER_H__
+
+#include "jacktrip_types.h"
+
+
+struct evp_cipher_ctx_st;
+
+/** \brief Authenticated encryption of packets with AES-128-GCM
+ *
+ * Each packet is encrypted with a 96 bit nonce that must never repeat with the
+ * same key, and gets a 128 bit tag that authenticates it together with some
+ * additional data sent in clear. The work is done by OpenSSL (libcrypto), that
+ * uses AES-NI and carry-less multiplication where the processor has them and
+ * constant time code otherwise. JackTrip built without OpenSSL can't encrypt,
+ * see isAvailable().
+ */
+class PacketCipher
+{
+public:
+
+    static const int KeySize = 16; ///< AES-128
+    static const int NonceSize = 12;
+    static const int TagSize = 16;
+
+    /** \brief The class constructor
+   * \param key KeySize bytes
+   */
+    explicit PacketCipher(const uint8_t* key);
+
+    /// \brief The class destructor
+    ~PacketCipher();
+
+    /** \brief Encrypts data in place
+   * \param nonce NonceSize bytes, never used before with this key
+   * \param aad Additional data authenticated but not encrypted
+   * \param aad_size Size of aad
+   * \param data Data to encrypt
+   * \param size Size of data
+   * \param tag Returns the TagSize bytes of the tag
+   */
+    void seal(const uint8_t* nonce, const uint8_t* aad, int aad_size,
+              uint8_t* data, int size, uint8_t* tag) const;
+
+    /** \brief Checks the tag and decrypts data in place
+   * \return false if the packet isn't authentic
+   */
+    bool open(const uint8_t* nonce, const uint8_t* aad, int aad_size,
+              uint8_t* data, int size, const uint8_t* tag) const;
+
+    /// \brief true if JackTrip was built with OpenSSL, false if it can't encrypt
+    static bool isAvailable();
+
+    /** \brief Derives keys from a passphrase with PBKDF2-HMAC-SHA256
+   * \param passphrase Shared secret
+   * \param salt Salt, different for each session
+   * \param salt_size Size of salt
+   * \param iterations PBKDF2 iterations
+   * \param keys Returns keys_size bytes
+   * \param keys_size Bytes to derive
+   */
+    static void deriveKeys(const char* passphrase, const uint8_t* salt, int salt_size,
+                           int iterations, uint8_t* keys, int keys_size);
+
+    /// \brief Fills buffer with random bytes from the system, for salts
+    static void randomBytes(uint8_t* buffer, int size);
+
+private:
+
+    PacketCipher(const PacketCipher&); ///< Not copyable, it owns the OpenSSL contexts
+    PacketCipher& operator=(const PacketCipher&);
+
+    evp_cipher_ctx_st* mEncryptContext; ///< Keyed once, only the nonce changes per packet
+    evp_cipher_ctx_st* mDecryptContext;
+};
+
+#endif //__PACKETCIPHER_H__
@@ -39,6 +39,8 @@
 #include "JackTrip.h"
 
 #include <sys/time.h>
+#include <chrono>
+#include <cstddef>
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
@@ -88,6 +90,60 @@ uint64_t PacketHeader::usecTime()
 }
 
 
+//***********************************************************************
+uint64_t PacketHeader::steadyUsecTime()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>
+            (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+//***********************************************************************
+bool PacketHeader::checkPeerFormat(uint8_t PeerSamplingRate, uint8_t PeerBitResolution,
+                                   uint8_t LocalSamplingRate, uint8_t LocalBitResolution)
+{
+    bool error = false;
+
+    // Check Sampling Rate (the peer audio is resampled to ours)
+    if ( PeerSamplingRate >= AudioInterface::UNDEF )
+    {
+        std::cerr << "ERROR: Peer Sampling Rate is undefined" << endl;
+        std::cerr << "Make sure the peer uses one of the JACK sampling rates" << endl;
+        std::cerr << gPrintSeparator << endl;
+        error = true;
+    }
+    else if ( PeerSamplingRate != LocalSamplingRate )
+    {
+        cout << "Peer Sampling Rate is   : " <<
+                AudioInterface::getSampleRateFromType
+                ( static_cast<AudioInterface::samplingRateT>(PeerSamplingRate) ) << endl;
+        cout << "Local Sampling Rate is  : " <<
+                AudioInterface::getSampleRateFromType
+                ( static_cast<AudioInterface::samplingRateT>(LocalSamplingRate) ) << endl;
+        cout << "The peer audio is resampled, use the same Sampling Rate for the best quality" << endl;
+        cout << gPrintSeparator << endl;
+    }
+
+    // Check Audio Bit Resolution (the peer audio is converted to ours)
+    if ( (PeerBitResolution != 8) && (PeerBitResolution != 16) &&
+         (PeerBitResolution != 24) && (PeerBitResolution != 32) )
+    {
+        std::cerr << "ERROR: Peer Audio Bit Resolution is  : "
+                  << static_cast<int>(PeerBitResolution) << endl;
+        std::cerr << "Make sure the peer uses 8, 16, 24 or 32 bits" << endl;
+        std::cerr << gPrintSeparator << endl;
+        error = true;
+    }
+    else if ( PeerBitResolution != LocalBitResolution )
+    {
+        cout << "Peer Audio Bit Resolution is  : " << static_cast<int>(PeerBitResolution) << endl;
+        cout << "Local Audio Bit Resolution is : " << static_cast<int>(LocalBitResolution) << endl;
+        cout << gPrintSeparator << endl;
+    }
+
+    return !error;
+}
+
 
 
 //#######################################################################
@@ -112,8 +168,7 @@ DefaultHeader::DefaultHeader(JackTrip* jacktrip) :
 //***********************************************************************
 void DefaultHeader::fillHeaderCommonFromAudio()
 {
-    mHeader.TimeStamp = PacketHeader::usecTime();
-    mHeader.BufferSize = mJackTrip->getBufferSizeInSamples();
+    mHeader.BufferSize = mJackTrip->getSendPacketFrames();
     mHeader.SamplingRate = mJackTrip->getSampleRateType ();
     mHeader.BitResolution = mJackTrip->getAudioBitResolution();
     mHeader.NumChannels = mJackTrip->getNumChannels();
@@ -130,39 +185,31 @@ void DefaultHeader::checkPeerSettings(int8_t* full_packet)
     DefaultHeaderStruct* peer_header;
     peer_header =  reinterpret_cast<DefaultHeaderStruct*>(full_packet);
 
-    // Check Buffer Size
-    if ( peer_header->BufferSize != mHeader.BufferSize )
+    // Check Header Version (the rest can't be read from version 2 headers)
+    if ( DefaultHeaderV2::isVersion2(full_packet, sizeof(DefaultHeaderStruct)) )
     {
-        std::cerr << "ERROR: Peer Buffer Size is  : " << peer_header->BufferSize << endl;
-        std::cerr << "       Local Buffer Size is : " << mHeader.BufferSize << endl;
-        std::cerr << "Make sure both machines use same buffer size" << endl;
+        std::cerr << "ERROR: Peer sends version 2 headers" << endl;
+        std::cerr << "Make sure both machines use --headerv2, or neither" << endl;
         std::cerr << gPrintSeparator << endl;
-        error = true;
+        emit signalError("Local and Peer Settings don't match");
+        return;
     }
 
-    // Check Sampling Rate
-    if ( peer_header->SamplingRate != mHeader.SamplingRate )
+    // Check Buffer Size (peer packets of any size are joined back into local
+    // buffers, see JackTrip::writeAudioBuffer)
+    if ( peer_header->BufferSize == 0 )
     {
-        std::cerr << "ERROR: Peer Sampling Rate is   : " <<
-                     AudioInterface::getSampleRateFromType
-                     ( static_cast<AudioInterface::samplingRateT>(peer_header->SamplingRate) ) << endl;
-        std::cerr << "       Local Sampling Rate is  : " <<
-                     AudioInterface::getSampleRateFromType
-                     ( static_cast<AudioInterface::samplingRateT>(mHeader.SamplingRate) ) << endl;
-        std::cerr << "Make sure both machines use the same Sampling Rate" << endl;
+        std::cerr << "ERROR: Peer Buffer Size is  : " << peer_header->BufferSize << endl;
+        std::cerr << "       Local Buffer Size is : " << mJackTrip->getBufferSizeInSamples() << endl;
+        std::cerr << "Make sure the peer sends audio in its packets" << endl;
         std::cerr << gPrintSeparator << endl;
         error = true;
     }
 
-    // Check Audio Bit Resolution
-    if ( peer_header->BitResolution != mHeader.BitResolution )
+    // Check Sampling Rate and Audio Bit Resolution
+    if ( !checkPeerFormat(peer_header->SamplingRate, peer_header->BitResolution,
+                          mHeader.SamplingRate, mHeader.BitResolution) )
     {
-        std::cerr << "ERROR: Peer Audio Bit Resolution is  : "
-                  << static_cast<int>(peer_header->BitResolution) << endl;
-        std::cerr << "       Local Audio Bit Resolution is : "
-                  << static_cast<int>(mHeader.BitResolution) << endl;
-        std::cerr << "Make sure both machines use the same Bit Resolution" << endl;
-        std::cerr << gPrintSeparator << endl;
         error = true;
     }
 
@@ -178,6 +225,17 @@ void DefaultHeader::checkPeerSettings(int8_t* full_packet)
 }
 
 
+//***********************************************************************
+bool DefaultHeader::matchesPeerSettings(int8_t* full_packet) const
+{
+    DefaultHeaderStruct* peer_header;
+    peer_header =  reinterpret_cast<DefaultHeaderStruct*>(full_packet);
+    return ( (peer_header->BufferSize == mJackTrip->getReceivePacketFrames()) &&
+             (peer_header->SamplingRate == mJackTrip->getReceiveSampleRateType()) &&
+             (peer_header->BitResolution == mJackTrip->getReceiveAudioBitResolution()) );
+}
+
+
 //***********************************************************************
 void DefaultHeader::printHeader() const
 {
@@ -202,65 +260,234 @@ void DefaultHeader::printHeader() const
 
 
 //***********************************************************************
-uint64_t DefaultHeader::getPeerTimeStamp(int8_t* full_packet) const
+uint16_t DefaultHeader::getPeerBufferSize(int8_t* full_packet) const
 {
     DefaultHeaderStruct* peer_header;
     peer_header =  reinterpret_cast<DefaultHeaderStruct*>(full_packet);
-    return peer_header->TimeStamp;
+    return peer_header->BufferSize;
 }
 
 
 //***********************************************************************
-uint16_t DefaultHeader::getPeerSequenceNumber(int8_t* full_packet) const
+uint8_t  DefaultHeader::getPeerSamplingRate(int8_t* full_packet) const
 {
     DefaultHeaderStruct* peer_header;
     peer_header =  reinterpret_cast<DefaultHeaderStruct*>(full_packet);
-    return peer_header->SeqNumber;
+    return peer_header->SamplingRate;
 }
 
 
 //***********************************************************************
-uint16_t DefaultHeader::getPeerBufferSize(int8_t* full_packet) const
+uint8_t DefaultHeader::getPeerBitResolution(int8_t* full_packet) const
 {
     DefaultHeaderStruct* peer_header;
     peer_header =  reinterpret_cast<DefaultHeaderStruct*>(full_packet);
-    return peer_header->BufferSize;
+    return peer_header->BitResolution;
 }
 
 
 //***********************************************************************
-uint8_t  DefaultHeader::getPeerSamplingRate(int8_t* full_packet) const
+uint16_t DefaultHeader::getPeerNumChannels(int8_t* full_packet) const
 {
     DefaultHeaderStruct* peer_header;
     peer_header =  reinterpret_cast<DefaultHeaderStruct*>(full_packet);
-    return peer_header->SamplingRate;
+    return peer_header->NumChannels;
 }
 
 
 //***********************************************************************
-uint8_t DefaultHeader::getPeerBitResolution(int8_t* full_packet) const
+uint8_t DefaultHeader::getPeerConnectionMode(int8_t* full_packet) const
 {
     DefaultHeaderStruct* peer_header;
     peer_header =  reinterpret_cast<DefaultHeaderStruct*>(full_packet);
+    return static_cast<uint8_t>(peer_header->ConnectionMode);
+}
+
+
+
+
+
+
+//#######################################################################
+//####################### DefaultHeaderV2 ###############################
+//#######################################################################
+//***********************************************************************
+DefaultHeaderV2::DefaultHeaderV2(JackTrip* jacktrip) :
+    PacketHeader(jacktrip), mJackTrip(jacktrip)
+{
+    mHeader.SeqNumber = 0;
+    mHeader.TimeStamp = 0;
+    mHeader.BufferSize = 0;
+    mHeader.NumChannels = 0;
+    mHeader.Version = Version << 4;
+    mHeader.SamplingRate = 0;
+    mHeader.BitResolution = 0;
+    mHeader.Capabilities = 0;
+    std::memset(mHeader.Reserved, 0, sizeof(mHeader.Reserved));
+    mHeader.EchoTimeStamp = 0;
+    mHeader.EchoDelay = gNoEcho;
+}
+
+
+//***********************************************************************
+bool DefaultHeaderV2::isVersion2(const int8_t* full_packet, int size)
+{
+    // Version 1 has the sampling rate type there, always below 16. Only the
+    // version byte is read, so shorter version 1 headers can be tested too
+    return ( (size > static_cast<int>(offsetof(DefaultHeaderV2Struct, Version))) &&
+             ((reinterpret_cast<const DefaultHeaderV2Struct*>(full_packet)->Version >> 4)
+              == Version) );
+}
+
+
+//***********************************************************************
+void DefaultHeaderV2::fillHeaderCommonFromAudio()
+{
+    mHeader.BufferSize = mJackTrip->getSendPacketFrames();
+    mHeader.NumChannels = mJackTrip->getNumChannels();
+    mHeader.Version = (Version << 4) | (static_cast<int>(mJackTrip->getConnectionMode()) & 0x0F);
+    mHeader.SamplingRate = mJackTrip->getSampleRateType ();
+    mHeader.BitResolution = mJackTrip->getAudioBitResolution();
+    mHeader.Capabilities = mJackTrip->getCapabilities();
+}
+
+
+//***********************************************************************
+void DefaultHeaderV2::checkPeerSettings(int8_t* full_packet)
+{
+    bool error = false;
+
+    DefaultHeaderV2Struct* peer_header;
+    peer_header =  reinterpret_cast<DefaultHeaderV2Struct*>(full_packet);
+
+    // Check Header Version (the rest can't be read from version 1 headers)
+    if ( (peer_header->Version >> 4) != Version )
+    {
+        std::cerr << "ERROR: Peer Header Version is  : " << (peer_header->Version >> 4) << endl;
+        std::cerr << "       Local Header Version is : " << static_cast<int>(Version) << endl;
+        std::cerr << "Make sure both machines use --headerv2, or neither" << endl;
+        std::cerr << gPrintSeparator << endl;
+        emit signalError("Local and Peer Settings don't match");
+        return;
+    }
+
+    // Check Buffer Size (peer packets of any size are joined back into local
+    // buffers, see JackTrip::writeAudioBuffer)
+    if ( peer_header->BufferSize == 0 )
+    {
+        std::cerr << "ERROR: Peer Buffer Size is  : " << peer_header->BufferSize << endl;
+        std::cerr << "       Local Buffer Size is : " << mJackTrip->getBufferSizeInSamples() << endl;
+        std::cerr << "Make sure the peer sends audio in its packets" << endl;
+        std::cerr << gPrintSeparator << endl;
+        error = true;
+    }
+
+    // Check Sampling Rate and Audio Bit Resolution
+    if ( !checkPeerFormat(peer_header->SamplingRate, peer_header->BitResolution,
+                          mHeader.SamplingRate, mHeader.BitResolution) )
+    {
+        error = true;
+    }
+
+    if (error)
+    {
+        emit signalError("Local and Peer Settings don't match");
+        return;
+    }
+
+    uint16_t capabilities = peer_header->Capabilities;
+    cout << "Peer header version 2, the peer uses:"
+         << ((capabilities & DataProtocol::CAP_HEARTBEAT) ? " heartbeat" : "")
+         << ((capabilities & DataProtocol::CAP_FRAGMENTS) ? " mtu" : "")
+         << ((capabilities & DataProtocol::CAP_FEC) ? " fec" : "")
+         << ((capabilities & DataProtocol::CAP_LOSS_REPORTS) ? " adaptiveredundancy" : "")
+         << ((capabilities & DataProtocol::CAP_NACK) ? " nack" : "")
+         << ((capabilities & DataProtocol::CAP_LOSSLESS) ? " lossless" : "")
+         << ((capabilities & DataProtocol::CAP_OPUS) ? " opus" : "")
+         << ((capabilities & DataProtocol::CAP_BLOCKFLOAT) ? " blockfloat" : "")
+         << ((capabilities & DataProtocol::CAP_DTX) ? " dtx" : "")
+         << ((capabilities & DataProtocol::CAP_HALFFLOAT) ? " halffloat" : "")
+         << ((capabilities & DataProtocol::CAP_ADAPTIVE_BITRATE) ? " adaptivebitrate" : "")
+         << ((capabilities == 0) ? " no extensions" : "") << endl;
+    cout << gPrintSeparator << endl;
+}
+
+
+//***********************************************************************
+bool DefaultHeaderV2::matchesPeerSettings(int8_t* full_packet) const
+{
+    DefaultHeaderV2Struct* peer_header;
+    peer_header =  reinterpret_cast<DefaultHeaderV2Struct*>(full_packet);
+    return ( ((peer_header->Version >> 4) == Version) &&
+             (peer_header->BufferSize == mJackTrip->getReceivePacketFrames()) &&
+             (peer_header->SamplingRate == mJackTrip->getReceiveSampleRateType()) &&
+             (peer_header->BitResolution == mJackTrip->getReceiveAudioBitResolution()) );
+}
+
+
+//***********************************************************************
+uint16_t DefaultHeaderV2::getPeerBufferSize(int8_t* full_packet) const
+{
+    DefaultHeaderV2Struct* peer_header;
+    peer_header =  reinterpret_cast<DefaultHeaderV2Struct*>(full_packet);
+    return peer_header->BufferSize;
+}
+
+
+//***********************************************************************
+uint8_t  DefaultHeaderV2::getPeerSamplingRate(int8_t* full_packet) const
+{
+    DefaultHeaderV2Struct* peer_header;
+    peer_header =  reinterpret_cast<DefaultHeaderV2Struct*>(full_packet);
+    return peer_header->SamplingRate;
+}
+
+
+//***********************************************************************
+uint8_t DefaultHeaderV2::getPeerBitResolution(int8_t* full_packet) const
+{
+    DefaultHeaderV2Struct* peer_header;
+    peer_header =  reinterpret_cast<DefaultHeaderV2Struct*>(full_packet);
     return peer_header->BitResolution;
 }
 
 
 //***********************************************************************
-uint8_t DefaultHeader::getPeerNumChannels(int8_t* full_packet) const
+uint16_t DefaultHeaderV2::getPeerNumChannels(int8_t* full_packet) const
 {
-    DefaultHeaderStruct* peer_header;
-    peer_header =  reinterpret_cast<DefaultHeaderStruct*>(full_packet);
+    DefaultHeaderV2Struct* peer_header;
+    peer_header =  reinterpret_cast<DefaultHeaderV2Struct*>(full_packet);
     return peer_header->NumChannels;
 }
 
 
 //***********************************************************************
-uint8_t DefaultHeader::getPeerConnectionMode(int8_t* full_packet) const
+uint8_t DefaultHeaderV2::getPeerConnectionMode(int8_t* full_packet) const
 {
-    DefaultHeaderStruct* peer_header;
-    peer_header =  reinterpret_cast<DefaultHeaderStruct*>(full_packet);
-    return static_cast<uint8_t>(peer_header->ConnectionMode);
+    DefaultHeaderV2Struct* peer_header;
+    peer_header =  reinterpret_cast<DefaultHeaderV2Struct*>(full_packet);
+    return peer_header->Version & 0x0F;
+}
+
+
+//***********************************************************************
+uint16_t DefaultHeaderV2::getPeerCapabilities(int8_t* full_packet) const
+{
+    DefaultHeaderV2Struct* peer_header;
+    peer_header =  reinterpret_cast<DefaultHeaderV2Struct*>(full_packet);
+    return peer_header->Capabilities;
+}
+
+
+//***********************************************************************
+bool DefaultHeaderV2::getPeerEcho(int8_t* full_packet, uint32_t& time_stamp,
+                                  uint32_t& delay_usec) const
+{
+    DefaultHeaderV2Struct* peer_header;
+    peer_header =  reinterpret_cast<DefaultHeaderV2Struct*>(full_packet);
+    time_stamp = peer_header->EchoTimeStamp;
+    delay_usec = peer_header->EchoDelay;
+    return (delay_usec != gNoEcho);
 }
 
 
@@ -58,7 +58,7 @@ struct DefaultHeaderStruct : public HeaderStruct
 {
 public:
     // watch out for alignment...
-    uint64_t TimeStamp; ///< Time Stamp
+    uint64_t TimeStamp; ///< Capture time of the first frame, in PacketHeader::steadyUsecTime()
     uint16_t SeqNumber; ///< Sequence Number
     uint16_t BufferSize; ///< Buffer Size in Samples
     uint8_t  SamplingRate; ///< Sampling Rate in JackAudioInterface::samplingRateT
@@ -69,6 +69,158 @@ public:
     uint8_t  ConnectionMode;
 };
 
+/** \brief Version 2 of the Default Header Struct
+ *
+ * Compared to DefaultHeaderStruct: a 32-bit sequence number, a media clock time
+ * stamp instead of the wall clock, a 16-bit channel count, the
+ * DataProtocol::capabilityT bits of the sender and the echo of the newest peer
+ * time stamp, to measure the round trip time. The version is where version 1
+ * has the sampling rate, so each side can tell the other one apart.
+ */
+struct DefaultHeaderV2Struct : public HeaderStruct
+{
+public:
+    uint32_t SeqNumber; ///< Sequence Number
+    uint32_t TimeStamp; ///< Audio frames sent before this packet (media clock)
+    uint16_t BufferSize; ///< Buffer Size in Samples
+    uint16_t NumChannels; ///< Number of Channels, we assume input and outputs are the same
+    uint8_t  Version; ///< Header version (high 4 bits) and connection mode (low 4 bits)
+    uint8_t  SamplingRate; ///< Sampling Rate in JackAudioInterface::samplingRateT
+    uint16_t Capabilities; ///< DataProtocol::capabilityT bits of the sender
+    uint8_t  BitResolution; ///< Audio Bit Resolution
+    uint8_t  Reserved[3]; ///< Always 0
+    uint32_t EchoTimeStamp; ///< TimeStamp of the newest packet received from the peer
+    uint32_t EchoDelay; ///< Microseconds from its arrival to sending this packet, or gNoEcho
+};
+
+/** \brief Control Packet Struct
+ *
+ * Small packets (heartbeat, goodbye) sent on the data socket next to the audio.
+ * They never have the size of an audio packet, which is how the receiver tells
+ * them apart.
+ */
+struct ControlHeaderStruct
+{
+public:
+    uint32_t Magic; ///< Always gControlPacketMagic
+    uint8_t  Type; ///< DataProtocol::controlPacketTypeT
+    uint8_t  Reserved[3];
+};
+
+/** \brief Fragment Packet Struct
+ *
+ * Header of a control packet that carries one fragment of an audio packet
+ * (header+audio) that is larger than the path MTU. With redundancy, the same
+ * fragment of the previous packets follows, newest first.
+ */
+struct FragmentHeaderStruct
+{
+public:
+    uint32_t Magic; ///< Always gControlPacketMagic
+    uint8_t  Type; ///< Always DataProtocol::FRAGMENT
+    uint8_t  FragmentIndex; ///< Index of this fragment in the packet
+    uint8_t  FragmentCount; ///< Number of fragments of the packet
+    uint8_t  Copies; ///< Number of packets that carry this fragment (redundancy)
+    uint16_t SeqNumber; ///< Sequence Number of the newest packet
+    uint16_t FragmentSize; ///< Audio bytes in each fragment (the first one also has the header)
+};
+
+//---------------------------------------------------------
+/** \brief Loss Report Struct
+ *
+ * Control packet with the datagrams the RECEIVER got and lost since the last
+ * report, so the peer SENDER can adapt its redundancy and its bitrate.
+ */
+struct LossReportStruct
+{
+public:
+    uint32_t Magic; ///< Always gControlPacketMagic
+    uint8_t  Type; ///< Always DataProtocol::LOSS_REPORT
+    uint8_t  Reserved;
+    uint16_t Received; ///< Datagrams received
+    uint16_t Lost; ///< Datagrams lost
+    uint16_t MaxBurst; ///< Longest run of consecutive datagrams lost
+    int32_t  DelayChangeUsec; ///< Change of the shortest one-way delay since the last report (not sent by older versions)
+};
+
+//---------------------------------------------------------
+/** \brief FEC Parity Header Struct
+ *
+ * Header of a control packet that carries one parity packet of a group of audio
+ * packets (header+audio), see ForwardErrorCorrection. The parity follows, with
+ * the size of an audio packet.
+ */
+struct FecHeaderStruct
+{
+public:
+    uint32_t Magic; ///< Always gControlPacketMagic
+    uint8_t  Type; ///< Always DataProtocol::FEC_PARITY
+    uint8_t  ParityIndex; ///< Index of this parity packet in the group
+    uint8_t  GroupSize; ///< Audio packets in the group
+    uint8_t  ParityCount; ///< Parity packets of the group
+    uint16_t FirstSeqNumber; ///< Sequence Number of the first packet of the group
+    uint16_t PacketSize; ///< Size of each packet of the group (header+audio)
+};
+
+//---------------------------------------------------------
+/** \brief NACK Struct
+ *
+ * Control packet with the sequence numbers of the audio packets the RECEIVER
+ * lost and wants again. Only the first Count sequence numbers are sent.
+ */
+struct NackStruct
+{
+public:
+    uint32_t Magic; ///< Always gControlPacketMagic
+    uint8_t  Type; ///< Always DataProtocol::NACK
+    uint8_t  Count; ///< Sequence numbers in the packet
+    uint16_t SeqNumbers[gMaxNackSeqNumbers]; ///< Sequence Numbers of the packets
+};
+
+//---------------------------------------------------------
+/** \brief Compressed Packet Header Struct
+ *
+ * Header of a control packet that carries audio packets with the audio coded by
+ * LosslessCodec, newest first. Each packet is its header, the size of its coded
+ * audio (uint16_t) and the coded audio. A size equal to the raw audio size means
+ * the audio is raw. The RECEIVER turns the datagram back into raw packets.
+ *
+ * DTX packets have the same header. Each packet is its header, a bitmap of the
+ * channels sent (bit i of byte i/8 for channel i), the comfort noise level of each
+ * channel left out (uint8_t, RMS in -dB, 0 for silence) and the audio of the
+ * channels sent.
+ *
+ * REDUCED packets have the same header too, with the bit resolution of the
+ * session. Each packet is its header, the bit resolution it was sent at
+ * (uint8_t, AudioInterface::audioBitResolutionT) and the audio at that resolution.
+ */
+struct CompressedHeaderStruct
+{
+public:
+    uint32_t Magic; ///< Always gControlPacketMagic
+    uint8_t  Type; ///< DataProtocol::COMPRESSED, DataProtocol::DTX or DataProtocol::REDUCED
+    uint8_t  Copies; ///< Packets in the datagram (redundancy)
+    uint8_t  BytesPerSample; ///< AudioInterface::audioBitResolutionT of the audio
+    uint8_t  Reserved;
+    uint16_t NumChannels; ///< Channels of the audio
+    uint16_t NumFrames; ///< Frames of each channel
+    uint16_t HeaderSize; ///< Size of the header of each packet
+};
+
+//---------------------------------------------------------
+/** \brief Encrypted Packet Header Struct
+ *
+ * With encryption, every datagram (audio or control) is sent as this header,
+ * the datagram encrypted with PacketCipher and the tag of PacketCipher::TagSize
+ * bytes. The counter never repeats for a key: it's the nonce, and the RECEIVER
+ * drops counters it already got (replayed packets).
+ */
+struct CipherHeaderStruct
+{
+public:
+    uint64_t Counter; ///< Datagram counter, with the top bit set for the ones sent by the RECEIVER
+};
+
 //---------------------------------------------------------
 //JamLink UDP Header:
 /************************************************************************/
@@ -127,21 +279,47 @@ public:
     /// \brief Return a time stamp in microseconds
     /// \return Time stamp: microseconds since midnight (0 hour), January 1, 1970
     static uint64_t usecTime();
-    /// \todo Implement this using a JackTrip Method (Mediator) member instead of the
-    /// reference to JackAudio
+    /// \brief Return a time stamp in microseconds from a clock that never jumps (NTP
+    /// can step usecTime()), to measure intervals on this machine
+    static uint64_t steadyUsecTime();
+    /// \brief Fills the header fields that don't change during the session. Called
+    /// once before the first packet is sent; putHeaderInPacket() updates the rest.
     virtual void fillHeaderCommonFromAudio() = 0;
     /// \brief Parse the packet header and take appropriate measures (like change settings, or
     /// quit the program if peer settings don't match)
     virtual void parseHeader() = 0;
     virtual void checkPeerSettings(int8_t* full_packet) = 0;
+    /// \brief Checks, without reporting errors, that a packet was sent with the local
+    /// audio settings. Used to validate packets that arrive from an unknown address.
+    /// \return false if the header doesn't carry enough information to tell
+    virtual bool matchesPeerSettings(int8_t* /*full_packet*/) const { return false; }
 
     virtual uint64_t getPeerTimeStamp(int8_t* full_packet) const = 0;
     virtual uint16_t getPeerSequenceNumber(int8_t* full_packet) const = 0;
     virtual uint16_t getPeerBufferSize(int8_t* full_packet) const = 0;
     virtual uint8_t  getPeerSamplingRate(int8_t* full_packet) const = 0;
     virtual uint8_t getPeerBitResolution(int8_t* full_packet) const = 0;
-    virtual uint8_t  getPeerNumChannels(int8_t* full_packet) const = 0;
+    virtual uint16_t getPeerNumChannels(int8_t* full_packet) const = 0;
     virtual uint8_t  getPeerConnectionMode(int8_t* full_packet) const = 0;
+    /// \brief Returns the sequence number with all the bits the header carries
+    virtual uint32_t getPeerLongSequenceNumber(int8_t* full_packet) const
+    { return getPeerSequenceNumber(full_packet); }
+    /// \brief Returns the DataProtocol::capabilityT bits of the peer, 0 if the header
+    /// doesn't carry them
+    virtual uint16_t getPeerCapabilities(int8_t* /*full_packet*/) const { return 0; }
+    /// \brief Returns true if the sequence numbers have 32 bits
+    virtual bool hasLongSequenceNumbers() const { return false; }
+    /// \brief Returns true if the header echoes the peer time stamps
+    virtual bool hasEcho() const { return false; }
+    /** \brief Sets the echo sent in the next headers
+   * \param peer_time_stamp Time stamp of the newest packet received from the peer
+   * \param delay_usec Time since that packet arrived, in microseconds
+   */
+    virtual void setEcho(uint32_t /*peer_time_stamp*/, uint32_t /*delay_usec*/) {}
+    /// \brief Reads the echo of our time stamp from a peer packet
+    /// \return false if the packet doesn't carry one
+    virtual bool getPeerEcho(int8_t* /*full_packet*/, uint32_t& /*time_stamp*/,
+                             uint32_t& /*delay_usec*/) const { return false; }
 
     /// \brief Increase sequence number for counter, a 16bit number
     virtual void increaseSequenceNumber()
@@ -163,6 +341,13 @@ public:
     /// sizeof(header part) + sizeof(audio part)
     virtual void putHeaderInPacket(int8_t* full_packet) = 0;
 
+    /** \brief Checks that the peer audio format can be converted to the local one,
+   * and says how it will be (see JackTrip::setReceiveFormat)
+   * \return false, after printing the errors, if it can't
+   */
+    static bool checkPeerFormat(uint8_t PeerSamplingRate, uint8_t PeerBitResolution,
+                                uint8_t LocalSamplingRate, uint8_t LocalBitResolution);
+
 
 signals:
     void signalError(const char* error_message);
@@ -176,6 +361,49 @@ private:
 
 
 
+//#######################################################################
+//####################### HeaderCodec ###################################
+//#######################################################################
+class DefaultHeader;
+class DefaultHeaderV2;
+
+/** \brief Reads the fields that change in every peer packet, without virtual calls
+ *
+ * JackTrip picks the specialization of its header type, which is fixed for the
+ * session, so the send and receive loops read the peer headers inline. The
+ * PacketHeader methods use the same code. Headers without these fields (JamLink,
+ * empty) use the generic version.
+ */
+template<class HeaderT> struct HeaderCodec
+{
+    static uint16_t getSequenceNumber(const int8_t* /*full_packet*/) { return 0; }
+    static uint32_t getLongSequenceNumber(const int8_t* /*full_packet*/) { return 0; }
+    static uint64_t getTimeStamp(const int8_t* /*full_packet*/) { return 0; }
+};
+
+template<> struct HeaderCodec<DefaultHeader>
+{
+    static uint16_t getSequenceNumber(const int8_t* full_packet)
+    { return reinterpret_cast<const DefaultHeaderStruct*>(full_packet)->SeqNumber; }
+    static uint32_t getLongSequenceNumber(const int8_t* full_packet)
+    { return getSequenceNumber(full_packet); }
+    static uint64_t getTimeStamp(const int8_t* full_packet)
+    { return reinterpret_cast<const DefaultHeaderStruct*>(full_packet)->TimeStamp; }
+};
+
+template<> struct HeaderCodec<DefaultHeaderV2>
+{
+    static uint16_t getSequenceNumber(const int8_t* full_packet)
+    { return static_cast<uint16_t>(getLongSequenceNumber(full_packet)); }
+    static uint32_t getLongSequenceNumber(const int8_t* full_packet)
+    { return reinterpret_cast<const DefaultHeaderV2Struct*>(full_packet)->SeqNumber; }
+    static uint64_t getTimeStamp(const int8_t* full_packet)
+    { return reinterpret_cast<const DefaultHeaderV2Struct*>(full_packet)->TimeStamp; }
+};
+
+
+
+
 //#######################################################################
 //####################### DefaultHeader #################################
 //#######################################################################
@@ -191,13 +419,18 @@ public:
     virtual void fillHeaderCommonFromAudio();
     virtual void parseHeader() {}
     virtual void checkPeerSettings(int8_t* full_packet);
+    virtual bool matchesPeerSettings(int8_t* full_packet) const;
     virtual void increaseSequenceNumber()
     { mHeader.SeqNumber++; }
     virtual uint16_t getSequenceNumber() const
     { return mHeader.SeqNumber; }
     virtual int getHeaderSizeInBytes() const { return sizeof(mHeader); }
     virtual void putHeaderInPacket(int8_t* full_packet)
-    { putHeaderInPacketBaseClass(full_packet, mHeader); }
+    { std::memcpy(full_packet, &mHeader, sizeof(mHeader)); }
+    /// \brief Sets the time stamp of the next packets: the capture time of their
+    /// first frame, in steadyUsecTime()
+    void setTimeStamp(uint64_t usec)
+    { mHeader.TimeStamp = usec; }
     void printHeader() const;
     uint8_t getConnectionMode() const
     { return mHeader.ConnectionMode; }
@@ -205,12 +438,14 @@ public:
     { return mHeader.NumChannels; }
 
 
-    virtual uint64_t getPeerTimeStamp(int8_t* full_packet) const;
-    virtual uint16_t getPeerSequenceNumber(int8_t* full_packet) const;
+    virtual uint64_t getPeerTimeStamp(int8_t* full_packet) const
+    { return HeaderCodec<DefaultHeader>::getTimeStamp(full_packet); }
+    virtual uint16_t getPeerSequenceNumber(int8_t* full_packet) const
+    { return HeaderCodec<DefaultHeader>::getSequenceNumber(full_packet); }
     virtual uint16_t getPeerBufferSize(int8_t* full_packet) const;
     virtual uint8_t  getPeerSamplingRate(int8_t* full_packet) const;
     virtual uint8_t getPeerBitResolution(int8_t* full_packet) const;
-    virtual uint8_t  getPeerNumChannels(int8_t* full_packet) const;
+    virtual uint16_t getPeerNumChannels(int8_t* full_packet) const;
     virtual uint8_t  getPeerConnectionMode(int8_t* full_packet) const;
 
 
@@ -222,6 +457,72 @@ private:
 
 
 
+//#######################################################################
+//####################### DefaultHeaderV2 ###############################
+//#######################################################################
+/** \brief Version 2 of the Default Header
+ *
+ * Peers that only know version 1 fail the sampling rate check, and this header
+ * tells them apart with isVersion2(). The protocol still works with the low 16
+ * bits of the sequence number; the full number only tells a long outage from
+ * a late packet.
+ */
+class DefaultHeaderV2 : public PacketHeader
+{
+public:
+
+    DefaultHeaderV2(JackTrip* jacktrip);
+    virtual ~DefaultHeaderV2() {}
+
+    /** \brief Returns true if full_packet starts with a version 2 header
+     *
+     * Only looks at the version byte, so size just has to reach it (any
+     * version 1 header does).
+     */
+    static bool isVersion2(const int8_t* full_packet, int size);
+
+    virtual void fillHeaderCommonFromAudio();
+    virtual void parseHeader() {}
+    virtual void checkPeerSettings(int8_t* full_packet);
+    virtual bool matchesPeerSettings(int8_t* full_packet) const;
+    virtual void increaseSequenceNumber()
+    { mHeader.SeqNumber++; mHeader.TimeStamp += mHeader.BufferSize; }
+    virtual uint16_t getSequenceNumber() const
+    { return static_cast<uint16_t>(mHeader.SeqNumber); }
+    virtual int getHeaderSizeInBytes() const { return sizeof(mHeader); }
+    virtual void putHeaderInPacket(int8_t* full_packet)
+    { std::memcpy(full_packet, &mHeader, sizeof(mHeader)); }
+
+    /// \brief Returns the media clock of the packet, in audio frames
+    virtual uint64_t getPeerTimeStamp(int8_t* full_packet) const
+    { return HeaderCodec<DefaultHeaderV2>::getTimeStamp(full_packet); }
+    virtual uint16_t getPeerSequenceNumber(int8_t* full_packet) const
+    { return HeaderCodec<DefaultHeaderV2>::getSequenceNumber(full_packet); }
+    virtual uint16_t getPeerBufferSize(int8_t* full_packet) const;
+    virtual uint8_t  getPeerSamplingRate(int8_t* full_packet) const;
+    virtual uint8_t getPeerBitResolution(int8_t* full_packet) const;
+    virtual uint16_t getPeerNumChannels(int8_t* full_packet) const;
+    virtual uint8_t  getPeerConnectionMode(int8_t* full_packet) const;
+    virtual uint32_t getPeerLongSequenceNumber(int8_t* full_packet) const
+    { return HeaderCodec<DefaultHeaderV2>::getLongSequenceNumber(full_packet); }
+    virtual uint16_t getPeerCapabilities(int8_t* full_packet) const;
+    virtual bool hasLongSequenceNumbers() const { return true; }
+    virtual bool hasEcho() const { return true; }
+    virtual void setEcho(uint32_t peer_time_stamp, uint32_t delay_usec)
+    { mHeader.EchoTimeStamp = peer_time_stamp; mHeader.EchoDelay = delay_usec; }
+    virtual bool getPeerEcho(int8_t* full_packet, uint32_t& time_stamp, uint32_t& delay_usec) const;
+
+    static const uint8_t Version = 2; ///< Version in the high 4 bits of the Version field
+
+
+private:
+    DefaultHeaderV2Struct mHeader; ///< Version 2 Header Struct
+    JackTrip* mJackTrip; ///< JackTrip mediator class
+};
+
+
+
+
 //#######################################################################
 //####################### JamLinkHeader #################################
 //#######################################################################
@@ -244,7 +545,7 @@ public:
     virtual uint16_t getPeerBufferSize(int8_t* /*full_packet*/) const { return 0; }
     virtual uint8_t  getPeerSamplingRate(int8_t* /*full_packet*/) const { return 0; }
     virtual uint8_t getPeerBitResolution(int8_t* /*full_packet*/) const { return 0; }
-    virtual uint8_t  getPeerNumChannels(int8_t* /*full_packet*/) const { return 0; }
+    virtual uint16_t getPeerNumChannels(int8_t* /*full_packet*/) const { return 0; }
     virtual uint8_t  getPeerConnectionMode(int8_t* /*full_packet*/) const { return 0; }
 
     virtual void increaseSequenceNumber() {}
@@ -283,7 +584,7 @@ public:
     virtual uint16_t getPeerBufferSize(int8_t* /*full_packet*/) const { return 0; }
     virtual uint8_t  getPeerSamplingRate(int8_t* /*full_packet*/) const { return 0; }
     virtual uint8_t getPeerBitResolution(int8_t* /*full_packet*/) const { return 0; }
-    virtual uint8_t  getPeerNumChannels(int8_t* /*full_packet*/) const { return 0; }
+    virtual uint16_t getPeerNumChannels(int8_t* /*full_packet*/) const { return 0; }
     virtual uint8_t  getPeerConnectionMode(int8_t* /*full_packet*/) const { return 0; }
 
     virtual void putHeaderInPacket(int8_t* /*full_packet*/) {}
@@ -55,7 +55,8 @@ RingBuffer::RingBuffer(int SlotSize, int NumSlots) :
     mWritePosition(0),
     mFullSlots(0),
     mRingBuffer(new int8_t[mTotalSize]),
-    mLastReadSlot(new int8_t[mSlotSize])
+    mLastReadSlot(new int8_t[mSlotSize]),
+    mSlotTimes(new uint64_t[mNumSlots])
 {
     //QMutexLocker locker(&mMutex); // lock the mutex
 
@@ -80,6 +81,7 @@ RingBuffer::RingBuffer(int SlotSize, int NumSlots) :
   }
   */
     std::memset(mLastReadSlot, 0, mSlotSize); // set buffer to 0
+    std::memset(mSlotTimes, 0, mNumSlots * sizeof(uint64_t));
 
 
     // Advance write position to half of the RingBuffer
@@ -98,6 +100,8 @@ RingBuffer::~RingBuffer()
     mRingBuffer = NULL; // Clear to prevent using invalid memory reference
     delete[] mLastReadSlot;
     mLastReadSlot = NULL;
+    delete[] mSlotTimes;
+    mSlotTimes = NULL;
 }
 
 
@@ -124,7 +128,7 @@ void RingBuffer::insertSlotBlocking(const int8_t* ptrToSlot)
 
 
 //*******************************************************************************
-void RingBuffer::readSlotBlocking(int8_t* ptrToReadSlot)
+void RingBuffer::readSlotBlocking(int8_t* ptrToReadSlot, uint64_t* slot_time)
 {
     QMutexLocker locker(&mMutex); // lock the mutex
 
@@ -139,6 +143,7 @@ void RingBuffer::readSlotBlocking(int8_t* ptrToReadSlot)
     std::memcpy(ptrToReadSlot, mRingBuffer+mReadPosition, mSlotSize);
     // Always save memory of the last read slot
     std::memcpy(mLastReadSlot, mRingBuffer+mReadPosition, mSlotSize);
+    if (slot_time != NULL) { *slot_time = mSlotTimes[mReadPosition / mSlotSize]; }
     // Update write position
     mReadPosition = (mReadPosition+mSlotSize) % mTotalSize;
     mFullSlots--; //update full slots
@@ -148,7 +153,7 @@ void RingBuffer::readSlotBlocking(int8_t* ptrToReadSlot)
 
 
 //*******************************************************************************
-void RingBuffer::insertSlotNonBlocking(const int8_t* ptrToSlot)
+void RingBuffer::insertSlotNonBlocking(const int8_t* ptrToSlot, uint64_t slot_time)
 {
     QMutexLocker locker(&mMutex); // lock the mutex
 
@@ -165,6 +170,7 @@ void RingBuffer::insertSlotNonBlocking(const int8_t* ptrToSlot)
 
     // Copy mSlotSize bytes to mRingBuffer
     std::memcpy(mRingBuffer+mWritePosition, ptrToSlot, mSlotSize);
+    mSlotTimes[mWritePosition / mSlotSize] = slot_time;
     // Update write position
     mWritePosition = (mWritePosition+mSlotSize) % mTotalSize;
     mFullSlots++; //update full slots
@@ -174,7 +180,7 @@ void RingBuffer::insertSlotNonBlocking(const int8_t* ptrToSlot)
 
 
 //*******************************************************************************
-void RingBuffer::readSlotNonBlocking(int8_t* ptrToReadSlot)
+bool RingBuffer::readSlotNonBlocking(int8_t* ptrToReadSlot)
 {
     QMutexLocker locker(&mMutex); // lock the mutex
 
@@ -187,7 +193,7 @@ void RingBuffer::readSlotNonBlocking(int8_t* ptrToReadSlot)
         //std::memset(ptrToReadSlot, 0, mSlotSize);
         setUnderrunReadSlot(ptrToReadSlot);
         underrunReset();
-        return;
+        return false;
     }
 
     // Copy mSlotSize bytes to ReadSlot
@@ -199,6 +205,7 @@ void RingBuffer::readSlotNonBlocking(int8_t* ptrToReadSlot)
     mFullSlots--; //update full slots
     // Wake threads waitng for bufferIsNotFull condition
     mBufferIsNotFull.wakeAll();
+    return true;
 }
 
 
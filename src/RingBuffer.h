@@ -89,18 +89,21 @@ public:
    * sending/receiving UDP packets. It shouldn't be used by audio. For that, use the
    * readSlotNonBlocking.
    * \param ptrToReadSlot Pointer to read slot from the RingBuffer
+   * \param slot_time If not NULL, returns the time inserted with the slot (0 if none)
    */
-    void readSlotBlocking(int8_t* ptrToReadSlot);
+    void readSlotBlocking(int8_t* ptrToReadSlot, uint64_t* slot_time = NULL);
 
     /** \brief Same as insertSlotBlocking but non-blocking (asynchronous)
    * \param ptrToSlot Pointer to slot to insert into the RingBuffer
+   * \param slot_time Time that travels with the slot, like its capture time
    */
-    void insertSlotNonBlocking(const int8_t* ptrToSlot);
+    void insertSlotNonBlocking(const int8_t* ptrToSlot, uint64_t slot_time = 0);
 
     /** \brief Same as readSlotBlocking but non-blocking (asynchronous)
    * \param ptrToReadSlot Pointer to read slot from the RingBuffer
+   * \return false on underrun, the read slot is set by setUnderrunReadSlot then
    */
-    void readSlotNonBlocking(int8_t* ptrToReadSlot);
+    bool readSlotNonBlocking(int8_t* ptrToReadSlot);
 
     struct IOStat {
         uint32_t underruns;
@@ -141,6 +144,7 @@ private:
     int mFullSlots; ///< Number of used (full) slots, in slot-size
     int8_t* mRingBuffer; ///< 8-bit array of data (1-byte)
     int8_t* mLastReadSlot; ///< Last slot read
+    uint64_t* mSlotTimes; ///< Time inserted with each slot
 
     // Thread Synchronization Private Members
     QMutex mMutex; ///< Mutex to protect read and write operations
@@ -47,6 +47,7 @@
 #include "UdpHubListener.h"
 #include "JackTripWorker.h"
 #include "jacktrip_globals.h"
+#include "BlockFloatCodec.h"
 
 #include <iostream>
 #include <getopt.h> // for command line parsing
@@ -77,9 +78,27 @@ Settings::Settings() :
     #endif // endwhere
     mJamLink(false),
     mEmptyHeader(false),
+    mHeaderV2(false),
     mJackTripServer(false),
     mLocalAddress(gDefaultLocalAddress),
     mRedundancy(1),
+    mMultipath(false),
+    mHeartbeat(false),
+    mMtu(0),
+    mAggregation(1),
+    mSplit(1),
+    mFecGroupSize(0),
+    mFecParityCount(0),
+    mAdaptiveRedundancy(false),
+    mNack(false),
+    mLossless(false),
+    mOpusBitrate(0),
+    mOpusFrameUsec(2500),
+    mBlockFloatBits(0),
+    mHalfFloat(false),
+    mDtx(false),
+    mDtxGateDb(0.0),
+    mAdaptiveBitrateBits(0),
     mUseJack(true),
     mChanfeDefaultSR(false),
     mChanfeDefaultID(0),
@@ -127,11 +146,28 @@ void Settings::parseInput(int argc, char** argv)
     { "peerport", required_argument, NULL, 'P' }, // Port Offset from 4464
     { "queue", required_argument, NULL, 'q' }, // Queue Length
     { "redundancy", required_argument, NULL, 'r' }, // Redundancy
+    { "adaptiveredundancy", no_argument, NULL, 'W' }, // Adapt the redundancy to the peer loss
+    { "nack", no_argument, NULL, 'Q' }, // Ask the peer for lost packets
+    { "lossless", no_argument, NULL, 'O' }, // Code the audio losslessly
+    { "opus", required_argument, NULL, 'u' }, // Code the audio with Opus, bitrate and packet duration
+    { "blockfloat", required_argument, NULL, 'f' }, // Send the audio in block floating point, mantissa bits
+    { "halffloat", no_argument, NULL, 'a' }, // Send the audio in 16 bit floating point
+    { "dtx", required_argument, NULL, 'g' }, // Leave the channels under a gate out of the packets
+    { "adaptivebitrate", required_argument, NULL, 'k' }, // Lower the bit resolution on congestion, down to these bits
+    { "encrypt", required_argument, NULL, 'X' }, // Encrypt the packets, with a passphrase
+    { "multipath", optional_argument, NULL, 'M' }, // Multipath mode, with optional local paths
+    { "multicast", required_argument, NULL, 'm' }, // Send to a multicast group in server mode
+    { "heartbeat", no_argument, NULL, 'K' }, // Send heartbeat and goodbye packets
+    { "mtu", required_argument, NULL, 'U' }, // Split packets to fit the path MTU
+    { "aggregate", required_argument, NULL, 'A' }, // Audio periods in each packet
+    { "split", required_argument, NULL, 'Y' }, // Packets for each audio period
+    { "fec", required_argument, NULL, 'E' }, // Parity packets for groups of packets
     { "bitres", required_argument, NULL, 'b' }, // Audio Bit Resolution
     { "zerounderrun", no_argument, NULL, 'z' }, // Use Underrun to Zeros Mode
     { "loopback", no_argument, NULL, 'l' }, // Run in loopback mode
     { "jamlink", no_argument, NULL, 'j' }, // Run in JamLink mode
     { "emptyheader", no_argument, NULL, 'e' }, // Run in JamLink mode
+    { "headerv2", no_argument, NULL, 'Z' }, // Send version 2 headers
     { "clientname", required_argument, NULL, 'J' }, // Run in JamLink mode
     { "rtaudio", no_argument, NULL, 'R' }, // Run in JamLink mode
     { "srate", required_argument, NULL, 'T' }, // Set Sample Rate
@@ -245,6 +281,130 @@ void Settings::parseInput(int argc, char** argv)
                 mRedundancy = atoi(optarg);
             }
             break;
+        case 'M': // multipath
+            //-------------------------------------------------------
+            mMultipath = true;
+            if (optarg) {
+                mMultipathLocalPaths = QString(optarg).split(",", QString::SkipEmptyParts);
+            }
+            break;
+        case 'm': // multicast source
+            //-------------------------------------------------------
+            mMulticastGroup = optarg;
+            break;
+        case 'W': // adaptive redundancy
+            //-------------------------------------------------------
+            mAdaptiveRedundancy = true;
+            break;
+        case 'Q': // NACK
+            //-------------------------------------------------------
+            mNack = true;
+            break;
+        case 'O': // lossless
+            //-------------------------------------------------------
+            mLossless = true;
+            break;
+        case 'u': { // opus
+            //-------------------------------------------------------
+            QStringList opus = QString(optarg).split(",");
+            mOpusBitrate = opus.at(0).toInt();
+            mOpusFrameUsec = (opus.size() > 1) ? static_cast<int>(opus.at(1).toDouble() * 1000) : 2500;
+            if ( (mOpusBitrate < 6) || (mOpusBitrate > 256) ||
+                 ((mOpusFrameUsec != 2500) && (mOpusFrameUsec != 5000)) ) {
+                std::cerr << "--opus ERROR: Use 6 to 256 kb/s per channel and packets of 2.5 or 5 ms" << endl;
+                printUsage();
+                std::exit(1);
+            }
+            break; }
+        case 'f': // blockfloat
+            //-------------------------------------------------------
+            if ( (atoi(optarg) < BlockFloatCodec::sMinMantissaBits) ||
+                 (atoi(optarg) > BlockFloatCodec::sMaxMantissaBits) ) {
+                std::cerr << "--blockfloat ERROR: The mantissas have to be of "
+                          << BlockFloatCodec::sMinMantissaBits << " to "
+                          << BlockFloatCodec::sMaxMantissaBits << " bits" << endl;
+                printUsage();
+                std::exit(1); }
+            else {
+                mBlockFloatBits = atoi(optarg);
+            }
+            break;
+        case 'a': // halffloat
+            //-------------------------------------------------------
+            mHalfFloat = true;
+            break;
+        case 'g': // dtx
+            //-------------------------------------------------------
+            if ( (atof(optarg) < -120.0) || (atof(optarg) > 0.0) ) {
+                std::cerr << "--dtx ERROR: The gate has to be between -120 and 0 dBFS" << endl;
+                printUsage();
+                std::exit(1); }
+            else {
+                mDtx = true;
+                mDtxGateDb = atof(optarg);
+            }
+            break;
+        case 'k': // adaptivebitrate
+            //-------------------------------------------------------
+            if ( (atoi(optarg) != 8) && (atoi(optarg) != 16) && (atoi(optarg) != 24) ) {
+                std::cerr << "--adaptivebitrate ERROR: The lowest resolution has to be 8, 16 or 24 bits" << endl;
+                printUsage();
+                std::exit(1); }
+            else {
+                mAdaptiveBitrateBits = atoi(optarg);
+            }
+            break;
+        case 'X': // encrypt
+            //-------------------------------------------------------
+            mEncryptionPassphrase = optarg;
+            break;
+        case 'K': // heartbeat
+            //-------------------------------------------------------
+            mHeartbeat = true;
+            break;
+        case 'U': // mtu
+            //-------------------------------------------------------
+            if ( atoi(optarg) < gMinMtu ) {
+                std::cerr << "--mtu ERROR: The MTU has to be at least " << gMinMtu << " bytes" << endl;
+                printUsage();
+                std::exit(1); }
+            else {
+                mMtu = atoi(optarg);
+            }
+            break;
+        case 'A': // aggregate
+            //-------------------------------------------------------
+            if ( atoi(optarg) <= 0 ) {
+                std::cerr << "--aggregate ERROR: The number of periods per packet has to be at least 1" << endl;
+                printUsage();
+                std::exit(1); }
+            else {
+                mAggregation = atoi(optarg);
+            }
+            break;
+        case 'Y': // split
+            //-------------------------------------------------------
+            if ( atoi(optarg) <= 0 ) {
+                std::cerr << "--split ERROR: The number of packets per period has to be at least 1" << endl;
+                printUsage();
+                std::exit(1); }
+            else {
+                mSplit = atoi(optarg);
+            }
+            break;
+        case 'E': { // fec
+            //-------------------------------------------------------
+            QStringList fec = QString(optarg).split(",");
+            mFecGroupSize = fec.at(0).toInt();
+            mFecParityCount = (fec.size() > 1) ? fec.at(1).toInt() : 1;
+            if ( (mFecGroupSize < 1) || (mFecGroupSize > gMaxFecGroupSize) ||
+                 (mFecParityCount < 1) || (mFecParityCount > gMaxFecParity) ) {
+                std::cerr << "--fec ERROR: Use groups of 1 to " << gMaxFecGroupSize
+                          << " packets with 1 to " << gMaxFecParity << " parity packets" << endl;
+                printUsage();
+                std::exit(1);
+            }
+            break; }
         case 'z': // underrun to zero
             //-------------------------------------------------------
             mUnderrrunZero = true;
@@ -261,6 +421,10 @@ void Settings::parseInput(int argc, char** argv)
             //-------------------------------------------------------
             mJamLink = true;
             break;
+        case 'Z': // version 2 header
+            //-------------------------------------------------------
+            mHeaderV2 = true;
+            break;
         case 'J': // Set client Name
             //-------------------------------------------------------
             mClientName = optarg;
@@ -350,6 +514,106 @@ void Settings::parseInput(int argc, char** argv)
             break;
         }
 
+    if ( !mMulticastGroup.isEmpty() && (mJackTripMode != JackTrip::SERVER || mJackTripServer) ) {
+        std::cerr << "--multicast ERROR: a multicast source has to run in Server Mode (-s)" << endl;
+        printUsage();
+        std::exit(1);
+    }
+
+    if ( mHeaderV2 && (mJamLink || mEmptyHeader) ) {
+        std::cerr << "--headerv2 ERROR: it replaces the default header, it can't be used with --jamlink or --emptyheader" << endl;
+        printUsage();
+        std::exit(1);
+    }
+
+    if ( mMtu && (mJamLink || mEmptyHeader) ) {
+        std::cerr << "--mtu ERROR: packets can only be split with the default header" << endl;
+        printUsage();
+        std::exit(1);
+    }
+
+    if ( (mAggregation > 1 || mSplit > 1) && (mJamLink || mEmptyHeader) ) {
+        std::cerr << "--aggregate/--split ERROR: packets can only change size with the default header" << endl;
+        printUsage();
+        std::exit(1);
+    }
+
+    if ( mFecGroupSize && ((mRedundancy > 1) || mMtu || mJamLink || mEmptyHeader) ) {
+        std::cerr << "--fec ERROR: FEC can't be used with --redundancy, --mtu, --jamlink or --emptyheader" << endl;
+        printUsage();
+        std::exit(1);
+    }
+
+    if ( mNack && (mMtu || mJamLink || mEmptyHeader) ) {
+        std::cerr << "--nack ERROR: lost packets can't be asked for with --mtu, --jamlink or --emptyheader" << endl;
+        printUsage();
+        std::exit(1);
+    }
+
+    if ( mLossless && (mMtu || mJamLink || mEmptyHeader || (mAudioBitResolution == AudioInterface::BIT32)) ) {
+        std::cerr << "--lossless ERROR: audio can't be coded with --mtu, --jamlink, --emptyheader or 32 bits (-b 32)" << endl;
+        printUsage();
+        std::exit(1);
+    }
+
+    if ( mOpusBitrate && (mLossless || mJamLink || mEmptyHeader || (mAggregation > 1) || (mSplit > 1)) ) {
+        std::cerr << "--opus ERROR: Opus can't be used with --lossless, --jamlink, --emptyheader, --aggregate or --split" << endl;
+        printUsage();
+        std::exit(1);
+    }
+    if ( mBlockFloatBits && (mOpusBitrate || mLossless || mJamLink || mEmptyHeader || (mAggregation > 1) || (mSplit > 1)) ) {
+        std::cerr << "--blockfloat ERROR: block floating point can't be used with --opus, --lossless, --jamlink, --emptyheader, --aggregate or --split" << endl;
+        printUsage();
+        std::exit(1);
+    }
+    if ( mHalfFloat && (mOpusBitrate || mBlockFloatBits || mLossless || mJamLink || mEmptyHeader || (mAggregation > 1) || (mSplit > 1)) ) {
+        std::cerr << "--halffloat ERROR: half floats can't be used with --opus, --blockfloat, --lossless, --jamlink, --emptyheader, --aggregate or --split" << endl;
+        printUsage();
+        std::exit(1);
+    }
+
+    if ( mDtx && (mLossless || mFecGroupSize || mOpusBitrate || mBlockFloatBits || mHalfFloat || mJamLink || mEmptyHeader) ) {
+        std::cerr << "--dtx ERROR: silence suppression can't be used with --lossless, --fec, --opus, --blockfloat, --halffloat, --jamlink or --emptyheader" << endl;
+        printUsage();
+        std::exit(1);
+    }
+    if ( mAdaptiveBitrateBits && (mLossless || mDtx || mOpusBitrate || mBlockFloatBits || mHalfFloat || mJamLink || mEmptyHeader) ) {
+        std::cerr << "--adaptivebitrate ERROR: adaptive bitrate can't be used with --lossless, --dtx, --opus, --blockfloat, --halffloat, --jamlink or --emptyheader" << endl;
+        printUsage();
+        std::exit(1);
+    }
+#ifndef __OPUS__
+    if ( mOpusBitrate ) {
+        std::cerr << "--opus ERROR: this JackTrip was built without Opus" << endl;
+        std::exit(1);
+    }
+#endif
+#ifndef __OPENSSL__
+    if ( !mEncryptionPassphrase.isEmpty() ) {
+        std::cerr << "--encrypt ERROR: this JackTrip was built without OpenSSL" << endl;
+        std::exit(1);
+    }
+#endif
+
+    if ( !mEncryptionPassphrase.isEmpty() && !mJackTripServer
+         && (mJackTripMode != JackTrip::CLIENTTOPINGSERVER) ) {
+        std::cerr << "--encrypt ERROR: the keys are agreed with the hub server, use it with -S or -C" << endl;
+        printUsage();
+        std::exit(1);
+    }
+
+    if ( mAdaptiveRedundancy && (mRedundancy < 2) ) {
+        std::cerr << "--adaptiveredundancy ERROR: set the most copies per packet with --redundancy (2 or more)" << endl;
+        printUsage();
+        std::exit(1);
+    }
+
+    if ( (mAggregation > 1) && (mSplit > 1) ) {
+        std::cerr << "--aggregate ERROR: periods can't be aggregated and split at the same time" << endl;
+        printUsage();
+        std::exit(1);
+    }
+
     // Warn user if undefined options where entered
     //----------------------------------------------------------------------------
     if (optind < argc) {
@@ -398,6 +662,22 @@ void Settings::printUsage()
          << gDefaultQueueLength << ")" << endl;
     cout << " -r, --redundancy  # (1 or more)          Packet Redundancy to avoid glitches with packet losses (default: 1)"
          << endl;
+    cout << " --adaptiveredundancy                     Send only the copies the peer loss needs, up to --redundancy (the peer reports its loss)" << endl;
+    cout << " --nack                                   Ask the peer once for each lost packet and wait up to half the queue for it (use with -q 8 or more)" << endl;
+    cout << " --lossless                               Code the audio losslessly to send fewer bytes, packets that don't shrink are sent raw (not with -b 32; the peer must be a version that supports it)" << endl;
+    cout << " --opus            <kb/s>[,<ms>]          Code the audio with Opus at this bitrate per channel (6 to 256), in packets of 2.5 (default) or 5 ms; the peer must use the same settings" << endl;
+    cout << " --blockfloat      # (10 to 14)           Send the audio in block floating point with mantissas of this many bits: about the size of 16 bits with the range of 24 bits; the peer must use the same settings" << endl;
+    cout << " --halffloat                              Send the audio in 16 bit floating point: the size of 16 bits with more resolution at low levels and headroom above 0 dBFS; the peer must use the same settings" << endl;
+    cout << " --dtx             # (dBFS)               Leave out of the packets the channels whose peak stays under this gate (e.g. -60), the peer plays comfort noise instead (not with --fec; the peer must be a version that supports it)" << endl;
+    cout << " --adaptivebitrate # (8, 16 or 24)        Lower the bit resolution sent, down to this many bits, while the peer reports rising delay or loss, and raise it back once the path is clear (the peer must be a version that supports it)" << endl;
+    cout << " --encrypt         <passphrase>           Hub mode only (-S, -C): encrypt and authenticate the packets with AES-128-GCM, the client and server must use the same passphrase" << endl;
+    cout << " --multipath[=addr,...]                   Accept packets from several peer paths and keep the first copy; with local addresses (or interfaces), also send a copy of each packet from each of them" << endl;
+    cout << " --multicast <group_IP>                   Server Mode only: send once to a multicast group, listeners run with -c <group_IP>" << endl;
+    cout << " --heartbeat                              Send heartbeats and a goodbye on exit, so the peer notices quickly when we leave (the peer must be a version that supports them)" << endl;
+    cout << " --mtu             #                      Split packets larger than the path MTU (in bytes) and conceal only the missing parts when some are lost" << endl;
+    cout << " --aggregate       # (1 or more)          Send this many audio periods in each packet, fewer packets for # - 1 periods of extra latency (default: 1)" << endl;
+    cout << " --split           # (1 or more)          Send each audio period in this many packets, so losses and jitter are handled in smaller pieces (default: 1)" << endl;
+    cout << " --fec <K>[,<M>]                          Send M (default: 1) parity packets for every K packets, any M lost packets of a group are rebuilt (M = 1 is XOR parity)" << endl;
     cout << " -o, --portoffset  #                      Receiving port offset from base port " << gDefaultPort << endl;
     cout << " --bindport        #                      Set only the bind port number (default: 4464)" << endl;
     cout << " --peerport        #                      Set only the Peer port number (default: 4464)" << endl;
@@ -406,6 +686,7 @@ void Settings::printUsage()
     cout << " -z, --zerounderrun                       Set buffer to zeros when underrun occurs (default: wavetable)" << endl;
     cout << " -l, --loopback                           Run in Loop-Back Mode" << endl;
     cout << " -j, --jamlink                            Run in JamLink Mode (Connect to a JamLink Box)" << endl;
+    cout << " --headerv2                               Send version 2 headers, with 32-bit sequence numbers, more than 255 channels and round trip times in --iostat (both sides must use it; the hub server follows each client)" << endl;
     cout << " --clientname                             Change default client name (default: JackTrip)" << endl;
     cout << " --localaddress                           Change default local host IP address (default: 127.0.0.1)" << endl;
     cout << " --nojackportsconnect                     Don't connect default audio ports in jack" << endl;
@@ -515,6 +796,90 @@ void Settings::startJackTrip()
         if (gVerboseFlag) std::cout << "Settings:startJackTrip before mJackTrip->setPeerPorts" << std::endl;
         mJackTrip->setPeerPorts(mPeerPortNum);
 
+        // Set in Multipath Mode
+        if ( mMultipath ) {
+            cout << "Running in Multipath Mode..." << endl;
+            cout << gPrintSeparator << std::endl;
+            mJackTrip->setMultipath(true, mMultipathLocalPaths);
+        }
+
+        // Send heartbeat and goodbye packets
+        if ( mHeartbeat ) {
+            mJackTrip->setHeartbeat(true);
+        }
+
+        // Split packets to fit the path MTU
+        if ( mMtu ) {
+            mJackTrip->setMtu(mMtu);
+        }
+
+        // Send several audio periods in each packet
+        if ( mAggregation > 1 ) {
+            mJackTrip->setAggregation(mAggregation);
+        }
+
+        // Send each audio period in several packets
+        if ( mSplit > 1 ) {
+            mJackTrip->setSplit(mSplit);
+        }
+
+        // Adapt the redundancy to the peer loss
+        if ( mAdaptiveRedundancy ) {
+            mJackTrip->setAdaptiveRedundancy(true);
+        }
+
+        // Ask the peer for lost packets
+        if ( mNack ) {
+            mJackTrip->setNack(true);
+        }
+
+        // Code the audio losslessly
+        if ( mLossless ) {
+            mJackTrip->setLossless(true);
+        }
+
+        // Code the audio with Opus
+        if ( mOpusBitrate ) {
+            mJackTrip->setCodec(AudioCodec::OPUS, mOpusBitrate * 1000, mOpusFrameUsec);
+        }
+
+        // Send the audio in block floating point
+        if ( mBlockFloatBits ) {
+            mJackTrip->setBlockFloat(mBlockFloatBits);
+        }
+
+        // Send the audio in 16 bit floating point
+        if ( mHalfFloat ) {
+            mJackTrip->setCodec(AudioCodec::HALFFLOAT, 0, 0);
+        }
+
+        // Leave the silent channels out of the packets
+        if ( mDtx ) {
+            mJackTrip->setDtx(true, mDtxGateDb);
+        }
+
+        // Lower the bit resolution while the path is congested
+        if ( mAdaptiveBitrateBits ) {
+            mJackTrip->setAdaptiveBitrate(mAdaptiveBitrateBits);
+        }
+
+        // Encrypt the packets with keys agreed with the hub server
+        if ( !mEncryptionPassphrase.isEmpty() ) {
+            mJackTrip->setEncryptionPassphrase(mEncryptionPassphrase);
+        }
+
+        // Send FEC parity packets
+        if ( mFecGroupSize ) {
+            mJackTrip->setFec(mFecGroupSize, mFecParityCount);
+        }
+
+        // Set in Multicast Mode
+        if ( !mMulticastGroup.isEmpty() ) {
+            cout << "Running as Multicast Source..." << endl;
+            cout << gPrintSeparator << std::endl;
+            mJackTrip->setMulticastGroup(mMulticastGroup);
+        }
+
         // Set in JamLink Mode
         if ( mJamLink ) {
             cout << "Running in JamLink Mode..." << endl;
@@ -529,6 +894,11 @@ void Settings::startJackTrip()
             mJackTrip->setPacketHeaderType(DataProtocol::EMPTY);
         }
 
+        // Send version 2 headers
+        if ( mHeaderV2 ) {
+            mJackTrip->setPacketHeaderType(DataProtocol::DEFAULT_V2);
+        }
+
         // Set RtAudio
 #ifdef __RT_AUDIO__
         if (!mUseJack) {
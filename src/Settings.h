@@ -71,6 +71,25 @@ public:
 
     bool getLoopBack() { return mLoopBack; }
     int getIOStatTimeout() const {return mIOStatTimeout;}
+    bool isMultipath() const {return mMultipath;}
+    const QStringList& getMultipathLocalPaths() const {return mMultipathLocalPaths;}
+    bool isHeartbeat() const {return mHeartbeat;}
+    int getMtu() const {return mMtu;}
+    int getAggregation() const {return mAggregation;}
+    int getSplit() const {return mSplit;}
+    int getFecGroupSize() const {return mFecGroupSize;}
+    int getFecParityCount() const {return mFecParityCount;}
+    bool isAdaptiveRedundancy() const {return mAdaptiveRedundancy;}
+    bool isNack() const {return mNack;}
+    bool isLossless() const {return mLossless;}
+    int getOpusBitrate() const {return mOpusBitrate;}
+    int getOpusFrameUsec() const {return mOpusFrameUsec;}
+    int getBlockFloatBits() const {return mBlockFloatBits;}
+    bool isHalfFloat() const {return mHalfFloat;}
+    bool isDtx() const {return mDtx;}
+    double getDtxGateDb() const {return mDtxGateDb;}
+    int getAdaptiveBitrateBits() const {return mAdaptiveBitrateBits;}
+    const QString& getEncryptionPassphrase() const {return mEncryptionPassphrase;}
     const std::ostream& getIOStatStream() const
     {
         return mIOStatStream.is_open() ? (std::ostream&)mIOStatStream : std::cout;
@@ -107,9 +126,30 @@ private:
     bool mLoopBack; ///< Loop-back mode
     bool mJamLink; ///< JamLink mode
     bool mEmptyHeader; ///< EmptyHeader mode
+    bool mHeaderV2; ///< Send version 2 headers
     bool mJackTripServer; ///< JackTrip Server mode
     QString mLocalAddress; ///< Local Address
     unsigned int mRedundancy; ///< Redundancy factor for data in the network
+    bool mMultipath; ///< Multipath mode
+    QString mMulticastGroup; ///< Multicast group for the server to send to
+    QStringList mMultipathLocalPaths; ///< Local addresses or interfaces of the extra paths
+    bool mHeartbeat; ///< Send heartbeat and goodbye packets
+    int mMtu; ///< Path MTU to split packets for, 0 to send them whole
+    int mAggregation; ///< Audio periods sent in each packet
+    int mSplit; ///< Packets sent for each audio period
+    int mFecGroupSize; ///< Packets per FEC group, 0 without FEC
+    int mFecParityCount; ///< Parity packets per FEC group
+    bool mAdaptiveRedundancy; ///< Adapt the redundancy to the peer loss
+    bool mNack; ///< Ask the peer for lost packets
+    bool mLossless; ///< Code the audio losslessly
+    int mOpusBitrate; ///< Opus bitrate of each channel in kb/s, 0 without Opus
+    int mOpusFrameUsec; ///< Duration of the Opus packets, in microseconds
+    int mBlockFloatBits; ///< Mantissa bits of the block floating point audio, 0 to send PCM
+    bool mHalfFloat; ///< Send the audio in 16 bit floating point
+    bool mDtx; ///< Leave the silent channels out of the packets
+    double mDtxGateDb; ///< Peak level under which a channel is silent, in dBFS
+    int mAdaptiveBitrateBits; ///< Lowest bit resolution sent on congestion, 0 to send the session one
+    QString mEncryptionPassphrase; ///< Encrypt the packets with keys derived from it
     bool mUseJack; ///< Use or not JackAduio
     bool mChanfeDefaultSR; ///< Change Default Sampling Rate
     bool mChanfeDefaultID; ///< Change Default device ID
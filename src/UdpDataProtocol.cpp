@@ -42,10 +42,13 @@
 #include <QHostInfo>
 
 #include <cstring>
+#include <cstddef>
 #include <iostream>
 #include <cstdlib>
 #include <cerrno>
 #include <stdexcept>
+#include <algorithm>
+#include <cmath>
 #ifdef __WIN_32__
 //#include <winsock.h>
 #include <winsock2.h> //cc need SD_SEND
@@ -53,6 +56,7 @@
 #endif
 #if defined (__LINUX__) || (__MAC_OSX__)
 #include <sys/socket.h> // for POSIX Sockets
+#include <unistd.h>
 #endif
 
 using std::cout; using std::endl;
@@ -72,10 +76,102 @@ UdpDataProtocol::UdpDataProtocol(JackTrip* jacktrip, const runModeT runmode,
     mBindPort(bind_port), mPeerPort(peer_port),
     mRunMode(runmode),
     mAudioPacket(NULL), mFullPacket(NULL),
-    mUdpRedundancyFactor(udp_redundancy_factor)
+    mUdpRedundancyFactor(udp_redundancy_factor),
+    mMultipath(false),
+    mSenderPort(0),
+    mDatagramSize(0),
+    mLastPacketUsec(0),
+    mMigratedPeerPort(0),
+    mHeartbeat(false),
+    mLastHeartbeatUsec(0),
+    mMtu(0),
+    mFullPacketSize(0),
+    mReceiveFormatSet(false),
+    mReceiveBufferSize(0),
+    mFragmentCount(1),
+    mFragmentSize(0),
+    mFragmentPacket(NULL),
+    mFragmentStarted(false),
+    mNextFragmentSeq(0),
+    mNewestFragmentSeq(0),
+    mFragmentCopies(1),
+    mFecGroupSize(0),
+    mFecParityCount(0),
+    mFec(NULL),
+    mFecGroupFill(0),
+    mFecFirstSeq(0),
+    mWindowActive(false),
+    mWindowStarted(false),
+    mFecNextGroup(0),
+    mWindowNextSeq(0),
+    mWindowNewestSeq(0),
+    mAdaptiveRedundancy(false),
+    mLowerLossReports(0),
+    mLastLossReportUsec(0),
+    mReportReceived(0),
+    mReportLost(0),
+    mReportMaxBurst(0),
+    mReportMinDelayUsec(0),
+    mReportDelayValid(false),
+    mLastMinDelayUsec(-1),
+    mLongSeqStarted(false),
+    mLastLongSeqNum(0),
+    mNack(false),
+    mNackDeadlineUsec(0),
+    mNackQueueUsec(0),
+    mLossless(false),
+    mLosslessEncoder(NULL),
+    mLosslessDecoder(NULL),
+    mDtx(false),
+    mDtxGateDb(0.0),
+    mDtxGate(0.0f),
+    mDtxHoldPackets(0),
+    mDtxAudioBytes(0),
+    mDtxSentBytes(0),
+    mDtxNoiseState(0x9E3779B9),
+    mAdaptiveBitrate(false),
+    mMinBytesPerSample(0),
+    mFullBytesPerSample(0),
+    mWireBytesPerSample(0),
+    mCleanReports(0),
+    mBitrateHoldReports(0),
+    mBitrateSwitches(0),
+    mCodedType(0),
+    mCodedEntrySize(0),
+    mCodedNewest(0),
+    mEchoTimeStamp(0),
+    mEchoArrivalUsec(-1),
+    mSmoothedRttUsec(0),
+    mRttVariationUsec(0),
+    mRttWarning(false),
+    mSendCipher(NULL),
+    mReceiveCipher(NULL),
+    mCipherCounter(0),
+    mAuthenticationFailed(false)
 {
     mStopped = false;
     mIPv6 = false;
+    mMulticast = false;
+    mPeerMigrated = false;
+    mMigrationCount = 0;
+    mMigrationGapMsec = 0;
+    mPeerHeartbeat = false;
+    mConcealedCount = 0;
+    mFecRecoveredCount = 0;
+    mRedundancyLevel = udp_redundancy_factor;
+    mPeerLossReports = false;
+    mRetransmittedCount = 0;
+    mNackPending = false;
+    SendTime no_send = { 0, -1, 0 };
+    mSendTimes.resize(gEchoHistory);
+    mSendTimes.fill(no_send);
+    mRttCount = 0;
+    mRttSumUsec = 0;
+    mRttMinUsec = 0;
+    mRttMaxUsec = 0;
+    mLatencySumUsec = 0;
+    mReplayNewest[0] = mReplayNewest[1] = 0;
+    mReplayMask[0] = mReplayMask[1] = 0;
     std::memset(&mPeerAddr, 0, sizeof(mPeerAddr));
     std::memset(&mPeerAddr6, 0, sizeof(mPeerAddr6));
     mPeerAddr.sin_port = htons(mPeerPort);
@@ -93,7 +189,20 @@ UdpDataProtocol::~UdpDataProtocol()
 {
     delete[] mAudioPacket;
     delete[] mFullPacket;
+    delete[] mFragmentPacket;
     wait();
+    delete mFec;
+    delete mLosslessEncoder;
+    delete mLosslessDecoder;
+    delete mSendCipher;
+    delete mReceiveCipher;
+    for (int i = 0; i < mPathSockets.size(); ++i) {
+#if defined (__WIN_32__)
+        closesocket(mPathSockets[i]);
+#else
+        ::close(mPathSockets[i]);
+#endif
+    }
 }
 
 
@@ -129,6 +238,7 @@ void UdpDataProtocol::setPeerAddress(const char* peerHostOrIP)
         //throw std::invalid_argument("Incorrect presentation format address");
         throw std::invalid_argument( error_message.toStdString());
     }
+    mMulticast = mPeerAddress.isMulticast();
     /*
     else {
         std::cout << "Peer Address set to: "
@@ -171,6 +281,19 @@ void UdpDataProtocol::setSocket(int &socket)
         }
     }
     mSocket = socket;
+
+    // Extra sockets to send a copy of each packet over every multipath path
+    if (mRunMode == SENDER) {
+        for (int i = 0; i < mMultipathLocalPaths.size(); ++i) {
+            try {
+                mPathSockets.append(bindPathSocket(mMultipathLocalPaths.at(i)));
+            } catch ( const std::exception & e ) {
+                emit signalError( e.what() );
+                return;
+            }
+            cout << "Multipath: sending copies from " << mMultipathLocalPaths.at(i).toStdString() << endl;
+        }
+    }
 }
 
 
@@ -269,24 +392,47 @@ int UdpDataProtocol::bindSocket()
         UdpSocket.setSocketDescriptor(sock_fd, QUdpSocket::BoundState,
                                       QUdpSocket::WriteOnly);
     }*/
-    if (!mIPv6) {
+    if (mMulticast) {
+        if (mRunMode == RECEIVER) {
+            // Listeners join the group on the interface chosen by the kernel
+            if (mIPv6) {
+                struct ipv6_mreq mreq6;
+                std::memset(&mreq6, 0, sizeof(mreq6));
+                mreq6.ipv6mr_multiaddr = mPeerAddr6.sin6_addr;
+                mreq6.ipv6mr_interface = 0;
+                if ( ::setsockopt(sock_fd, IPPROTO_IPV6, IPV6_JOIN_GROUP,
+                                  (char*)&mreq6, sizeof(mreq6)) < 0 )
+                { throw std::runtime_error("ERROR: Could not join the multicast group"); }
+            } else {
+                struct ip_mreq mreq;
+                std::memset(&mreq, 0, sizeof(mreq));
+                mreq.imr_multiaddr = mPeerAddr.sin_addr;
+                mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+                if ( ::setsockopt(sock_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP,
+                                  (char*)&mreq, sizeof(mreq)) < 0 )
+                { throw std::runtime_error("ERROR: Could not join the multicast group"); }
+            }
+        } else {
+            int ttl = gMulticastTtl;
+            if (mIPv6) {
+                ::setsockopt(sock_fd, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, (char*)&ttl, sizeof(ttl));
+            } else {
+                ::setsockopt(sock_fd, IPPROTO_IP, IP_MULTICAST_TTL, (char*)&ttl, sizeof(ttl));
+            }
+        }
+    }
+
+    // With encryption the socket is not connected, so a peer that changes address in
+    // the middle of a session can be followed: the RECEIVER checks the source of each
+    // packet instead (see checkPacketSource). Without it anyone could move the session,
+    // so IPv4 sockets are connected to the peer. (Multipath and multicast peers send
+    // from addresses we don't know in advance.)
+    if ( !mIPv6 && !mMulticast && !mMultipath && (mReceiveCipher == NULL) ) {
         // Connect only if we're using IPv4.
         // (Connecting presents an issue when a host has multiple IP addresses and the peer decides to send from
         // a different address. While this generally won't be a problem for IPv4, it will for IPv6.)
         if ( (::connect(sock_fd, (struct sockaddr *) &mPeerAddr, sizeof(mPeerAddr))) < 0)
         { throw std::runtime_error("ERROR: Could not connect UDP socket"); }
-#if defined (__LINUX__) || (__MAC_OSX__)
-        //if ( (::shutdown(sock_fd,SHUT_WR)) < 0)
-        //{ throw std::runtime_error("ERROR: Could shutdown SHUT_WR UDP socket"); }
-#endif
-#if defined __WIN_32__
-        /*int shut_sr = shutdown(sock_fd, SD_SEND);  //shut down sender's receive function
-        if ( shut_sr< 0)
-        {
-            fprintf(stderr, "ERROR: Could not shutdown SD_SEND UDP socket");
-            throw std::runtime_error("ERROR: Could not shutdown SD_SEND UDP socket");
-        }*/
-#endif
     }
 
     return sock_fd;
@@ -315,18 +461,140 @@ int UdpDataProtocol::bindSocket()
 }
 
 
+//*******************************************************************************
+#if defined (__WIN_32__)
+SOCKET UdpDataProtocol::bindPathSocket(const QString& local_path)
+#else
+int UdpDataProtocol::bindPathSocket(const QString& local_path)
+#endif
+{
+    QMutexLocker locker(&sUdpMutex);
+
+#if defined (__WIN_32__)
+    SOCKET sock_fd;
+#else
+    int sock_fd;
+#endif
+
+    // The path can be given as a local IP address or (on Linux) as an interface name
+    QHostAddress local_address;
+    bool is_address = local_address.setAddress(local_path);
+    if ( is_address &&
+         ((local_address.protocol() == QAbstractSocket::IPv6Protocol) != mIPv6) ) {
+        QString error_message = "Multipath local address '";
+        error_message.append(local_path);
+        error_message.append("' and the peer address are not of the same IP version");
+        throw std::invalid_argument( error_message.toStdString() );
+    }
+#if !defined (__LINUX__)
+    if (!is_address) {
+        QString error_message = "Multipath local address '";
+        error_message.append(local_path);
+        error_message.append("' is not a valid IP address");
+        throw std::invalid_argument( error_message.toStdString() );
+    }
+#endif
+
+    // Bind to an ephemeral port, so the extra sockets never take the packets
+    // that are addressed to the receiving socket
+    struct sockaddr_in local_addr;
+    struct sockaddr_in6 local_addr6;
+    if (mIPv6) {
+        sock_fd = socket(AF_INET6, SOCK_DGRAM, 0);
+        std::memset(&local_addr6, 0, sizeof(local_addr6));
+        local_addr6.sin6_family = AF_INET6;
+        local_addr6.sin6_addr = in6addr_any;
+        if (is_address) {
+            ::inet_pton(AF_INET6, local_address.toString().toLatin1().constData(),
+                        &local_addr6.sin6_addr);
+        }
+        local_addr6.sin6_port = htons(0);
+    } else {
+        sock_fd = socket(AF_INET, SOCK_DGRAM, 0);
+        std::memset(&local_addr, 0, sizeof(local_addr));
+        local_addr.sin_family = AF_INET;
+        local_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (is_address) {
+            ::inet_pton(AF_INET, local_address.toString().toLatin1().constData(),
+                        &local_addr.sin_addr);
+        }
+        local_addr.sin_port = htons(0);
+    }
+#if defined (__WIN_32__)
+    if (sock_fd == INVALID_SOCKET)
+#else
+    if (sock_fd < 0)
+#endif
+    { throw std::runtime_error("ERROR: Could not create multipath UDP socket"); }
+
+#if defined (__LINUX__)
+    if (!is_address) {
+        QByteArray interface_name = local_path.toLatin1();
+        if ( ::setsockopt(sock_fd, SOL_SOCKET, SO_BINDTODEVICE,
+                          interface_name.constData(), interface_name.size()) < 0 ) {
+            QString error_message = "ERROR: Could not bind multipath socket to interface '";
+            error_message.append(local_path);
+            error_message.append("'");
+            ::close(sock_fd);
+            throw std::runtime_error( error_message.toStdString() );
+        }
+    }
+#endif
+
+    int bind_result;
+    if (mIPv6) {
+        bind_result = ::bind(sock_fd, (struct sockaddr *) &local_addr6, sizeof(local_addr6));
+    } else {
+        bind_result = ::bind(sock_fd, (struct sockaddr *) &local_addr, sizeof(local_addr));
+    }
+    if (bind_result < 0) {
+#if defined (__WIN_32__)
+        closesocket(sock_fd);
+#else
+        ::close(sock_fd);
+#endif
+        throw std::runtime_error("ERROR: Multipath UDP Socket Bind Error");
+    }
+    return sock_fd;
+}
+
+
 //*******************************************************************************
 int UdpDataProtocol::receivePacket(QUdpSocket& UdpSocket, char* buf, const size_t n)
 {
-    // Block until There's something to read
-    while ( (UdpSocket.pendingDatagramSize() < n) && !mStopped ) { QThread::usleep(100); }
-    int n_bytes = UdpSocket.readDatagram(buf, n);
+    // Block until There's something to read. Control packets are smaller
+    // than audio packets, so we don't wait for n bytes.
+    while ( !UdpSocket.hasPendingDatagrams() && !mStopped ) { QThread::usleep(100); }
+    // Keep the source, to follow a peer that changes address (and to identify
+    // the path in multipath mode)
+    mDatagramSize = UdpSocket.pendingDatagramSize();
+    int n_bytes = UdpSocket.readDatagram(buf, n, &mSenderAddress, &mSenderPort);
+    if ( (mReceiveCipher != NULL) && (n_bytes >= 0) ) {
+        n_bytes = decryptPacket(buf, n_bytes);
+        mDatagramSize = n_bytes;
+    }
+    // Compressed datagrams are handled as the raw ones they carry. Only the
+    // current peer's are expanded, unless they are authentic (the peer may
+    // have moved) or come over several paths. (A multicast source sends from
+    // its own address, not the group's.)
+    int8_t* packet = reinterpret_cast<int8_t*>(buf);
+    if ( !mMultipath && !mMulticast && (mReceiveCipher == NULL) &&
+         ((mSenderPort != mPeerPort) || (mSenderAddress != mPeerAddress)) ) {
+        return n_bytes;
+    }
+    if ( isControlPacket(packet, n_bytes) ) {
+        uint8_t type = reinterpret_cast<const ControlHeaderStruct*>(packet)->Type;
+        if ( (type == COMPRESSED) || (type == DTX) || (type == REDUCED) ) {
+            n_bytes = expandControlPayload(packet, n_bytes, static_cast<int>(n));
+            mDatagramSize = n_bytes;
+        }
+    }
     return n_bytes;
 }
 
 
 //*******************************************************************************
-int UdpDataProtocol::sendPacket(const char* buf, const size_t n)
+int UdpDataProtocol::sendPacket(const char* buf, size_t n)
 {
 /*#if defined (__WIN_32__)
     //Alternative windows specific code that uses winsock equivalents of the bsd socket functions.
@@ -346,17 +614,48 @@ int UdpDataProtocol::sendPacket(const char* buf, const size_t n)
     }
     return (int)n_bytes;
 #else*/
-    int n_bytes;
-    if (mIPv6) {
-        n_bytes = ::sendto(mSocket, buf, n, 0, (struct sockaddr *) &mPeerAddr6, sizeof(mPeerAddr6));
-    } else {
-        n_bytes = ::send(mSocket, buf, n, 0);
+    // Apply the new address if the peer moved
+    if (mPeerMigrated) {
+        QMutexLocker locker(&mMigrationMutex);
+        setPeerAddress( mMigratedPeerAddress.toString().toLatin1().constData() );
+        setPeerPort(mMigratedPeerPort);
+        mPeerMigrated = false;
+    }
+
+    int n_bytes = sendDatagram(buf, n);
+
+    // The extra paths only start once the peer answers, so a server always
+    // locks onto the default path with the first packet it receives.
+    // Each copy is sealed with its own counter, or the RECEIVER would drop the
+    // later ones as replays before it knows which path they came on.
+    if ( !mPathSockets.isEmpty() && mJackTrip->receivedConnectionFromPeer() ) {
+        for (int i = 0; i < mPathSockets.size(); ++i) {
+            size_t sealed_size = n;
+            const char* sealed = encryptPacket(buf, sealed_size);
+            if (mIPv6) {
+                ::sendto(mPathSockets[i], sealed, sealed_size, 0, (struct sockaddr *) &mPeerAddr6, sizeof(mPeerAddr6));
+            } else {
+                ::sendto(mPathSockets[i], sealed, sealed_size, 0, (struct sockaddr *) &mPeerAddr, sizeof(mPeerAddr));
+            }
+        }
     }
     return n_bytes;
 //#endif
 }
 
 
+//*******************************************************************************
+int UdpDataProtocol::sendDatagram(const char* buf, size_t n)
+{
+    buf = encryptPacket(buf, n);
+    if (mIPv6) {
+        return ::sendto(mSocket, buf, n, 0, (struct sockaddr *) &mPeerAddr6, sizeof(mPeerAddr6));
+    } else {
+        return ::sendto(mSocket, buf, n, 0, (struct sockaddr *) &mPeerAddr, sizeof(mPeerAddr));
+    }
+}
+
+
 //*******************************************************************************
 void UdpDataProtocol::getPeerAddressFromFirstPacket(QUdpSocket& UdpSocket,
                                                     QHostAddress& peerHostAddress,
@@ -392,13 +691,8 @@ void UdpDataProtocol::run()
     //If we're the sender, we'll just write directly to our socket.
     QUdpSocket UdpSocket;
     if (mRunMode == RECEIVER) {
-        if (mIPv6) {
-            UdpSocket.setSocketDescriptor(mSocket, QUdpSocket::BoundState,
-                                          QUdpSocket::ReadOnly);
-        } else {
-            UdpSocket.setSocketDescriptor(mSocket, QUdpSocket::ConnectedState,
-                                          QUdpSocket::ReadOnly);
-        }
+        UdpSocket.setSocketDescriptor(mSocket, QUdpSocket::BoundState,
+                                      QUdpSocket::ReadOnly);
         cout << "UDP Socket Receiving in Port: " << mBindPort << endl;
         cout << gPrintSeparator << endl;
     }
@@ -411,7 +705,9 @@ void UdpDataProtocol::run()
     std::memset(mAudioPacket, 0, audio_packet_size); // set buffer to 0
 
     // Setup Full Packet buffer
-    int full_packet_size = mJackTrip->getPacketSizeInBytes();
+    // (the RECEIVER starts with one period per packet, see JackTrip::setReceiveFormat)
+    int full_packet_size = (mRunMode == RECEIVER) ? mJackTrip->getReceivePacketSizeInBytes()
+                                                  : mJackTrip->getPacketSizeInBytes();
     //cout << "full_packet_size: " << full_packet_size << endl;
     mFullPacket = new int8_t[full_packet_size];
     std::memset(mFullPacket, 0, full_packet_size); // set buffer to 0
@@ -419,15 +715,23 @@ void UdpDataProtocol::run()
     //  bool timeout = false; // Time out flag for packets that arrive too late
 
     // Put header in first packet
-    mJackTrip->putHeaderInPacket(mFullPacket, mAudioPacket);
+    if (mRunMode == SENDER) {
+        mJackTrip->putHeaderInPacket(mFullPacket, mAudioPacket);
+    }
 
     // Redundancy Variables
     // (Algorithm explained at the end of this file)
     // ---------------------------------------------
     int full_redundant_packet_size = full_packet_size * mUdpRedundancyFactor;
+    // The RECEIVER also gets control packets, that can be larger than an audio packet
+    mFullPacketSize = full_packet_size;
+    mReceiveBufferSize = full_redundant_packet_size;
+    if ( (mRunMode == RECEIVER) && (mReceiveBufferSize < gMaxDatagramSize) ) {
+        mReceiveBufferSize = gMaxDatagramSize;
+    }
     int8_t* full_redundant_packet;
-    full_redundant_packet = new int8_t[full_redundant_packet_size];
-    std::memset(full_redundant_packet, 0, full_redundant_packet_size); // Initialize to 0
+    full_redundant_packet = new int8_t[mReceiveBufferSize];
+    std::memset(full_redundant_packet, 0, mReceiveBufferSize); // Initialize to 0
 
     // Set realtime priority (function in jacktrip_globals.h)
     if (gVerboseFlag) std::cout << "    UdpDataProtocol:run" << mRunMode << " before setRealtimeProcessPriority()" << std::endl;
@@ -506,22 +810,55 @@ void UdpDataProtocol::run()
         // from that packet
         if (gVerboseFlag) std::cout << "    UdpDataProtocol:run" << mRunMode << " before !UdpSocket.hasPendingDatagrams()" << std::endl;
         std::cout << "Waiting for Peer..." << std::endl;
-        // This blocks waiting for the first packet
-        while ( !UdpSocket.hasPendingDatagrams() ) {
-            if (mStopped) { return; }
-            QThread::msleep(100);
-            if (gVerboseFlag) std::cout << "100ms  " << std::flush;
-        }
-        int first_packet_size = UdpSocket.pendingDatagramSize();
-        // The following line is the same as
-        int8_t* first_packet = new int8_t[first_packet_size];
-        /// \todo fix this to avoid memory leaks
-        // but avoids memory leaks
-        //std::tr1::shared_ptr<int8_t> first_packet(new int8_t[first_packet_size]);
-        receivePacket( UdpSocket, reinterpret_cast<char*>(first_packet), first_packet_size);
+        // This blocks waiting for the first packet. Control packets left from a
+        // previous session are skipped, but a split packet starts the session
+        // with its first fragment (which has the header).
+        int header_size = mJackTrip->getHeaderSizeInBytes();
+        int8_t* first_packet = NULL;
+        while ( first_packet == NULL ) {
+            while ( !UdpSocket.hasPendingDatagrams() ) {
+                if (mStopped) { return; }
+                QThread::msleep(100);
+                if (gVerboseFlag) std::cout << "100ms  " << std::flush;
+            }
+            int first_packet_size = receivePacket( UdpSocket, reinterpret_cast<char*>(full_redundant_packet),
+                                                   mReceiveBufferSize );
+            if ( isControlPacket(full_redundant_packet, first_packet_size) ) {
+                const FragmentHeaderStruct* fragment =
+                        reinterpret_cast<const FragmentHeaderStruct*>(full_redundant_packet);
+                if ( (first_packet_size >= static_cast<int>(sizeof(FragmentHeaderStruct)) + header_size) &&
+                     (fragment->Type == FRAGMENT) && (fragment->FragmentIndex == 0) ) {
+                    first_packet = full_redundant_packet + sizeof(FragmentHeaderStruct);
+                }
+            } else if (first_packet_size >= header_size) {
+                first_packet = full_redundant_packet;
+            }
+        }
         // Check that peer has the same audio settings
         if (gVerboseFlag) std::cout << std::endl << "    UdpDataProtocol:run" << mRunMode << " before mJackTrip->checkPeerSettings()" << std::endl;
         mJackTrip->checkPeerSettings(first_packet);
+        // The peer packets can hold more or fewer frames than our period, in
+        // another bit resolution or sampling rate
+        mJackTrip->setReceiveFormat(first_packet);
+        mReceiveFormatSet = true;
+        if ( mJackTrip->getReceivePacketSizeInBytes() != full_packet_size ) {
+            setAudioPacketSize(mJackTrip->getReceiveAudioPacketSizeInBytes());
+            delete[] mAudioPacket;
+            mAudioPacket = new int8_t[getAudioPacketSizeInBites()];
+            std::memset(mAudioPacket, 0, getAudioPacketSizeInBites());
+            full_packet_size = mJackTrip->getReceivePacketSizeInBytes();
+            delete[] mFullPacket;
+            mFullPacket = new int8_t[full_packet_size];
+            std::memset(mFullPacket, 0, full_packet_size);
+            full_redundant_packet_size = full_packet_size * mUdpRedundancyFactor;
+            mFullPacketSize = full_packet_size;
+            if (mReceiveBufferSize < full_redundant_packet_size) {
+                mReceiveBufferSize = full_redundant_packet_size;
+                delete[] full_redundant_packet;
+                full_redundant_packet = new int8_t[mReceiveBufferSize];
+                std::memset(full_redundant_packet, 0, mReceiveBufferSize);
+            }
+        }
         if (gVerboseFlag) std::cout << "step 7" << std::endl;
         if (gVerboseFlag) std::cout << "    UdpDataProtocol:run" << mRunMode << " before mJackTrip->parseAudioPacket()" << std::endl;
         mJackTrip->parseAudioPacket(mFullPacket, mAudioPacket);
@@ -540,6 +877,49 @@ void UdpDataProtocol::run()
         mOutOfOrderCount = 0;
         mRevivedCount = 0;
         mStatCount = 0;
+        mLongSeqStarted = false;
+        mSmoothedRttUsec = 0;
+        mRttVariationUsec = 0;
+        mReceiveTimer.start();
+        mLastPacketUsec = 0;
+
+        // Multipath Variables
+        // -------------------
+        if (mMultipath) {
+            QMutexLocker locker(&mPathMutex);
+            SeenPacket unseen = { false, 0, 0 };
+            mPaths.clear();
+            mSeenPackets.resize(gMultipathHistory);
+            mSeenPackets.fill(unseen);
+        }
+
+        // Reassembly Variables
+        // --------------------
+        Reassembly unused = { false, 0, 0, 0, 0 };
+        mReassembly.resize(gFragmentWindow);
+        mReassembly.fill(unused);
+        mReassemblyBuffer.resize(gFragmentWindow * full_packet_size);
+        mLastReassembled.resize(full_packet_size);
+        mLastReassembled.fill(0);
+        mFragmentStarted = false;
+        mConcealedCount = 0;
+
+        // Window Variables (set up with the first FEC parity packet without NACK)
+        // ----------------------------------------------------------------------
+        mWindowActive = false;
+        mWindowStarted = false;
+        mFecRecoveredCount = 0;
+        mRetransmittedCount = 0;
+        if (mNack) {
+            // Missing packets are waited for while half of the audio queue plays
+            int periods = std::max(mJackTrip->getBufferQueueLength() / 2, 1);
+            mNackDeadlineUsec = static_cast<int64_t>(periods) * mJackTrip->getBufferSizeInSamples()
+                    * 1000000 / mJackTrip->getSampleRate();
+            mNackQueueUsec = mNackDeadlineUsec;
+            setupWindow();
+            cout << "NACK: waiting up to " << mNackDeadlineUsec / 1000.0
+                 << " ms for lost packets" << endl;
+        }
 
         if (gVerboseFlag) std::cout << "step 8" << std::endl;
         while ( !mStopped )
@@ -576,6 +956,14 @@ void UdpDataProtocol::run()
         break; }
 
     case SENDER : {
+        setupFragments(full_packet_size);
+        setupFec(full_packet_size);
+        setupLossless(full_packet_size);
+        setupDtx(full_packet_size);
+        setupAdaptiveBitrate(full_packet_size);
+        mNackHistory.resize(gNackHistory * full_packet_size);
+        mNackHistorySeq.resize(gNackHistory);
+        mNackHistorySeq.fill(-1);
         while ( !mStopped )
         {
             // OLD CODE WITHOUT REDUNDANCY -----------------------------------------------------
@@ -605,7 +993,10 @@ void UdpDataProtocol::waitForReady(QUdpSocket& UdpSocket, int timeout_msec)
     int emit_resolution_usec = 10000; // 10 milliseconds
     int timeout_usec = timeout_msec * 1000;
     int elapsed_time_usec = 0; // Ellapsed time in milliseconds
+    bool peer_gone = false;
 
+    sendHeartbeatIfDue();
+    sendLossReportIfDue();
     while ( ( !(
                   UdpSocket.hasPendingDatagrams() &&
                   (UdpSocket.pendingDatagramSize() > 0)
@@ -618,6 +1009,17 @@ void UdpDataProtocol::waitForReady(QUdpSocket& UdpSocket, int timeout_msec)
         if ( !(elapsed_time_usec % emit_resolution_usec) ) {
             emit signalWaitingTooLong(static_cast<int>(elapsed_time_usec/1000));
         }
+
+        // A peer that sends heartbeats doesn't go silent unless it's gone
+        if ( mPeerHeartbeat && !peer_gone &&
+             (elapsed_time_usec >= gHeartbeatTimeoutMsec * 1000) ) {
+            peer_gone = true;
+            std::cerr << "No heartbeat from " << mPeerAddress.toString().toStdString()
+                      << " for " << gHeartbeatTimeoutMsec << " ms" << endl;
+            emit signalPeerGone();
+        }
+        sendHeartbeatIfDue();
+        sendLossReportIfDue();
     }
     // cc under what condition?
     //  if ( elapsed_time_usec >= timeout_usec )
@@ -642,21 +1044,94 @@ void UdpDataProtocol::printUdpWaitedTooLong(int wait_msec)
 //*******************************************************************************
 void UdpDataProtocol::receivePacketRedundancy(QUdpSocket& UdpSocket,
                                               int8_t* full_redundant_packet,
-                                              int full_redundant_packet_size,
+                                              int /*full_redundant_packet_size*/,
                                               int full_packet_size,
                                               uint16_t& current_seq_num,
                                               uint16_t& last_seq_num,
                                               uint16_t& newer_seq_num)
 {
     // This is blocking until we get a packet...
-    receivePacket( UdpSocket, reinterpret_cast<char*>(full_redundant_packet),
-                   full_redundant_packet_size);
+    int n_bytes = receivePacket( UdpSocket, reinterpret_cast<char*>(full_redundant_packet),
+                                 mReceiveBufferSize);
+
+    // Audio datagrams carry whole packets, as many copies as the peer wants to
+    // send (see setAdaptiveRedundancy). Anything else is a control packet.
+    int copies = (mDatagramSize % full_packet_size == 0) ? (mDatagramSize / full_packet_size) : 0;
+    if ( (copies == 0) || isControlPacket(full_redundant_packet, n_bytes) ) {
+        processControlPacket(full_redundant_packet, n_bytes);
+        return;
+    }
+
+    // Drop packets from unknown addresses, unless the peer moved to a new one.
+    // (Multipath and multicast peers send from addresses we don't know in advance.)
+    if ( !mMultipath && !mMulticast &&
+         !checkPacketSource(full_redundant_packet, last_seq_num) ) {
+        return;
+    }
 
     // Get Packet Sequence Number
     newer_seq_num =
             mJackTrip->getPeerSequenceNumber(full_redundant_packet);
     current_seq_num = newer_seq_num;
 
+    // In multipath mode, drop the copies that arrive after the first one
+    if ( mMultipath && updatePathStats(newer_seq_num) ) { return; }
+
+    // With 32-bit sequence numbers, a packet half the 16-bit range or more ahead
+    // is a long outage, not a late packet. Count the gap here and start over.
+    if (mJackTrip->hasLongSequenceNumbers()) {
+        uint32_t long_seq_num = mJackTrip->getPeerLongSequenceNumber(full_redundant_packet);
+        int32_t long_gap = static_cast<int32_t>(long_seq_num - mLastLongSeqNum);
+        if ( mLongSeqStarted && (long_gap >= 0x8000) ) {
+            cout << "Resynchronizing after " << (long_gap - 1) << " lost packets" << endl;
+            mLostCount += long_gap - 1;
+            mTotCount += long_gap - 1;
+            mReportLost += long_gap - 1;
+            last_seq_num = newer_seq_num - 1;
+            mWindowStarted = false;
+        }
+        if ( !mLongSeqStarted || (long_gap > 0) ) {
+            mLastLongSeqNum = long_seq_num;
+            mLongSeqStarted = true;
+        }
+    }
+
+    if (mJackTrip->hasHeaderEcho()) {
+        measureRoundTrip(full_redundant_packet);
+    }
+
+    // Datagrams lost on the way, for the loss reports
+    measureOneWayDelay(full_redundant_packet);
+    int16_t gap = newer_seq_num - last_seq_num - 1;
+    if ( (0 != last_seq_num) && (gap > 0) ) {
+        mReportLost += gap;
+        mReportMaxBurst = std::max(mReportMaxBurst, static_cast<uint32_t>(gap));
+    }
+    ++mReportReceived;
+
+    // With FEC or NACK, packets are played in order from the window
+    if (mWindowActive) {
+        if ( (0 == last_seq_num) || (static_cast<int16_t>(newer_seq_num - last_seq_num) > 0) ) {
+            last_seq_num = newer_seq_num;
+        }
+        bool started = mWindowStarted;
+        uint16_t last_newest_seq = mWindowNewestSeq;
+        // Older copies first, so they aren't asked for again
+        for (int i = copies-1; i > 0; i--) {
+            const int8_t* copy = full_redundant_packet + (i*full_packet_size);
+            uint16_t copy_seq_num = mJackTrip->getPeerSequenceNumber(const_cast<int8_t*>(copy));
+            if ( !mWindowStarted || (static_cast<int16_t>(copy_seq_num - mWindowNextSeq) >= 0) ) {
+                storeWindowPacket(copy);
+            }
+        }
+        storeWindowPacket(full_redundant_packet);
+        if (mNack && started) {
+            sendNack(last_newest_seq);
+        }
+        playWindowPackets();
+        return;
+    }
+
     if (0 != last_seq_num) {
         int16_t lost = newer_seq_num - last_seq_num - 1;
         if (0 > lost) {
@@ -672,7 +1147,7 @@ void UdpDataProtocol::receivePacketRedundancy(QUdpSocket& UdpSocket,
 
     //cout << current_seq_num << " ";
     int redun_last_index = 0;
-    for (unsigned int i = 1; i<mUdpRedundancyFactor; i++) {
+    for (int i = 1; i<copies; i++) {
         // Check if the package we receive is the next one expected, i.e.,
         // current_seq_num == (last_seq_num+1)
         if ( current_seq_num == (last_seq_num+1) ) { break; }
@@ -706,12 +1181,1530 @@ bool UdpDataProtocol::getStats(DataProtocol::PktStat* stat)
         mLostCount = 0;
         mOutOfOrderCount = 0;
         mRevivedCount = 0;
+        mConcealedCount = 0;
+        mFecRecoveredCount = 0;
+        mRetransmittedCount = 0;
     }
     stat->tot = mTotCount;
     stat->lost = mLostCount;
     stat->outOfOrder = mOutOfOrderCount;
     stat->revived = mRevivedCount;
     stat->statCount = mStatCount++;
+    stat->migrations = mMigrationCount;
+    stat->migrationGapMsec = mMigrationGapMsec;
+    stat->concealed = mConcealedCount;
+    stat->recovered = mFecRecoveredCount;
+    stat->retransmitted = mRetransmittedCount;
+    stat->rttCount = mRttCount.exchange(0);
+    int64_t rtt_sum_usec = mRttSumUsec.exchange(0);
+    stat->rttMinMsec = mRttMinUsec.exchange(0) / 1000.0;
+    stat->rttMaxMsec = mRttMaxUsec.exchange(0) / 1000.0;
+    stat->rttAvgMsec = (stat->rttCount == 0) ? 0.0
+                                             : (rtt_sum_usec / 1000.0) / stat->rttCount;
+    int64_t latency_sum_usec = mLatencySumUsec.exchange(0);
+    stat->latencyAvgMsec = (stat->rttCount == 0) ? 0.0
+                                                 : (latency_sum_usec / 1000.0) / stat->rttCount;
+    return true;
+}
+
+//*******************************************************************************
+bool UdpDataProtocol::checkPacketSource(int8_t* full_redundant_packet,
+                                        uint16_t last_seq_num)
+{
+    int64_t now_usec = mReceiveTimer.nsecsElapsed() / 1000;
+    if ( (mSenderPort == mPeerPort) && (mSenderAddress == mPeerAddress) ) {
+        mLastPacketUsec = now_usec;
+        return true;
+    }
+
+    // A packet from another address is only taken as the peer moving if it's
+    // authentic (anyone can send a packet with our audio settings), with our
+    // audio settings and newer than the last one received
+    if (mReceiveCipher == NULL) { return false; }
+    int16_t seq_diff = mJackTrip->getPeerSequenceNumber(full_redundant_packet) - last_seq_num;
+    if ( !mJackTrip->matchesPeerSettings(full_redundant_packet) ||
+         (seq_diff <= 0) ) {
+        return false;
+    }
+
+    uint32_t gap_msec = static_cast<uint32_t>( (now_usec - mLastPacketUsec) / 1000 );
+    cout << "Peer moved from " << mPeerAddress.toString().toStdString() << ":" << mPeerPort
+         << " to " << mSenderAddress.toString().toStdString() << ":" << mSenderPort
+         << " (" << gap_msec << " ms without packets)" << endl;
+    setPeerAddress( mSenderAddress.toString().toLatin1().constData() );
+    setPeerPort(mSenderPort);
+    mJackTrip->getDataProtocolSender()->migratePeer(mSenderAddress, mSenderPort);
+    ++mMigrationCount;
+    mMigrationGapMsec = gap_msec;
+    mLastPacketUsec = now_usec;
+    emit signalPeerMigrated(mSenderAddress.toString(), mSenderPort);
+    return true;
+}
+
+//*******************************************************************************
+void UdpDataProtocol::sendControlPacket(uint8_t type)
+{
+    ControlHeaderStruct header;
+    std::memset(&header, 0, sizeof(header));
+    header.Magic = gControlPacketMagic;
+    header.Type = type;
+    sendDatagram(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+//*******************************************************************************
+void UdpDataProtocol::processControlPacket(const int8_t* packet, int size)
+{
+    // Control packets are only taken from the current peer
+    // (In multipath mode the peer sends from several addresses, and a multicast
+    // source from its own address, not the group's.)
+    if ( (size != mDatagramSize) || !isControlPacket(packet, size) ) { return; }
+    if ( !mMultipath && !mMulticast && ((mSenderPort != mPeerPort) || (mSenderAddress != mPeerAddress)) ) {
+        return;
+    }
+    const ControlHeaderStruct* header = reinterpret_cast<const ControlHeaderStruct*>(packet);
+
+    mLastPacketUsec = mReceiveTimer.nsecsElapsed() / 1000;
+    switch (header->Type) {
+    case HEARTBEAT :
+        if (!mPeerHeartbeat && gVerboseFlag) {
+            cout << "Peer " << mPeerAddress.toString().toStdString() << " sends heartbeats" << endl;
+        }
+        mPeerHeartbeat = true;
+        break;
+    case GOODBYE :
+        cout << "Peer " << mPeerAddress.toString().toStdString() << " said goodbye" << endl;
+        mPeerHeartbeat = true;
+        emit signalPeerGone();
+        break;
+    case FRAGMENT :
+        processFragment(packet, size);
+        break;
+    case FEC_PARITY :
+        processFecParity(packet, size);
+        break;
+    case LOSS_REPORT :
+        // Older versions send reports without the delay
+        if ( size >= static_cast<int>(offsetof(LossReportStruct, DelayChangeUsec)) ) {
+            const LossReportStruct* report = reinterpret_cast<const LossReportStruct*>(packet);
+            int32_t delay_change_usec = 0;
+            if ( size >= static_cast<int>(sizeof(LossReportStruct)) ) {
+                delay_change_usec = report->DelayChangeUsec;
+            }
+            mPeerLossReports = true;
+            mJackTrip->getDataProtocolSender()->reportPeerLoss(report->Received, report->Lost,
+                                                                report->MaxBurst, delay_change_usec);
+        }
+        break;
+    case NACK : {
+        const NackStruct* nack = reinterpret_cast<const NackStruct*>(packet);
+        int header_size = offsetof(NackStruct, SeqNumbers);
+        if ( (nack->Count <= gMaxNackSeqNumbers) &&
+             (size == header_size + nack->Count * static_cast<int>(sizeof(uint16_t))) ) {
+            mJackTrip->getDataProtocolSender()->requestRetransmission(nack->SeqNumbers, nack->Count);
+        }
+        break; }
+    default :
+        // Control packets from newer versions are ignored
+        break;
+    }
+}
+
+//*******************************************************************************
+void UdpDataProtocol::sendHeartbeatIfDue()
+{
+    if ( !(mHeartbeat || mPeerHeartbeat) || mMulticast ) { return; }
+    int64_t now_usec = mReceiveTimer.nsecsElapsed() / 1000;
+    if ( (now_usec - mLastHeartbeatUsec) < (gHeartbeatIntervalMsec * 1000) ) { return; }
+    mLastHeartbeatUsec = now_usec;
+    sendControlPacket(HEARTBEAT);
+}
+
+//*******************************************************************************
+void UdpDataProtocol::sendLossReportIfDue()
+{
+    if ( !(mAdaptiveRedundancy || mAdaptiveBitrate || mPeerLossReports) || mMulticast ) { return; }
+    int64_t now_usec = mReceiveTimer.nsecsElapsed() / 1000;
+    if ( (now_usec - mLastLossReportUsec) < (gLossReportIntervalMsec * 1000) ) { return; }
+    mLastLossReportUsec = now_usec;
+
+    LossReportStruct report;
+    std::memset(&report, 0, sizeof(report));
+    report.Magic = gControlPacketMagic;
+    report.Type = LOSS_REPORT;
+    report.Received = std::min<uint32_t>(mReportReceived, 0xFFFF);
+    report.Lost = std::min<uint32_t>(mReportLost, 0xFFFF);
+    report.MaxBurst = std::min<uint32_t>(mReportMaxBurst, 0xFFFF);
+    // The shortest delay of the interval follows the queues on the way. Jumps
+    // (the peer restarted its clock) aren't a trend.
+    if (mReportDelayValid) {
+        int64_t change = (mLastMinDelayUsec >= 0) ? mReportMinDelayUsec - mLastMinDelayUsec : 0;
+        if (std::abs(change) < 1000000) { report.DelayChangeUsec = static_cast<int32_t>(change); }
+        mLastMinDelayUsec = mReportMinDelayUsec;
+    }
+    mReportReceived = 0;
+    mReportLost = 0;
+    mReportMaxBurst = 0;
+    mReportDelayValid = false;
+    sendDatagram(reinterpret_cast<const char*>(&report), sizeof(report));
+}
+
+//*******************************************************************************
+void UdpDataProtocol::reportPeerLoss(uint16_t received, uint16_t lost, uint16_t max_burst,
+                                     int32_t delay_change_usec)
+{
+    if (received == 0 && lost == 0) { return; }
+    if (mAdaptiveBitrate) { adaptBitrate(received, lost, delay_change_usec); }
+    if (!mAdaptiveRedundancy) { return; }
+
+    // Enough copies to cover the longest burst lost. More copies are sent right
+    // away, fewer only after gRedundancyDecreaseReports reports in a row.
+    unsigned int level = mRedundancyLevel;
+    unsigned int needed = std::min(mUdpRedundancyFactor, static_cast<unsigned int>(max_burst) + 1);
+    if (needed > level) {
+        level = needed;
+        mLowerLossReports = 0;
+    } else if ( (needed < level) && (++mLowerLossReports >= gRedundancyDecreaseReports) ) {
+        --level;
+        mLowerLossReports = 0;
+    } else if (needed == level) {
+        mLowerLossReports = 0;
+    }
+    if (level != mRedundancyLevel) {
+        cout << "Redundancy: sending " << level << " copies of each packet (peer lost "
+             << lost << " of " << (received + lost) << ")" << endl;
+        mRedundancyLevel = level;
+    }
+}
+
+//*******************************************************************************
+void UdpDataProtocol::sendGoodbye()
+{
+    if ( !(mHeartbeat || mPeerHeartbeat) || mMulticast ) { return; }
+    // Send a few, in case one is lost
+    for (int i = 0; i < 3; ++i) {
+        sendControlPacket(GOODBYE);
+    }
+}
+
+//*******************************************************************************
+void UdpDataProtocol::setEncryptionKeys(const uint8_t* send_key, const uint8_t* receive_key)
+{
+    delete mSendCipher;
+    delete mReceiveCipher;
+    mSendCipher = new PacketCipher(send_key);
+    mReceiveCipher = new PacketCipher(receive_key);
+    // The SENDER and RECEIVER threads send with the same key, so they count apart
+    mCipherCounter = (mRunMode == RECEIVER) ? (uint64_t(1) << 63) : 0;
+    mReplayNewest[0] = mReplayNewest[1] = 0;
+    mReplayMask[0] = mReplayMask[1] = 0;
+    mAuthenticationFailed = false;
+    if (mRunMode == SENDER) {
+        cout << "Encrypting packets with AES-128-GCM" << endl;
+    }
+}
+
+//*******************************************************************************
+const char* UdpDataProtocol::encryptPacket(const char* buf, size_t& n)
+{
+    if (mSendCipher == NULL) { return buf; }
+    int header_size = sizeof(CipherHeaderStruct);
+    int size = header_size + static_cast<int>(n) + PacketCipher::TagSize;
+    if (mCipherPacket.size() < size) { mCipherPacket.resize(size); }
+    uint8_t* packet = reinterpret_cast<uint8_t*>(mCipherPacket.data());
+
+    CipherHeaderStruct header;
+    header.Counter = mCipherCounter++;
+    std::memcpy(packet, &header, header_size);
+    std::memcpy(packet + header_size, buf, n);
+    // Nonce: four zero bytes and the counter
+    uint8_t nonce[PacketCipher::NonceSize] = { 0 };
+    std::memcpy(nonce + 4, &header.Counter, sizeof(header.Counter));
+    mSendCipher->seal(nonce, packet, header_size, packet + header_size, static_cast<int>(n),
+                      packet + header_size + n);
+    n = size;
+    return mCipherPacket.data();
+}
+
+//*******************************************************************************
+int UdpDataProtocol::decryptPacket(char* buf, int n)
+{
+    if ( n < static_cast<int>(sizeof(CipherHeaderStruct)) ) { return 0; }
+    CipherHeaderStruct header;
+    std::memcpy(&header, buf, sizeof(header));
+
+    // Drop counters older than the last 64 ones, or received already
+    int stream = static_cast<int>(header.Counter >> 63);
+    uint64_t counter = header.Counter & ~(uint64_t(1) << 63);
+    uint64_t& newest = mReplayNewest[stream];
+    uint64_t& mask = mReplayMask[stream];
+    if ( (mask != 0) && (counter <= newest) ) {
+        uint64_t age = newest - counter;
+        if ( (age >= 64) || (mask & (uint64_t(1) << age)) ) { return 0; }
+    }
+
+    int size = openPacket(*mReceiveCipher, buf, n);
+    if (size < 0) {
+        if (!mAuthenticationFailed) {
+            mAuthenticationFailed = true;
+            std::cerr << "Dropping packets that fail authentication from "
+                      << mSenderAddress.toString().toStdString()
+                      << " (is the --encrypt passphrase the same?)" << endl;
+        }
+        return 0;
+    }
+
+    // Only authentic packets move the window
+    if (mask == 0) {
+        newest = counter;
+        mask = 1;
+    } else if (counter > newest) {
+        uint64_t shift = counter - newest;
+        mask = (shift >= 64) ? 1 : ((mask << shift) | 1);
+        newest = counter;
+    } else {
+        mask |= uint64_t(1) << (newest - counter);
+    }
+    return size;
+}
+
+//*******************************************************************************
+int UdpDataProtocol::openPacket(const PacketCipher& cipher, char* buf, int n)
+{
+    int header_size = sizeof(CipherHeaderStruct);
+    int size = n - header_size - PacketCipher::TagSize;
+    if (size < 0) { return -1; }
+    uint8_t* packet = reinterpret_cast<uint8_t*>(buf);
+    CipherHeaderStruct header;
+    std::memcpy(&header, packet, header_size);
+
+    uint8_t nonce[PacketCipher::NonceSize] = { 0 };
+    std::memcpy(nonce + 4, &header.Counter, sizeof(header.Counter));
+    if ( !cipher.open(nonce, packet, header_size, packet + header_size, size,
+                      packet + header_size + size) ) {
+        return -1;
+    }
+    std::memmove(buf, buf + header_size, size);
+    return size;
+}
+
+//*******************************************************************************
+bool UdpDataProtocol::isControlPacket(const int8_t* packet, int size) const
+{
+    return ( (size >= static_cast<int>(sizeof(ControlHeaderStruct))) &&
+             (reinterpret_cast<const ControlHeaderStruct*>(packet)->Magic == gControlPacketMagic) );
+}
+
+//*******************************************************************************
+void UdpDataProtocol::setupFragments(int full_packet_size)
+{
+    mFragmentCount = 1;
+    if (mMtu == 0) { return; }
+
+    // Room for the packets in a datagram, without the IP and UDP headers (and encryption)
+    int max_datagram_size = mMtu - (mIPv6 ? 48 : 28);
+    if (mSendCipher != NULL) {
+        max_datagram_size -= sizeof(CipherHeaderStruct) + PacketCipher::TagSize;
+    }
+    if ( static_cast<int>(full_packet_size * mUdpRedundancyFactor) <= max_datagram_size ) { return; }
+
+    // Every fragment carries whole samples, so a lost one can be concealed sample by sample
+    int header_size = mJackTrip->getHeaderSizeInBytes();
+    int sample_size = mJackTrip->getAudioBitResolution() / 8;
+    int audio_size = full_packet_size - header_size;
+    int fragment_size = (max_datagram_size - static_cast<int>(sizeof(FragmentHeaderStruct)))
+            / static_cast<int>(mUdpRedundancyFactor) - header_size;
+    fragment_size -= fragment_size % sample_size;
+    if (fragment_size < sample_size) {
+        std::cerr << "WARNING: The MTU is too small for the redundancy, packets are not split" << endl;
+        return;
+    }
+    if ( (audio_size + fragment_size - 1) / fragment_size > gMaxFragments ) {
+        // Larger fragments, the network will split them further
+        fragment_size = (audio_size + gMaxFragments - 1) / gMaxFragments;
+        fragment_size += (sample_size - fragment_size % sample_size) % sample_size;
+        std::cerr << "WARNING: Packets need more than " << gMaxFragments
+                  << " fragments, the fragments are larger than the MTU" << endl;
+    }
+    mFragmentSize = fragment_size;
+    mFragmentCount = (audio_size + fragment_size - 1) / fragment_size;
+
+    delete[] mFragmentPacket;
+    mFragmentPacket = new int8_t[sizeof(FragmentHeaderStruct) +
+            (header_size + fragment_size) * mUdpRedundancyFactor];
+    cout << "Splitting each packet in " << mFragmentCount << " fragments of "
+         << fragment_size << " audio bytes (MTU " << mMtu << ")" << endl;
+    cout << gPrintSeparator << endl;
+}
+
+//*******************************************************************************
+void UdpDataProtocol::getFragmentRange(int index, int fragment_size,
+                                       int& offset, int& length) const
+{
+    // The first fragment also carries the header
+    int header_size = mJackTrip->getHeaderSizeInBytes();
+    offset = (index == 0) ? 0 : header_size + index * fragment_size;
+    length = std::min(header_size + (index+1) * fragment_size, mFullPacketSize) - offset;
+}
+
+//*******************************************************************************
+void UdpDataProtocol::sendFragments(const int8_t* full_redundant_packet, int full_packet_size,
+                                    int copies)
+{
+    FragmentHeaderStruct* header = reinterpret_cast<FragmentHeaderStruct*>(mFragmentPacket);
+    header->Magic = gControlPacketMagic;
+    header->Type = FRAGMENT;
+    header->FragmentCount = mFragmentCount;
+    header->Copies = copies;
+    header->SeqNumber = mJackTrip->getSequenceNumber();
+    header->FragmentSize = mFragmentSize;
+
+    for (int i = 0; i < mFragmentCount; ++i) {
+        int offset, length;
+        getFragmentRange(i, mFragmentSize, offset, length);
+        header->FragmentIndex = i;
+        // Same fragment of each redundant packet, newest first
+        int8_t* data = mFragmentPacket + sizeof(FragmentHeaderStruct);
+        for (int j = 0; j < copies; ++j) {
+            std::memcpy(data, full_redundant_packet + (j*full_packet_size) + offset, length);
+            data += length;
+        }
+        sendPacket( reinterpret_cast<char*>(mFragmentPacket), data - mFragmentPacket );
+    }
+}
+
+//*******************************************************************************
+void UdpDataProtocol::processFragment(const int8_t* packet, int size)
+{
+    const FragmentHeaderStruct* header = reinterpret_cast<const FragmentHeaderStruct*>(packet);
+    int fragment_count = header->FragmentCount;
+    int fragment_size = header->FragmentSize;
+    int index = header->FragmentIndex;
+    int copies = header->Copies;
+    int header_size = mJackTrip->getHeaderSizeInBytes();
+
+    // Check that the fragments match our packet size
+    if ( (size < static_cast<int>(sizeof(FragmentHeaderStruct))) ||
+         (fragment_count > gMaxFragments) || (index >= fragment_count) ||
+         (copies == 0) || (fragment_size == 0) ||
+         (header_size + fragment_count * fragment_size < mFullPacketSize) ||
+         (header_size + (fragment_count-1) * fragment_size >= mFullPacketSize) ) {
+        return;
+    }
+    int offset, length;
+    getFragmentRange(index, fragment_size, offset, length);
+    if ( size != static_cast<int>(sizeof(FragmentHeaderStruct)) + copies * length ) { return; }
+
+    uint16_t seq_num = header->SeqNumber;
+    if (!mFragmentStarted) {
+        mFragmentStarted = true;
+        mNextFragmentSeq = seq_num;
+        mNewestFragmentSeq = seq_num;
+    }
+    if ( static_cast<int16_t>(seq_num - mNewestFragmentSeq) > 0 ) {
+        mNewestFragmentSeq = seq_num;
+    }
+    mFragmentCopies = copies;
+
+    // Make room if the peer went too far ahead
+    while ( static_cast<int16_t>(mNewestFragmentSeq - mNextFragmentSeq) >= gFragmentWindow ) {
+        playNextReassembled();
+    }
+
+    // Store the fragment of each packet in the datagram
+    const int8_t* data = packet + sizeof(FragmentHeaderStruct);
+    for (int j = 0; j < copies; ++j, data += length) {
+        uint16_t copy_seq_num = seq_num - j;
+        int16_t ahead = copy_seq_num - mNextFragmentSeq;
+        if ( (ahead < 0) || (ahead >= gFragmentWindow) ) { continue; } // Already played
+        int slot = copy_seq_num % gFragmentWindow;
+        Reassembly& reassembly = mReassembly[slot];
+        if ( !reassembly.valid || (reassembly.seqNum != copy_seq_num) ) {
+            reassembly.valid = true;
+            reassembly.seqNum = copy_seq_num;
+            reassembly.received = 0;
+        }
+        reassembly.fragmentCount = fragment_count;
+        reassembly.fragmentSize = fragment_size;
+        reassembly.received |= (uint64_t(1) << index);
+        std::memcpy(mReassemblyBuffer.data() + (slot * mFullPacketSize) + offset, data, length);
+    }
+
+    // Play the packets in order. A packet is played when it's complete, or with
+    // the missing fragments concealed once its last copy should have arrived.
+    while (true) {
+        const Reassembly& next = mReassembly[mNextFragmentSeq % gFragmentWindow];
+        bool complete = next.valid && (next.seqNum == mNextFragmentSeq) &&
+                (next.received == ( (next.fragmentCount == 64) ? ~uint64_t(0)
+                                                               : ((uint64_t(1) << next.fragmentCount) - 1) ));
+        int16_t behind = mNewestFragmentSeq - mNextFragmentSeq;
+        if ( !complete && (behind <= mFragmentCopies) ) { break; }
+        playNextReassembled();
+    }
+}
+
+//*******************************************************************************
+void UdpDataProtocol::playNextReassembled()
+{
+    int slot = mNextFragmentSeq % gFragmentWindow;
+    Reassembly& reassembly = mReassembly[slot];
+    int8_t* packet = mReassemblyBuffer.data() + (slot * mFullPacketSize);
+    ++mTotCount;
+
+    if ( !reassembly.valid || (reassembly.seqNum != mNextFragmentSeq) ) {
+        // Nothing arrived, the audio interface handles it like any lost packet
+        ++mLostCount;
+    } else {
+        bool concealed = false;
+        for (int i = 0; i < reassembly.fragmentCount; ++i) {
+            if ( !(reassembly.received & (uint64_t(1) << i)) ) {
+                // Use the samples of the previous packet in place of the lost ones
+                int offset, length;
+                getFragmentRange(i, reassembly.fragmentSize, offset, length);
+                std::memcpy(packet + offset, mLastReassembled.data() + offset, length);
+                concealed = true;
+            }
+        }
+        if (concealed) { ++mConcealedCount; }
+        std::memcpy(mFullPacket, packet, mFullPacketSize);
+        std::memcpy(mLastReassembled.data(), packet, mFullPacketSize);
+        mJackTrip->parseAudioPacket(mFullPacket, mAudioPacket);
+        mJackTrip->writeAudioBuffer(mAudioPacket);
+        reassembly.valid = false;
+    }
+    ++mNextFragmentSeq;
+}
+
+//*******************************************************************************
+void UdpDataProtocol::setupFec(int full_packet_size)
+{
+    if (mFecGroupSize == 0) { return; }
+    delete mFec;
+    mFec = new ForwardErrorCorrection(mFecGroupSize, mFecParityCount);
+    mFecGroupBuffer.resize( (mFecGroupSize + mFecParityCount) * full_packet_size );
+    mFecPacket.resize(sizeof(FecHeaderStruct) + full_packet_size);
+    mFecGroupFill = 0;
+    cout << "Sending " << mFecParityCount << " FEC parity packets for every "
+         << mFecGroupSize << " packets" << endl;
+    cout << gPrintSeparator << endl;
+}
+
+//*******************************************************************************
+void UdpDataProtocol::sendFecParity(int full_packet_size)
+{
+    // The group buffer has the packets of the group, then their parity packets
+    int group_size = mFec->getGroupSize();
+    int8_t* group = mFecGroupBuffer.data();
+    if (mFecGroupFill == 0) {
+        mFecFirstSeq = static_cast<uint16_t>(mJackTrip->getSequenceNumber());
+    }
+    std::memcpy(group + (mFecGroupFill * full_packet_size), mFullPacket, full_packet_size);
+    if (++mFecGroupFill < group_size) { return; }
+    mFecGroupFill = 0;
+
+    int8_t* parity = group + (group_size * full_packet_size);
+    mFec->encode(group, parity, full_packet_size);
+
+    FecHeaderStruct* header = reinterpret_cast<FecHeaderStruct*>(mFecPacket.data());
+    header->Magic = gControlPacketMagic;
+    header->Type = FEC_PARITY;
+    header->GroupSize = group_size;
+    header->ParityCount = mFec->getParityCount();
+    header->FirstSeqNumber = mFecFirstSeq;
+    header->PacketSize = full_packet_size;
+    for (int j = 0; j < mFec->getParityCount(); ++j) {
+        header->ParityIndex = j;
+        std::memcpy(mFecPacket.data() + sizeof(FecHeaderStruct),
+                    parity + (j * full_packet_size), full_packet_size);
+        sendPacket( reinterpret_cast<char*>(mFecPacket.data()), mFecPacket.size() );
+    }
+}
+
+//*******************************************************************************
+void UdpDataProtocol::setupLossless(int full_packet_size)
+{
+    delete mLosslessEncoder;
+    mLosslessEncoder = NULL;
+    if (!mLossless) { return; }
+
+    int channels = mJackTrip->getNumChannels();
+    int bytes_per_sample = mJackTrip->getAudioBitResolution() / 8;
+    int audio_size = static_cast<int>(getAudioPacketSizeInBites());
+    if ( (mFragmentCount > 1) || !LosslessCodec::isSupported(bytes_per_sample) ||
+         (channels == 0) || (audio_size % (channels * bytes_per_sample) != 0) ||
+         (audio_size > 0xFFFF) ) {
+        cout << "Lossless coding is off: packets are split, in 32 bits or too large" << endl;
+        cout << gPrintSeparator << endl;
+        return;
+    }
+    int frames = audio_size / (channels * bytes_per_sample);
+    mLosslessEncoder = new LosslessCodec(channels, bytes_per_sample, frames);
+
+    // The copies start as raw empty packets, like the ones of the redundancy
+    int entry_size = full_packet_size + sizeof(uint16_t);
+    int header_size = full_packet_size - audio_size;
+    setupCodedHistory(COMPRESSED, entry_size, entry_size, header_size, frames);
+    uint16_t raw_size = static_cast<uint16_t>(audio_size);
+    for (unsigned int i = 0; i < mUdpRedundancyFactor; i++) {
+        std::memcpy(mCodedHistory.data() + (i * entry_size) + header_size,
+                    &raw_size, sizeof(uint16_t));
+    }
+    cout << "Coding the audio losslessly" << endl;
+    cout << gPrintSeparator << endl;
+}
+
+//*******************************************************************************
+void UdpDataProtocol::sendCompressedPacket(int full_packet_size, int copies)
+{
+    // Only the new packet is coded, the older copies were coded when they were new
+    int header_size = full_packet_size - mLosslessEncoder->getAudioSize();
+    int8_t* entry = nextCodedCopy();
+    std::memcpy(entry, mFullPacket, header_size);
+    uint16_t coded_size = static_cast<uint16_t>(
+                mLosslessEncoder->encode(mFullPacket + header_size,
+                                         entry + header_size + sizeof(uint16_t)) );
+    std::memcpy(entry + header_size, &coded_size, sizeof(uint16_t));
+    mCodedSizes[mCodedNewest] = header_size + sizeof(uint16_t) + coded_size;
+    sendCodedPacket(copies);
+}
+
+//*******************************************************************************
+int UdpDataProtocol::checkCodedHeader(const int8_t* buf, int size, int buf_size) const
+{
+    if ( size < static_cast<int>(sizeof(CompressedHeaderStruct)) ) { return 0; }
+    const CompressedHeaderStruct* header = reinterpret_cast<const CompressedHeaderStruct*>(buf);
+    int bytes_per_sample = header->BytesPerSample;
+    if ( (header->Copies == 0) || (header->NumFrames == 0) ||
+         (bytes_per_sample < AudioInterface::BIT8) || (bytes_per_sample > AudioInterface::BIT32) ||
+         (header->NumChannels != mJackTrip->getNumChannels()) ||
+         (header->HeaderSize != mJackTrip->getHeaderSizeInBytes()) ) {
+        return 0;
+    }
+    // Before the first packet there's only the buffer to go by
+    if ( mReceiveFormatSet &&
+         ((header->NumFrames != mJackTrip->getReceivePacketFrames()) ||
+          (8 * bytes_per_sample != mJackTrip->getReceiveAudioBitResolution())) ) {
+        return 0;
+    }
+    int64_t full_packet_size = header->HeaderSize +
+            static_cast<int64_t>(header->NumChannels) * header->NumFrames * bytes_per_sample;
+    if ( (mReceiveFormatSet && (full_packet_size != mFullPacketSize)) ||
+         (header->Copies * full_packet_size > buf_size) ) {
+        return 0;
+    }
+    return static_cast<int>(full_packet_size);
+}
+
+//*******************************************************************************
+int UdpDataProtocol::expandControlPayload(int8_t* buf, int size, int buf_size)
+{
+    int full_packet_size = checkCodedHeader(buf, size, buf_size);
+    if (full_packet_size == 0) { return 0; }
+    const CompressedHeaderStruct* header = reinterpret_cast<const CompressedHeaderStruct*>(buf);
+    int copies = header->Copies;
+    int header_size = header->HeaderSize;
+    if (header->Type == COMPRESSED) {
+        int bytes_per_sample = header->BytesPerSample;
+        if ( !LosslessCodec::isSupported(bytes_per_sample) ) { return 0; }
+        // The decoder follows the format of the peer
+        if ( (mLosslessDecoder == NULL) ||
+             (mLosslessDecoder->getNumChannels() != header->NumChannels) ||
+             (mLosslessDecoder->getBytesPerSample() != bytes_per_sample) ||
+             (mLosslessDecoder->getNumFrames() != header->NumFrames) ) {
+            delete mLosslessDecoder;
+            mLosslessDecoder = new LosslessCodec(header->NumChannels, bytes_per_sample,
+                                                 header->NumFrames);
+        }
+    }
+    if (mCodedScratch.size() < copies * full_packet_size) {
+        mCodedScratch.resize(copies * full_packet_size);
+    }
+
+    // Each copy is a raw packet header and coded audio. Copies that are
+    // truncated or corrupted are dropped, with the older ones.
+    int8_t* raw = mCodedScratch.data();
+    int pos = sizeof(CompressedHeaderStruct);
+    int raw_size = 0;
+    for (int i = 0; i < copies; i++) {
+        if (pos + header_size > size) { break; }
+        std::memcpy(raw + raw_size, buf + pos, header_size);
+        pos += header_size;
+        int8_t* audio = raw + raw_size + header_size;
+        int used;
+        switch (header->Type) {
+        case COMPRESSED :
+            used = decompressCopy(buf + pos, size - pos, audio);
+            break;
+        case DTX :
+            used = expandDtxCopy(buf + pos, size - pos, header, audio);
+            break;
+        default :
+            used = expandReducedCopy(buf + pos, size - pos, header, audio);
+            break;
+        }
+        if (used < 0) { break; }
+        pos += used;
+        raw_size += full_packet_size;
+    }
+    std::memcpy(buf, raw, raw_size);
+    return raw_size;
+}
+
+//*******************************************************************************
+void UdpDataProtocol::setupCodedHistory(uint8_t type, int entry_size, int empty_size,
+                                        int header_size, int frames)
+{
+    mCodedType = type;
+    mCodedEntrySize = entry_size;
+    mCodedHistory.resize(mUdpRedundancyFactor * entry_size);
+    mCodedHistory.fill(0);
+    mCodedSizes.resize(mUdpRedundancyFactor);
+    mCodedSizes.fill(empty_size);
+    mCodedNewest = 0;
+
+    mCodedPacket.resize(sizeof(CompressedHeaderStruct) + mUdpRedundancyFactor * entry_size);
+    CompressedHeaderStruct* header = reinterpret_cast<CompressedHeaderStruct*>(mCodedPacket.data());
+    header->Magic = gControlPacketMagic;
+    header->Type = type;
+    header->Copies = 1;
+    header->BytesPerSample = mJackTrip->getAudioBitResolution() / 8;
+    header->Reserved = 0;
+    header->NumChannels = mJackTrip->getNumChannels();
+    header->NumFrames = frames;
+    header->HeaderSize = header_size;
+}
+
+//*******************************************************************************
+int8_t* UdpDataProtocol::nextCodedCopy()
+{
+    mCodedNewest = (mCodedNewest + 1) % mUdpRedundancyFactor;
+    return mCodedHistory.data() + (mCodedNewest * mCodedEntrySize);
+}
+
+//*******************************************************************************
+void UdpDataProtocol::sendCodedPacket(int copies)
+{
+    // Newest first, like the raw datagrams
+    reinterpret_cast<CompressedHeaderStruct*>(mCodedPacket.data())->Copies = copies;
+    int size = sizeof(CompressedHeaderStruct);
+    for (int i = 0; i < copies; i++) {
+        int index = (mCodedNewest + mUdpRedundancyFactor - i) % mUdpRedundancyFactor;
+        std::memcpy(mCodedPacket.data() + size,
+                    mCodedHistory.data() + (index * mCodedEntrySize), mCodedSizes[index]);
+        size += mCodedSizes[index];
+    }
+    sendPacket( reinterpret_cast<char*>(mCodedPacket.data()), size );
+}
+
+//*******************************************************************************
+int UdpDataProtocol::decompressCopy(const int8_t* data, int size, int8_t* audio)
+{
+    uint16_t coded_size;
+    if ( size < static_cast<int>(sizeof(uint16_t)) ) { return -1; }
+    std::memcpy(&coded_size, data, sizeof(uint16_t));
+    if ( (static_cast<int>(sizeof(uint16_t)) + coded_size > size) ||
+         !mLosslessDecoder->decode(data + sizeof(uint16_t), coded_size, audio) ) {
+        return -1;
+    }
+    return sizeof(uint16_t) + coded_size;
+}
+
+//*******************************************************************************
+void UdpDataProtocol::setupDtx(int full_packet_size)
+{
+    if (!mDtx) { return; }
+
+    int channels = mJackTrip->getNumChannels();
+    int bytes_per_sample = mJackTrip->getAudioBitResolution() / 8;
+    int audio_size = static_cast<int>(getAudioPacketSizeInBites());
+    if ( (mFragmentCount > 1) || (channels == 0) ||
+         (audio_size % (channels * bytes_per_sample) != 0) ||
+         (audio_size / (channels * bytes_per_sample) > 0xFFFF) ) {
+        cout << "Silence suppression is off: packets are split or too large" << endl;
+        cout << gPrintSeparator << endl;
+        return;
+    }
+    int frames = audio_size / (channels * bytes_per_sample);
+    int header_size = full_packet_size - audio_size;
+    mDtxGate = static_cast<sample_t>(std::pow(10.0, mDtxGateDb / 20.0));
+    mDtxHoldPackets = static_cast<int>(std::ceil(static_cast<double>(gDtxHoldMsec)
+                                                 * mJackTrip->getSampleRate() / (1000.0 * frames)));
+    mDtxHold.resize(channels);
+    mDtxHold.fill(0);
+    mDtxLevels.resize(channels);
+
+    // The copies start as packets of silence, like the ones of the redundancy
+    int bitmap_size = (channels + 7) / 8;
+    setupCodedHistory(DTX, full_packet_size + bitmap_size + channels,
+                      header_size + bitmap_size + channels, header_size, frames);
+    mDtxAudioBytes = 0;
+    mDtxSentBytes = 0;
+    cout << "Leaving out the channels under " << mDtxGateDb << " dBFS" << endl;
+    cout << gPrintSeparator << endl;
+}
+
+//*******************************************************************************
+void UdpDataProtocol::sendDtxPacket(int full_packet_size, int copies)
+{
+    const CompressedHeaderStruct* header =
+            reinterpret_cast<const CompressedHeaderStruct*>(mCodedPacket.data());
+    int channels = header->NumChannels;
+    int bytes_per_sample = header->BytesPerSample;
+    int frames = header->NumFrames;
+    int header_size = header->HeaderSize;
+    int channel_size = frames * bytes_per_sample;
+    int bitmap_size = (channels + 7) / 8;
+    AudioInterface::audioBitResolutionT resolution =
+            static_cast<AudioInterface::audioBitResolutionT>(bytes_per_sample);
+
+    // A channel opens when its peak reaches the gate and closes after the hold time
+    if (mDtxSamples.size() < frames) { mDtxSamples.resize(frames); }
+    sample_t* samples = mDtxSamples.data();
+    int muted = 0;
+    for (int ch = 0; ch < channels; ch++) {
+        AudioInterface::fromBitToSampleConversion(mFullPacket + header_size + (ch * channel_size),
+                                                  samples, frames, resolution);
+        sample_t peak = 0.0f;
+        double energy = 0.0;
+        for (int n = 0; n < frames; n++) {
+            peak = std::max(peak, std::fabs(samples[n]));
+            energy += static_cast<double>(samples[n]) * samples[n];
+        }
+        if (peak >= mDtxGate) {
+            mDtxHold[ch] = mDtxHoldPackets;
+        } else if (mDtxHold[ch] > 0) {
+            mDtxHold[ch]--;
+        }
+        mDtxLevels[ch] = 0;
+        if (mDtxHold[ch] == 0) {
+            ++muted;
+            double rms = std::sqrt(energy / frames);
+            if (rms > 0.0) {
+                mDtxLevels[ch] = static_cast<uint8_t>(
+                            std::max(1.0, std::min(255.0, std::floor(-20.0 * std::log10(rms) + 0.5))) );
+            }
+        }
+    }
+
+    // Only the new packet is gated, the older copies were gated when they were new
+    int8_t* entry = nextCodedCopy();
+    std::memcpy(entry, mFullPacket, header_size);
+    uint8_t* bitmap = reinterpret_cast<uint8_t*>(entry + header_size);
+    uint8_t* levels = bitmap + bitmap_size;
+    std::memset(bitmap, 0, bitmap_size);
+    int size = header_size + bitmap_size;
+    for (int ch = 0; ch < channels; ch++) {
+        if (mDtxHold[ch] == 0) { *levels++ = mDtxLevels[ch]; }
+        else { bitmap[ch / 8] |= static_cast<uint8_t>(1 << (ch % 8)); }
+    }
+    size += muted;
+    for (int ch = 0; ch < channels; ch++) {
+        if (mDtxHold[ch] == 0) { continue; }
+        std::memcpy(entry + size, mFullPacket + header_size + (ch * channel_size), channel_size);
+        size += channel_size;
+    }
+    mCodedSizes[mCodedNewest] = size;
+    mDtxAudioBytes += full_packet_size;
+    mDtxSentBytes += size;
+    sendCodedPacket(copies);
+}
+
+//*******************************************************************************
+int UdpDataProtocol::expandDtxCopy(const int8_t* data, int size,
+                                   const CompressedHeaderStruct* header, int8_t* audio)
+{
+    int channels = header->NumChannels;
+    int frames = header->NumFrames;
+    int bytes_per_sample = header->BytesPerSample;
+    int channel_size = frames * bytes_per_sample;
+    int bitmap_size = (channels + 7) / 8;
+    if (bitmap_size > size) { return -1; }
+    const uint8_t* bitmap = reinterpret_cast<const uint8_t*>(data);
+    int sent = 0;
+    for (int ch = 0; ch < channels; ch++) {
+        if (bitmap[ch / 8] & (1 << (ch % 8))) { ++sent; }
+    }
+    const uint8_t* levels = bitmap + bitmap_size;
+    int pos = bitmap_size + channels - sent;
+    if (pos + sent * channel_size > size) { return -1; }
+    for (int ch = 0; ch < channels; ch++) {
+        if (bitmap[ch / 8] & (1 << (ch % 8))) {
+            std::memcpy(audio, data + pos, channel_size);
+            pos += channel_size;
+        } else {
+            fillComfortNoise(audio, frames, bytes_per_sample, *levels++);
+        }
+        audio += channel_size;
+    }
+    return pos;
+}
+
+//*******************************************************************************
+void UdpDataProtocol::fillComfortNoise(int8_t* audio, int frames, int bytes_per_sample, uint8_t level)
+{
+    if (level == 0) {
+        std::memset(audio, 0, frames * bytes_per_sample);
+        return;
+    }
+    // Uniform noise of amplitude a has an RMS level of a / sqrt(3)
+    const sample_t amplitude = static_cast<sample_t>(std::pow(10.0, -level / 20.0) * std::sqrt(3.0));
+    AudioInterface::audioBitResolutionT resolution =
+            static_cast<AudioInterface::audioBitResolutionT>(bytes_per_sample);
+    if (mDtxSamples.size() < frames) { mDtxSamples.resize(frames); }
+    sample_t* samples = mDtxSamples.data();
+    for (int n = 0; n < frames; n++) {
+        // xorshift32
+        mDtxNoiseState ^= mDtxNoiseState << 13;
+        mDtxNoiseState ^= mDtxNoiseState >> 17;
+        mDtxNoiseState ^= mDtxNoiseState << 5;
+        samples[n] = amplitude * (static_cast<sample_t>(mDtxNoiseState) / 2147483648.0f - 1.0f);
+    }
+    AudioInterface::fromSampleToBitConversion(samples, audio, frames, resolution);
+}
+
+//*******************************************************************************
+// Converts planar audio to another bit resolution, a block of samples at a time
+static void convertBitResolution(const int8_t* input, int input_bytes,
+                                 int8_t* output, int output_bytes, int samples)
+{
+    AudioInterface::audioBitResolutionT input_resolution =
+            static_cast<AudioInterface::audioBitResolutionT>(input_bytes);
+    AudioInterface::audioBitResolutionT output_resolution =
+            static_cast<AudioInterface::audioBitResolutionT>(output_bytes);
+    sample_t block[256];
+    for (int n = 0; n < samples; n += 256) {
+        unsigned int count = std::min(samples - n, 256);
+        AudioInterface::fromBitToSampleConversion(input + (n * input_bytes), block, count, input_resolution);
+        AudioInterface::fromSampleToBitConversion(block, output + (n * output_bytes), count, output_resolution);
+    }
+}
+
+//*******************************************************************************
+void UdpDataProtocol::setupAdaptiveBitrate(int full_packet_size)
+{
+    mFullBytesPerSample = 0;
+    mWireBytesPerSample = 0;
+    if (!mAdaptiveBitrate) { return; }
+
+    int channels = mJackTrip->getNumChannels();
+    int bytes_per_sample = mJackTrip->getAudioBitResolution() / 8;
+    int audio_size = static_cast<int>(getAudioPacketSizeInBites());
+    if ( (mFragmentCount > 1) || (mCodedType != 0) ||
+         (channels == 0) || (audio_size % (channels * bytes_per_sample) != 0) ||
+         (audio_size / (channels * bytes_per_sample) > 0xFFFF) ) {
+        cout << "Adaptive bitrate is off: packets are split, compressed or too large" << endl;
+        cout << gPrintSeparator << endl;
+        return;
+    }
+    if (mMinBytesPerSample >= bytes_per_sample) {
+        cout << "Adaptive bitrate is off: the audio is already "
+             << 8 * bytes_per_sample << " bit" << endl;
+        cout << gPrintSeparator << endl;
+        return;
+    }
+    int header_size = full_packet_size - audio_size;
+
+    // The copies start as packets of silence at full resolution, like the ones of the redundancy
+    int entry_size = full_packet_size + 1;
+    setupCodedHistory(REDUCED, entry_size, entry_size, header_size,
+                      audio_size / (channels * bytes_per_sample));
+    for (int i = 0; i < static_cast<int>(mUdpRedundancyFactor); i++) {
+        mCodedHistory[i * entry_size + header_size] = static_cast<int8_t>(bytes_per_sample);
+    }
+
+    mCleanReports = 0;
+    mBitrateHoldReports = 0;
+    mBitrateSwitches = 0;
+    mFullBytesPerSample = bytes_per_sample;
+    mWireBytesPerSample = bytes_per_sample;
+    cout << "Adapting the bit resolution to the path, down to "
+         << 8 * mMinBytesPerSample << " bit" << endl;
+    cout << gPrintSeparator << endl;
+}
+
+//*******************************************************************************
+void UdpDataProtocol::adaptBitrate(uint16_t received, uint16_t lost, int32_t delay_change_usec)
+{
+    int wire_bytes = mWireBytesPerSample;
+    if (wire_bytes == 0) { return; }
+
+    // The queues on the way fill first (the delay rises), then overflow (loss).
+    // After a step down, the reports that still show the old queues are skipped.
+    if (mBitrateHoldReports > 0) {
+        --mBitrateHoldReports;
+        return;
+    }
+    bool congested = (100 * static_cast<int>(lost) > gBitrateLossPercent * (received + lost)) ||
+            (delay_change_usec > gBitrateDelayRiseUsec);
+    int new_wire_bytes = wire_bytes;
+    if (congested) {
+        mCleanReports = 0;
+        if (wire_bytes > mMinBytesPerSample) {
+            new_wire_bytes = wire_bytes - 1;
+            mBitrateHoldReports = gBitrateHoldReports;
+        }
+    } else if (++mCleanReports >= gBitrateIncreaseReports) {
+        mCleanReports = 0;
+        if (wire_bytes < mFullBytesPerSample) { new_wire_bytes = wire_bytes + 1; }
+    }
+    if (new_wire_bytes != wire_bytes) {
+        cout << "Adaptive bitrate: sending " << 8 * new_wire_bytes << " bit audio (peer lost "
+             << lost << " of " << (received + lost) << ", delay "
+             << (delay_change_usec >= 0 ? "+" : "") << delay_change_usec / 1000.0 << " ms)" << endl;
+        mWireBytesPerSample = new_wire_bytes;
+        ++mBitrateSwitches;
+    }
+}
+
+//*******************************************************************************
+void UdpDataProtocol::reducePacket()
+{
+    const CompressedHeaderStruct* header =
+            reinterpret_cast<const CompressedHeaderStruct*>(mCodedPacket.data());
+    int header_size = header->HeaderSize;
+    int samples = header->NumChannels * header->NumFrames;
+    // Switches happen here, at a packet boundary
+    int wire_bytes = mWireBytesPerSample;
+
+    int8_t* entry = nextCodedCopy();
+    std::memcpy(entry, mFullPacket, header_size);
+    entry[header_size] = static_cast<int8_t>(wire_bytes);
+    int8_t* wire_audio = entry + header_size + 1;
+    if (wire_bytes == mFullBytesPerSample) {
+        std::memcpy(wire_audio, mFullPacket + header_size, samples * wire_bytes);
+    } else {
+        convertBitResolution(mFullPacket + header_size, mFullBytesPerSample,
+                             wire_audio, wire_bytes, samples);
+        convertBitResolution(wire_audio, wire_bytes,
+                             mFullPacket + header_size, mFullBytesPerSample, samples);
+    }
+    mCodedSizes[mCodedNewest] = header_size + 1 + samples * wire_bytes;
+}
+
+//*******************************************************************************
+void UdpDataProtocol::sendReducedPacket(const int8_t* full_redundant_packet,
+                                        int full_packet_size, int copies)
+{
+    // Datagrams with only full resolution copies are sent raw
+    int entry_size = full_packet_size + 1;
+    bool reduced = false;
+    for (int i = 0; i < copies; i++) {
+        int index = (mCodedNewest + mUdpRedundancyFactor - i) % mUdpRedundancyFactor;
+        reduced = reduced || (mCodedSizes[index] != entry_size);
+    }
+    if (!reduced) {
+        sendPacket( reinterpret_cast<const char*>(full_redundant_packet),
+                    full_packet_size * copies );
+        return;
+    }
+    sendCodedPacket(copies);
+}
+
+//*******************************************************************************
+int UdpDataProtocol::expandReducedCopy(const int8_t* data, int size,
+                                       const CompressedHeaderStruct* header, int8_t* audio)
+{
+    int bytes_per_sample = header->BytesPerSample;
+    int samples = header->NumChannels * header->NumFrames;
+    if (size < 1) { return -1; }
+    int wire_bytes = data[0];
+    if ( (wire_bytes < AudioInterface::BIT8) || (wire_bytes > AudioInterface::BIT32) ||
+         (1 + samples * wire_bytes > size) ) {
+        return -1;
+    }
+    if (wire_bytes == bytes_per_sample) {
+        std::memcpy(audio, data + 1, samples * wire_bytes);
+    } else {
+        convertBitResolution(data + 1, wire_bytes, audio, bytes_per_sample, samples);
+    }
+    return 1 + samples * wire_bytes;
+}
+
+//*******************************************************************************
+void UdpDataProtocol::processFecParity(const int8_t* packet, int size)
+{
+    const FecHeaderStruct* header = reinterpret_cast<const FecHeaderStruct*>(packet);
+    int group_size = header->GroupSize;
+    int parity_count = header->ParityCount;
+    int parity_index = header->ParityIndex;
+    if ( (size != static_cast<int>(sizeof(FecHeaderStruct)) + mFullPacketSize) ||
+         (header->PacketSize != mFullPacketSize) ||
+         (group_size < 1) || (group_size > gMaxFecGroupSize) ||
+         (parity_count < 1) || (parity_count > gMaxFecParity) ||
+         (parity_index >= parity_count) ) {
+        return;
+    }
+
+    // The first parity packet switches to the FEC window
+    if ( (mFec == NULL) || (mFec->getGroupSize() != group_size) ||
+         (mFec->getParityCount() != parity_count) ) {
+        delete mFec;
+        mFec = new ForwardErrorCorrection(group_size, parity_count);
+        FecGroup unused = { false, false, 0, 0 };
+        mFecGroups.resize(gFecGroups);
+        mFecGroups.fill(unused);
+        mFecGroupParity.resize(gFecGroups * gMaxFecParity * mFullPacketSize);
+        mFecScratch.resize(group_size * mFullPacketSize);
+        mFecNextGroup = 0;
+        if (!mWindowActive) {
+            setupWindow();
+        }
+        cout << "Peer sends " << parity_count << " FEC parity packets for every "
+             << group_size << " packets" << endl;
+    }
+
+    // Find the group, or reuse the oldest entry
+    uint16_t first_seq_num = header->FirstSeqNumber;
+    int index = -1;
+    for (int i = 0; i < gFecGroups; ++i) {
+        if ( mFecGroups[i].valid && (mFecGroups[i].firstSeqNum == first_seq_num) ) {
+            index = i;
+            break;
+        }
+    }
+    if (index == -1) {
+        index = mFecNextGroup;
+        mFecNextGroup = (mFecNextGroup + 1) % gFecGroups;
+        FecGroup& group = mFecGroups[index];
+        group.valid = true;
+        group.done = false;
+        group.firstSeqNum = first_seq_num;
+        group.parityReceived = 0;
+    }
+    FecGroup& group = mFecGroups[index];
+    if (group.done) { return; }
+    std::memcpy(mFecGroupParity.data() + ((index * gMaxFecParity + parity_index) * mFullPacketSize),
+                packet + sizeof(FecHeaderStruct), mFullPacketSize);
+    group.parityReceived |= (uint32_t(1) << parity_index);
+
+    recoverFecGroup(index);
+    playWindowPackets();
+}
+
+//*******************************************************************************
+void UdpDataProtocol::setupWindow()
+{
+    WindowSlot empty = { false, 0, 0 };
+    mWindowSlots.resize(gReorderWindow);
+    mWindowSlots.fill(empty);
+    mWindowData.resize(gReorderWindow * mFullPacketSize);
+    mWindowStarted = false;
+    mWindowActive = true;
+}
+
+//*******************************************************************************
+void UdpDataProtocol::storeWindowPacket(const int8_t* packet)
+{
+    uint16_t seq_num = mJackTrip->getPeerSequenceNumber(const_cast<int8_t*>(packet));
+    if (!mWindowStarted) {
+        mWindowStarted = true;
+        mWindowNextSeq = seq_num;
+        mWindowNewestSeq = seq_num;
+    }
+    if ( static_cast<int16_t>(seq_num - mWindowNextSeq) < 0 ) {
+        // Played, or given up for lost, already
+        ++mOutOfOrderCount;
+        return;
+    }
+    WindowSlot& slot = mWindowSlots[seq_num % gReorderWindow];
+    if ( slot.valid && (slot.seqNum == seq_num) ) { return; }
+    if ( static_cast<int16_t>(seq_num - mWindowNewestSeq) > 0 ) {
+        mWindowNewestSeq = seq_num;
+    }
+
+    // Make room if the peer went too far ahead
+    while ( static_cast<int16_t>(mWindowNewestSeq - mWindowNextSeq) >= gReorderWindow ) {
+        playNextWindowPacket();
+    }
+    if ( (slot.seqNum == seq_num) && (slot.requestUsec != 0) ) {
+        // Sent again by the peer after a NACK
+        ++mRetransmittedCount;
+    }
+    slot.valid = true;
+    slot.seqNum = seq_num;
+    slot.requestUsec = 0;
+    std::memcpy(mWindowData.data() + ((seq_num % gReorderWindow) * mFullPacketSize),
+                packet, mFullPacketSize);
+
+    // A packet that arrives after the parity can complete its group
+    if (mFec == NULL) { return; }
+    int group_size = mFec->getGroupSize();
+    for (int i = 0; i < gFecGroups; ++i) {
+        const FecGroup& group = mFecGroups[i];
+        int16_t position = seq_num - group.firstSeqNum;
+        if ( group.valid && !group.done && (position >= 0) && (position < group_size) ) {
+            recoverFecGroup(i);
+        }
+    }
+}
+
+//*******************************************************************************
+void UdpDataProtocol::recoverFecGroup(int group_index)
+{
+    if (!mWindowStarted) { return; }
+    FecGroup& group = mFecGroups[group_index];
+    int group_size = mFec->getGroupSize();
+    int parity_count = mFec->getParityCount();
+
+    bool data_present[gMaxFecGroupSize];
+    bool parity_present[gMaxFecParity];
+    int missing = 0;
+    bool needed = false; // Some missing packet isn't played yet
+    for (int i = 0; i < group_size; ++i) {
+        uint16_t seq_num = group.firstSeqNum + i;
+        const WindowSlot& slot = mWindowSlots[seq_num % gReorderWindow];
+        data_present[i] = slot.valid && (slot.seqNum == seq_num);
+        if (!data_present[i]) {
+            ++missing;
+            if ( static_cast<int16_t>(seq_num - mWindowNextSeq) >= 0 ) { needed = true; }
+        }
+    }
+    if (missing == 0) {
+        group.done = true;
+        return;
+    }
+    int parity_received = 0;
+    for (int j = 0; j < parity_count; ++j) {
+        parity_present[j] = (group.parityReceived & (uint32_t(1) << j)) != 0;
+        if (parity_present[j]) { ++parity_received; }
+    }
+    if ( !needed || (parity_received < missing) ) { return; }
+
+    // Decode a copy of the group, then store the rebuilt packets in the window
+    int8_t* data = mFecScratch.data();
+    for (int i = 0; i < group_size; ++i) {
+        if (data_present[i]) {
+            uint16_t seq_num = group.firstSeqNum + i;
+            std::memcpy(data + (i * mFullPacketSize),
+                        mWindowData.data() + ((seq_num % gReorderWindow) * mFullPacketSize),
+                        mFullPacketSize);
+        }
+    }
+    const int8_t* parity = mFecGroupParity.data() + (group_index * gMaxFecParity * mFullPacketSize);
+    if ( !mFec->decode(data, data_present, parity, parity_present, mFullPacketSize) ) { return; }
+    group.done = true;
+    for (int i = 0; i < group_size; ++i) {
+        uint16_t seq_num = group.firstSeqNum + i;
+        if ( data_present[i] || (static_cast<int16_t>(seq_num - mWindowNextSeq) < 0) ) { continue; }
+        if ( static_cast<int16_t>(seq_num - mWindowNewestSeq) > 0 ) {
+            mWindowNewestSeq = seq_num;
+        }
+        WindowSlot& slot = mWindowSlots[seq_num % gReorderWindow];
+        slot.valid = true;
+        slot.seqNum = seq_num;
+        slot.requestUsec = 0;
+        std::memcpy(mWindowData.data() + ((seq_num % gReorderWindow) * mFullPacketSize),
+                    data + (i * mFullPacketSize), mFullPacketSize);
+        ++mFecRecoveredCount;
+    }
+}
+
+//*******************************************************************************
+void UdpDataProtocol::playWindowPackets()
+{
+    // With FEC, a missing packet is waited for while the rest of its group and the
+    // parity packets can still arrive, that is until a whole group is newer than it.
+    // With NACK, until the deadline for the packet sent again is over.
+    int64_t now_usec = mReceiveTimer.nsecsElapsed() / 1000;
+    while ( mWindowStarted && (static_cast<int16_t>(mWindowNewestSeq - mWindowNextSeq) >= 0) ) {
+        const WindowSlot& slot = mWindowSlots[mWindowNextSeq % gReorderWindow];
+        bool ready = slot.valid && (slot.seqNum == mWindowNextSeq);
+        if (!ready) {
+            if ( (mFec != NULL) &&
+                 (static_cast<int16_t>(mWindowNewestSeq - mWindowNextSeq) <= mFec->getGroupSize()) ) {
+                break;
+            }
+            if ( mNack && (slot.seqNum == mWindowNextSeq) && (slot.requestUsec != 0) &&
+                 ((now_usec - slot.requestUsec) < mNackDeadlineUsec) ) {
+                break;
+            }
+        }
+        playNextWindowPacket();
+    }
+}
+
+//*******************************************************************************
+void UdpDataProtocol::playNextWindowPacket()
+{
+    WindowSlot& slot = mWindowSlots[mWindowNextSeq % gReorderWindow];
+    ++mTotCount;
+    if ( slot.valid && (slot.seqNum == mWindowNextSeq) ) {
+        // The data stays in the window, to rebuild the rest of its group
+        std::memcpy(mFullPacket, mWindowData.data() + ((mWindowNextSeq % gReorderWindow) * mFullPacketSize),
+                    mFullPacketSize);
+        mJackTrip->parseAudioPacket(mFullPacket, mAudioPacket);
+        mJackTrip->writeAudioBuffer(mAudioPacket);
+    } else {
+        // The audio interface handles it like any lost packet
+        ++mLostCount;
+    }
+    ++mWindowNextSeq;
+}
+
+//*******************************************************************************
+void UdpDataProtocol::sendNack(uint16_t last_newest_seq)
+{
+    NackStruct nack;
+    nack.Magic = gControlPacketMagic;
+    nack.Type = NACK;
+    nack.Count = 0;
+    int64_t now_usec = mReceiveTimer.nsecsElapsed() / 1000;
+    uint16_t seq_num = last_newest_seq + 1;
+    if ( static_cast<int16_t>(mWindowNextSeq - seq_num) > 0 ) {
+        // Given up for lost already
+        seq_num = mWindowNextSeq;
+    }
+    for (; static_cast<int16_t>(mWindowNewestSeq - seq_num) > 0; ++seq_num) {
+        WindowSlot& slot = mWindowSlots[seq_num % gReorderWindow];
+        if ( slot.valid && (slot.seqNum == seq_num) ) { continue; }
+        slot.valid = false;
+        slot.seqNum = seq_num;
+        slot.requestUsec = now_usec;
+        if (nack.Count < gMaxNackSeqNumbers) {
+            nack.SeqNumbers[nack.Count++] = seq_num;
+        }
+    }
+    if (nack.Count == 0) { return; }
+
+    sendDatagram(reinterpret_cast<const char*>(&nack),
+                 offsetof(NackStruct, SeqNumbers) + nack.Count * sizeof(uint16_t));
+}
+
+//*******************************************************************************
+void UdpDataProtocol::requestRetransmission(const uint16_t* seq_nums, int count)
+{
+    QMutexLocker locker(&mNackMutex);
+    // The sender thread serves them after the next packet
+    for (int i = 0; (i < count) && (mNackRequests.size() < gNackHistory); ++i) {
+        mNackRequests.append(seq_nums[i]);
+    }
+    mNackPending = true;
+}
+
+//*******************************************************************************
+void UdpDataProtocol::sendRetransmissions(int full_packet_size)
+{
+    uint16_t seq_num = static_cast<uint16_t>(mJackTrip->getSequenceNumber());
+    std::memcpy(mNackHistory.data() + ((seq_num % gNackHistory) * full_packet_size),
+                mFullPacket, full_packet_size);
+    mNackHistorySeq[seq_num % gNackHistory] = seq_num;
+    if (!mNackPending) { return; }
+
+    QVector<uint16_t> requests;
+    {
+        QMutexLocker locker(&mNackMutex);
+        requests = mNackRequests;
+        mNackRequests.clear();
+        mNackPending = false;
+    }
+    // Packets that aren't in the history anymore are too late anyway
+    for (int i = 0; i < requests.size(); ++i) {
+        int index = requests[i] % gNackHistory;
+        if (mNackHistorySeq[index] != requests[i]) { continue; }
+        const int8_t* packet = mNackHistory.data() + (index * full_packet_size);
+        if (mFragmentCount > 1) {
+            sendFragments(packet, full_packet_size, 1);
+        } else {
+            sendPacket( reinterpret_cast<const char*>(packet), full_packet_size );
+        }
+    }
+}
+
+//*******************************************************************************
+void UdpDataProtocol::echoPeerTimeStamp(uint32_t time_stamp)
+{
+    QMutexLocker locker(&mEchoMutex);
+    mEchoTimeStamp = time_stamp;
+    mEchoArrivalUsec = PacketHeader::steadyUsecTime();
+}
+
+//*******************************************************************************
+int64_t UdpDataProtocol::getSendTime(uint32_t time_stamp, int64_t* capture_usec)
+{
+    QMutexLocker locker(&mEchoMutex);
+    for (int i = 0; i < mSendTimes.size(); ++i) {
+        if ( (mSendTimes[i].usec >= 0) && (mSendTimes[i].timeStamp == time_stamp) ) {
+            *capture_usec = mSendTimes[i].captureUsec;
+            return mSendTimes[i].usec;
+        }
+    }
+    return -1;
+}
+
+//*******************************************************************************
+void UdpDataProtocol::putEchoInHeader()
+{
+    QMutexLocker locker(&mEchoMutex);
+    uint32_t delay_usec = gNoEcho;
+    if (mEchoArrivalUsec >= 0) {
+        int64_t held_usec = PacketHeader::steadyUsecTime() - mEchoArrivalUsec;
+        delay_usec = static_cast<uint32_t>( std::min<int64_t>(std::max<int64_t>(held_usec, 0),
+                                                              gNoEcho - 1) );
+    }
+    mJackTrip->setHeaderEcho(mEchoTimeStamp, delay_usec);
+}
+
+//*******************************************************************************
+void UdpDataProtocol::recordSendTime()
+{
+    // Our own header, read like the peer reads it
+    SendTime send_time;
+    send_time.timeStamp = static_cast<uint32_t>(mJackTrip->getPeerTimeStamp(mFullPacket));
+    send_time.usec = PacketHeader::steadyUsecTime();
+    send_time.captureUsec = mJackTrip->getSendCaptureTime();
+    QMutexLocker locker(&mEchoMutex);
+    mSendTimes[static_cast<uint16_t>(mJackTrip->getSequenceNumber()) % gEchoHistory] = send_time;
+}
+
+//*******************************************************************************
+void UdpDataProtocol::measureRoundTrip(int8_t* full_packet)
+{
+    DataProtocol* sender = mJackTrip->getDataProtocolSender();
+    sender->echoPeerTimeStamp(static_cast<uint32_t>(mJackTrip->getPeerTimeStamp(full_packet)));
+
+    uint32_t echo_time_stamp, delay_usec;
+    if ( !mJackTrip->getPeerEcho(full_packet, echo_time_stamp, delay_usec) ) { return; }
+    int64_t capture_usec;
+    int64_t send_usec = sender->getSendTime(echo_time_stamp, &capture_usec);
+    if (send_usec < 0) { return; }
+    // The time the peer held our time stamp isn't part of the round trip
+    int64_t rtt_usec = PacketHeader::steadyUsecTime() - send_usec - delay_usec;
+    if ( (rtt_usec < 0) || (rtt_usec > 10000000) ) { return; } // Stale echo
+    // Our audio waited in the send queue, then travelled half the round trip
+    mLatencySumUsec += std::max<int64_t>(send_usec - capture_usec, 0) + rtt_usec / 2;
+
+    if ( (mRttCount == 0) || (rtt_usec < mRttMinUsec) ) { mRttMinUsec = rtt_usec; }
+    if (rtt_usec > mRttMaxUsec) { mRttMaxUsec = rtt_usec; }
+    mRttSumUsec += rtt_usec;
+    ++mRttCount;
+
+    // Smoothed like the TCP retransmission timer (RFC 6298)
+    if (mSmoothedRttUsec == 0) {
+        mSmoothedRttUsec = rtt_usec;
+        mRttVariationUsec = rtt_usec / 2.0;
+    } else {
+        mRttVariationUsec = 0.75 * mRttVariationUsec + 0.25 * std::abs(mSmoothedRttUsec - rtt_usec);
+        mSmoothedRttUsec = 0.875 * mSmoothedRttUsec + 0.125 * rtt_usec;
+    }
+    if (!mNack) { return; }
+
+    // A packet asked for again arrives a round trip after the NACK: wait that
+    // long, with room for the jitter, but no longer than the audio queue allows
+    int64_t period_usec = static_cast<int64_t>(mJackTrip->getBufferSizeInSamples()) * 1000000
+            / mJackTrip->getSampleRate();
+    int64_t wait_usec = static_cast<int64_t>(mSmoothedRttUsec + 4 * mRttVariationUsec) + period_usec;
+    mNackDeadlineUsec = std::min(wait_usec, mNackQueueUsec);
+    if ( !mRttWarning && (wait_usec > mNackQueueUsec) ) {
+        mRttWarning = true;
+        cout << "NACK: the round trip (" << mSmoothedRttUsec / 1000.0
+             << " ms) is too long for the queue, lost packets come back too late (use -q "
+             << 2 * ((wait_usec + period_usec - 1) / period_usec) << " or more)" << endl;
+    }
+}
+
+//*******************************************************************************
+void UdpDataProtocol::measureOneWayDelay(int8_t* full_packet)
+{
+    // The clocks aren't synchronized, but the changes of the delay are real
+    int64_t send_usec = mJackTrip->getPeerSendUsec(full_packet);
+    if (send_usec < 0) { return; }
+    int64_t delay_usec = PacketHeader::steadyUsecTime() - send_usec;
+    if ( !mReportDelayValid || (delay_usec < mReportMinDelayUsec) ) {
+        mReportMinDelayUsec = delay_usec;
+        mReportDelayValid = true;
+    }
+}
+
+//*******************************************************************************
+void UdpDataProtocol::migratePeer(const QHostAddress& address, uint16_t port)
+{
+    QMutexLocker locker(&mMigrationMutex);
+    mMigratedPeerAddress = address;
+    mMigratedPeerPort = port;
+    mPeerMigrated = true;
+}
+
+//*******************************************************************************
+bool UdpDataProtocol::updatePathStats(uint16_t seq_num)
+{
+    int64_t now_usec = mReceiveTimer.nsecsElapsed() / 1000;
+    QMutexLocker locker(&mPathMutex);
+
+    // Find the path from the packet source
+    PathState* path = NULL;
+    for (int i = 0; i < mPaths.size(); ++i) {
+        if ( (mPaths[i].port == mSenderPort) && (mPaths[i].address == mSenderAddress) ) {
+            path = &mPaths[i];
+            break;
+        }
+    }
+    if ( (path == NULL) && (mPaths.size() < gMaxMultipaths) ) {
+        PathState new_path = { mSenderAddress, mSenderPort, seq_num, 0, 0, 0, 0, 0, 0 };
+        mPaths.append(new_path);
+        path = &mPaths[mPaths.size()-1];
+        cout << "Multipath: receiving from " << mSenderAddress.toString().toStdString()
+             << ":" << mSenderPort << endl;
+    }
+
+    SeenPacket& seen = mSeenPackets[seq_num % gMultipathHistory];
+    bool duplicate = seen.valid && (seen.seqNum == seq_num);
+
+    if (path != NULL) {
+        if (0 != path->received) {
+            int16_t gap = seq_num - path->lastSeqNum;
+            if (gap > 1) { path->lost += gap - 1; }
+            if (gap > 0) { path->lastSeqNum = seq_num; }
+        }
+        ++path->received;
+        if (duplicate) {
+            int64_t lag_usec = now_usec - seen.arrivalUsec;
+            path->lagSumUsec += lag_usec;
+            if (lag_usec > path->lagMaxUsec) { path->lagMaxUsec = lag_usec; }
+            ++path->lagCount;
+        } else {
+            ++path->firstArrivals;
+        }
+    }
+
+    if (!duplicate) {
+        seen.valid = true;
+        seen.seqNum = seq_num;
+        seen.arrivalUsec = now_usec;
+    }
+    return duplicate;
+}
+
+//*******************************************************************************
+bool UdpDataProtocol::getSendStats(SendStat* stat)
+{
+    if ( !(mDtx || mAdaptiveBitrate) ) { return false; }
+    stat->audioBytes = mDtxAudioBytes.exchange(0);
+    stat->sentBytes = mDtxSentBytes.exchange(0);
+    stat->wireBits = static_cast<uint8_t>(8 * mWireBytesPerSample);
+    stat->bitrateSwitches = mBitrateSwitches.exchange(0);
+    return true;
+}
+
+//*******************************************************************************
+bool UdpDataProtocol::getPathStats(QVector<PathStat>* stats)
+{
+    if (!mMultipath) { return false; }
+    QMutexLocker locker(&mPathMutex);
+    stats->clear();
+    for (int i = 0; i < mPaths.size(); ++i) {
+        PathState& path = mPaths[i];
+        PathStat stat;
+        stat.address = path.address.toString() + ":" + QString::number(path.port);
+        stat.received = path.received;
+        stat.firstArrivals = path.firstArrivals;
+        stat.lost = path.lost;
+        stat.lagAvgMsec = path.lagCount ? (path.lagSumUsec / 1000.0) / path.lagCount : 0.0;
+        stat.lagMaxMsec = path.lagMaxUsec / 1000.0;
+        // The lag is reported per stat interval
+        path.lagSumUsec = 0;
+        path.lagMaxUsec = 0;
+        path.lagCount = 0;
+        stats->append(stat);
+    }
     return true;
 }
 
@@ -721,7 +2714,11 @@ void UdpDataProtocol::sendPacketRedundancy(int8_t* full_redundant_packet,
                                            int full_packet_size)
 {
     mJackTrip->readAudioBuffer( mAudioPacket );
+    if (mJackTrip->hasHeaderEcho()) { putEchoInHeader(); }
     mJackTrip->putHeaderInPacket(mFullPacket, mAudioPacket);
+    if (mJackTrip->hasHeaderEcho()) { recordSendTime(); }
+    // The copies, the parity and the retransmissions carry what the peer rebuilds
+    if (mFullBytesPerSample > 0) { reducePacket(); }
 
     // Move older packets to end of array of redundant packets
     std::memmove(full_redundant_packet+full_packet_size,
@@ -737,9 +2734,26 @@ void UdpDataProtocol::sendPacketRedundancy(int8_t* full_redundant_packet,
     //int random_integer = rand();
     //if ( random_integer > (RAND_MAX/10) )
     //{
-    sendPacket( reinterpret_cast<char*>(full_redundant_packet),
-                full_redundant_packet_size);
+    // With adaptive redundancy, only the newest copies the peer needs are sent
+    int copies = mAdaptiveRedundancy ? static_cast<int>(mRedundancyLevel)
+                                     : static_cast<int>(mUdpRedundancyFactor);
+    if (mFragmentCount > 1) {
+        sendFragments(full_redundant_packet, full_packet_size, copies);
+    } else if (mCodedType == COMPRESSED) {
+        sendCompressedPacket(full_packet_size, copies);
+    } else if (mCodedType == DTX) {
+        sendDtxPacket(full_packet_size, copies);
+    } else if (mCodedType == REDUCED) {
+        sendReducedPacket(full_redundant_packet, full_packet_size, copies);
+    } else {
+        sendPacket( reinterpret_cast<char*>(full_redundant_packet),
+                    full_packet_size * copies);
+    }
     //}
+    if (mFec != NULL) {
+        sendFecParity(full_packet_size);
+    }
+    sendRetransmissions(full_packet_size);
     //---------------------------------------------------------------------------------
 
     mJackTrip->increaseSequenceNumber();
@@ -44,11 +44,18 @@
 #include <QUdpSocket>
 #include <QHostAddress>
 #include <QMutex>
+#include <QStringList>
+#include <QElapsedTimer>
 
 #include "DataProtocol.h"
+#include "ForwardErrorCorrection.h"
+#include "LosslessCodec.h"
+#include "PacketCipher.h"
 #include "jacktrip_types.h"
 #include "jacktrip_globals.h"
 
+struct CompressedHeaderStruct;
+
 /** \brief UDP implementation of DataProtocol class
  *
  * The class has a <tt>bind port</tt> and a <tt>peer port</tt>. The meaning of these
@@ -62,6 +69,74 @@
  * the resusable property in the socket for address and port. You have to
  * externaly check if the port is already binded if you want to avoid re-binding to the
  * same port.
+ *
+ * In multipath mode the SENDER duplicates every datagram over one extra socket per
+ * local address (or interface) given with setMultipath(), and the RECEIVER accepts
+ * packets from any source, keeps the first copy of each sequence number and
+ * keeps loss and lag statistics for each path.
+ *
+ * If the peer address is a multicast group, the SENDER sends each packet once to the
+ * group and the RECEIVER joins the group.
+ *
+ * With encryption the socket is never connected, so the peer can move to a new address
+ * (NAT rebinding, change of network) in the middle of a session. The RECEIVER drops
+ * packets from unknown addresses unless they are authentic packets of the session that
+ * are newer than the last one received; in that case the session moves to the new
+ * address, and the SENDER is re-targeted without touching the ring buffers or the audio
+ * interface. Without encryption packets can't be authenticated, so the session stays
+ * with the first peer.
+ *
+ * The RECEIVER also sends small heartbeat packets to the peer, and a goodbye packet
+ * when JackTrip stops, if heartbeats are enabled or the peer sends them too. A peer
+ * that sends heartbeats is considered gone after gHeartbeatTimeoutMsec without packets.
+ *
+ * With setMtu(), the SENDER splits packets that don't fit in the path MTU into fragments
+ * (control packets of type FRAGMENT). The RECEIVER reassembles them and, if some
+ * fragments are lost, conceals only the samples they carried with the ones of the
+ * previous packet.
+ *
+ * With setFec(), the SENDER follows every group of packets with parity packets
+ * (control packets of type FEC_PARITY). The RECEIVER switches to FEC when the first
+ * parity packet arrives: packets are then played in order from a window, and a
+ * missing packet is waited for until the rest of its group and the parity packets
+ * can rebuild it, for at most one group.
+ *
+ * With setNack(), the RECEIVER also plays packets in order from the window, and asks
+ * the peer once for every packet missing (control packets of type NACK). The SENDER
+ * keeps its last gNackHistory packets and sends them again when asked. A missing
+ * packet is waited for until half of the queue of the audio buffer is played, so it's
+ * only useful with deep queues (-q 8 and up).
+ *
+ * With setLossless(), the SENDER codes the audio of each packet with LosslessCodec and
+ * sends the datagrams as control packets of type COMPRESSED, see CompressedHeaderStruct.
+ * The RECEIVER turns them back into raw datagrams as soon as they arrive, so redundancy,
+ * FEC and NACK work on raw packets (parity and retransmitted packets are sent raw).
+ *
+ * With setDtx(), the SENDER leaves out of each packet the channels whose peak stays
+ * under a gate, and sends the datagrams as control packets of type DTX. A channel is
+ * still sent for gDtxHoldMsec after it falls under the gate, so note tails aren't cut.
+ * The RECEIVER fills the missing channels with comfort noise at the level the SENDER
+ * measured, so packets of muted clients are only the header and a few bytes.
+ *
+ * With setEncryptionKeys(), every datagram is encrypted and authenticated with
+ * PacketCipher (see CipherHeaderStruct), and the RECEIVER drops the ones that aren't
+ * authentic or that it got already. In multipath mode each path gets a copy sealed
+ * on its own, so the copies aren't replays and the path statistics still count them.
+ *
+ * Each datagram can carry any number of copies (the RECEIVER reads it from the
+ * datagram size). With setAdaptiveRedundancy(), the RECEIVER reports the loss it
+ * measures to the peer every gLossReportIntervalMsec, and the SENDER sends as many
+ * copies as the reported loss bursts need, up to the redundancy factor.
+ *
+ * With setAdaptiveBitrate(), the reports also carry the trend of the one-way
+ * delay, and the SENDER lowers the bit resolution of the audio it sends when the
+ * path is congested (the delay rises or packets are lost), one byte per sample
+ * at a time, and raises it back once the path is clear.
+ *
+ * These three modes (one at a time) keep the copies of the last packets already
+ * coded, in one history, and send them in datagrams that start with a
+ * CompressedHeaderStruct. The RECEIVER checks that header against the session
+ * before expanding anything, see checkCodedHeader().
  */
 class UdpDataProtocol : public DataProtocol
 {
@@ -95,6 +170,67 @@ public:
     void setSocket(int &socket);
 #endif
 
+    /** \brief Enables multipath mode
+   * \param multipath Accept duplicated packets from several peer paths
+   * \param local_paths Local IP addresses (or interface names on Linux) used
+   * by the SENDER to send an extra copy of each packet. Can be empty.
+   */
+    void setMultipath(bool multipath, const QStringList& local_paths = QStringList())
+    { mMultipath = multipath; mMultipathLocalPaths = local_paths; }
+
+    /** \brief Enables the heartbeat and goodbye packets. Without it they're only sent
+   * to peers that send them too (older peers don't understand them).
+   */
+    void setHeartbeat(bool heartbeat)
+    { mHeartbeat = heartbeat; }
+
+    /** \brief Sets the path MTU. Packets (with their redundancy) that don't fit are split
+   * in fragments that do. 0 sends them whole.
+   */
+    void setMtu(int mtu)
+    { mMtu = mtu; }
+
+    /** \brief Sends parity packets for every group of packets, so lost packets can
+   * be rebuilt (see ForwardErrorCorrection). A group_size of 0 disables it.
+   */
+    void setFec(int group_size, int parity_count)
+    { mFecGroupSize = group_size; mFecParityCount = parity_count; }
+
+    /** \brief Adapts the copies in each datagram to the loss reported by the peer,
+   * with the redundancy factor as the maximum. Without it, loss reports are only
+   * sent to peers that send them too.
+   */
+    void setAdaptiveRedundancy(bool adaptive)
+    { mAdaptiveRedundancy = adaptive; }
+
+    /** \brief Asks the peer to send again the packets that are lost, if they can still
+   * arrive in time to be played. Any SENDER answers these requests.
+   */
+    void setNack(bool nack)
+    { mNack = nack; }
+
+    /** \brief Codes the audio of the packets losslessly, at the SENDER. Packets split
+   * for the MTU and 32 bit audio are sent raw. Any RECEIVER decodes them.
+   */
+    void setLossless(bool lossless)
+    { mLossless = lossless; }
+
+    /** \brief Leaves out of the packets the channels under a gate, at the SENDER.
+   * Packets split for the MTU are sent whole. Any RECEIVER fills the channels in.
+   * \param dtx Suppress the silent channels
+   * \param gate_db Peak level of the gate, in dBFS
+   */
+    void setDtx(bool dtx, double gate_db)
+    { mDtx = dtx; mDtxGateDb = gate_db; }
+
+    /** \brief Lowers the bit resolution of the audio sent while the peer reports
+   * congestion, at the SENDER. Packets split for the MTU are sent at the session
+   * resolution. Any RECEIVER expands them back.
+   * \param min_bits Lowest bit resolution sent, 0 to disable it
+   */
+    void setAdaptiveBitrate(int min_bits)
+    { mAdaptiveBitrate = (min_bits > 0); mMinBytesPerSample = min_bits / 8; }
+
     /** \brief Receives a packet. It blocks until a packet is received
    *
    * This function makes sure we recieve a complete packet
@@ -114,7 +250,7 @@ public:
    * \param n size of packet to receive
    * \return number of bytes read, -1 on error
    */
-    virtual int sendPacket(const char* buf, const size_t n);
+    virtual int sendPacket(const char* buf, size_t n);
 
     /** \brief Obtains the peer address from the first UDP packet received. This address
    * is used by the SERVER mode to connect back to the client.
@@ -142,7 +278,28 @@ public:
    */
     virtual void run();
 
+    /** \brief Moves the SENDER to a new peer address and port. The change is applied
+   * by the sender thread before the next packet, so this can be called from any thread.
+   */
+    virtual void migratePeer(const QHostAddress& address, uint16_t port);
+
+    virtual void sendGoodbye();
+    virtual void reportPeerLoss(uint16_t received, uint16_t lost, uint16_t max_burst,
+                                int32_t delay_change_usec);
+    virtual void requestRetransmission(const uint16_t* seq_nums, int count);
+    virtual void echoPeerTimeStamp(uint32_t time_stamp);
+    virtual int64_t getSendTime(uint32_t time_stamp, int64_t* capture_usec);
+    virtual void setEncryptionKeys(const uint8_t* send_key, const uint8_t* receive_key);
+
+    /** \brief Checks and decrypts an encrypted datagram in place, without replay checks
+   * \param cipher Cipher with the key of the peer
+   * \return Size of the datagram, -1 if it isn't authentic
+   */
+    static int openPacket(const PacketCipher& cipher, char* buf, int n);
+
     virtual bool getStats(PktStat* stat);
+    virtual bool getPathStats(QVector<PathStat>* stats);
+    virtual bool getSendStats(SendStat* stat);
 
 private slots:
     void printUdpWaitedTooLong(int wait_msec);
@@ -166,6 +323,238 @@ protected:
     int bindSocket();
 #endif
 
+    /** \brief Binds an extra sending socket for multipath mode
+   * \param local_path Local IP address or interface name
+   */
+#if defined (__WIN_32__)
+    SOCKET bindPathSocket(const QString& local_path);
+#else
+    int bindPathSocket(const QString& local_path);
+#endif
+
+    /** \brief Updates the statistics of the path the last packet came from
+   * \param seq_num Sequence number of the packet
+   * \return true if the packet is a copy already received on another path
+   */
+    bool updatePathStats(uint16_t seq_num);
+
+    /** \brief Checks the source of the last packet received, and moves the session
+   * to that source if the peer changed address
+   * \param full_redundant_packet Packet received
+   * \param last_seq_num Sequence number of the last packet received
+   * \return true if the packet should be used
+   */
+    bool checkPacketSource(int8_t* full_redundant_packet,
+                           uint16_t last_seq_num);
+
+    /** \brief Sends a control packet to the peer
+   * \param type DataProtocol::controlPacketTypeT
+   */
+    void sendControlPacket(uint8_t type);
+
+    /** \brief Handles a packet that doesn't have the size of an audio packet
+   * \param packet Packet received
+   * \param size Size of the packet
+   */
+    void processControlPacket(const int8_t* packet, int size);
+
+    /// \brief Sends a heartbeat if the last one is older than gHeartbeatIntervalMsec
+    void sendHeartbeatIfDue();
+
+    /// \brief Sends the loss measured since the last report, every gLossReportIntervalMsec
+    void sendLossReportIfDue();
+
+    /** \brief Encrypts a datagram if encryption is set, and sends it to the peer
+   * \return Number of bytes sent, -1 on error
+   */
+    int sendDatagram(const char* buf, size_t n);
+
+    /** \brief Encrypts a datagram, if encryption is set
+   * \param buf Datagram to send
+   * \param n Size of the datagram, returns the size to send
+   * \return Buffer to send, buf itself without encryption
+   */
+    const char* encryptPacket(const char* buf, size_t& n);
+
+    /** \brief Checks and decrypts a datagram in place
+   * \return Size of the datagram, 0 if it isn't authentic or is a replay
+   */
+    int decryptPacket(char* buf, int n);
+
+    /// \brief Returns true if the packet starts like a control packet
+    bool isControlPacket(const int8_t* packet, int size) const;
+
+    /** \brief Chooses the fragment size for the MTU, at the SENDER
+   * \param full_packet_size Size of a packet (header+audio)
+   */
+    void setupFragments(int full_packet_size);
+
+    /** \brief Gets the part of a packet (header+audio) that a fragment carries
+   * \param index Fragment index
+   * \param fragment_size Audio bytes in each fragment
+   * \param offset Returns the position of the fragment in the packet
+   * \param length Returns the size of the fragment
+   */
+    void getFragmentRange(int index, int fragment_size, int& offset, int& length) const;
+
+    /// \brief Sends the packets (copies of them) in fragments that fit the MTU
+    void sendFragments(const int8_t* full_redundant_packet, int full_packet_size, int copies);
+
+    /// \brief Stores a received fragment and plays the packets that are ready
+    void processFragment(const int8_t* packet, int size);
+
+    /// \brief Plays the next packet being reassembled, concealing its missing fragments
+    void playNextReassembled();
+
+    /// \brief Prepares the FEC group buffers, at the SENDER
+    void setupFec(int full_packet_size);
+
+    /// \brief Keeps the packet just sent for its group, and sends the parity
+    /// packets when the group is complete
+    void sendFecParity(int full_packet_size);
+
+    /// \brief Prepares the lossless coder and its copies of the last packets, at the SENDER
+    void setupLossless(int full_packet_size);
+
+    /// \brief Codes the packet just built and sends it with the coded copies of the
+    /// previous ones, in a COMPRESSED datagram
+    void sendCompressedPacket(int full_packet_size, int copies);
+
+    /** \brief Checks the header of a COMPRESSED, DTX or REDUCED datagram against
+   * the session, at the RECEIVER
+   *
+   * The header comes from the network, so nothing is allocated from it before
+   * this check: the channels and the packet header have to be ours, the frames
+   * and the bit resolution the ones of the peer (once known), and all the
+   * raw copies have to fit in the receive buffer.
+   * \param buf Datagram
+   * \param size Size of the datagram
+   * \param buf_size Size of the receive buffer
+   * \return Size of each raw packet, 0 if the header doesn't match
+   */
+    int checkCodedHeader(const int8_t* buf, int size, int buf_size) const;
+
+    /** \brief Turns a COMPRESSED, DTX or REDUCED datagram back into raw packets,
+   * at the RECEIVER
+   * \param buf Datagram, replaced by the raw packets
+   * \param size Size of the datagram
+   * \param buf_size Size of buf
+   * \return Size of the raw packets, 0 if the datagram is corrupted
+   */
+    int expandControlPayload(int8_t* buf, int size, int buf_size);
+
+    /** \brief Prepares the copies of the last packets and the header of the
+   * coded datagrams, at the SENDER
+   * \param type DataProtocol::COMPRESSED, DataProtocol::DTX or DataProtocol::REDUCED
+   * \param entry_size Largest coded copy
+   * \param empty_size Size of the copies before the first packet
+   * \param header_size Size of the packet header
+   * \param frames Frames of each packet
+   */
+    void setupCodedHistory(uint8_t type, int entry_size, int empty_size,
+                           int header_size, int frames);
+
+    /// \brief Makes room for the newest coded copy, and returns it
+    int8_t* nextCodedCopy();
+
+    /// \brief Sends the newest coded copies in a datagram, at the SENDER
+    void sendCodedPacket(int copies);
+
+    /** \brief Decodes the audio of one copy of a COMPRESSED datagram
+   * \param data Coded size and audio of the copy
+   * \param size Bytes left in the datagram
+   * \param audio Returns the raw audio
+   * \return Bytes of data used, -1 if the copy is corrupted
+   */
+    int decompressCopy(const int8_t* data, int size, int8_t* audio);
+
+    /// \brief Prepares the gates and the copies of the last packets, at the SENDER
+    void setupDtx(int full_packet_size);
+
+    /// \brief Gates the channels of the packet just built and sends it with the
+    /// copies of the previous ones, in a DTX datagram
+    void sendDtxPacket(int full_packet_size, int copies);
+
+    /** \brief Rebuilds the audio of one copy of a DTX datagram
+   * \param data Channel bitmap, levels and sent channels of the copy
+   * \param size Bytes left in the datagram
+   * \param header Header of the datagram
+   * \param audio Returns the raw audio
+   * \return Bytes of data used, -1 if the copy is truncated
+   */
+    int expandDtxCopy(const int8_t* data, int size, const CompressedHeaderStruct* header,
+                      int8_t* audio);
+
+    /// \brief Fills a channel of a packet with white noise of RMS level -level dB
+    void fillComfortNoise(int8_t* audio, int frames, int bytes_per_sample, uint8_t level);
+
+    /// \brief Prepares the resolution ladder and the copies of the last packets, at the SENDER
+    void setupAdaptiveBitrate(int full_packet_size);
+
+    /// \brief Steps the wire resolution down on congestion and back up once the
+    /// path is clear, from a loss report of the peer
+    void adaptBitrate(uint16_t received, uint16_t lost, int32_t delay_change_usec);
+
+    /// \brief Stores the packet just built at the wire resolution, and quantizes it
+    /// to what the peer will rebuild
+    void reducePacket();
+
+    /// \brief Sends the packet just built with the copies of the previous ones, in a
+    /// REDUCED datagram if any of them is reduced
+    void sendReducedPacket(const int8_t* full_redundant_packet, int full_packet_size, int copies);
+
+    /** \brief Rebuilds the audio of one copy of a REDUCED datagram
+   * \param data Wire resolution and audio of the copy
+   * \param size Bytes left in the datagram
+   * \param header Header of the datagram
+   * \param audio Returns the raw audio
+   * \return Bytes of data used, -1 if the copy is truncated
+   */
+    int expandReducedCopy(const int8_t* data, int size, const CompressedHeaderStruct* header,
+                          int8_t* audio);
+
+    /// \brief Measures the one-way delay of a packet on the peer clock, for the loss reports
+    void measureOneWayDelay(int8_t* full_packet);
+
+    /// \brief Stores a received parity packet and rebuilds what it can
+    void processFecParity(const int8_t* packet, int size);
+
+    /// \brief Prepares the window where packets wait for the lost ones, at the RECEIVER
+    void setupWindow();
+
+    /// \brief Stores a received audio packet (header+audio) in the window
+    void storeWindowPacket(const int8_t* packet);
+
+    /// \brief Rebuilds the missing packets of a group if enough parity arrived
+    void recoverFecGroup(int group_index);
+
+    /// \brief Plays the packets of the window that are ready, in order
+    void playWindowPackets();
+
+    /// \brief Plays the next packet of the window, or counts it as lost
+    void playNextWindowPacket();
+
+    /** \brief Asks the peer for the packets missing in the window, at the RECEIVER
+   * \param last_newest_seq Newest sequence number before the last datagram. Only
+   * the packets after it are asked for, so each one is asked for once.
+   */
+    void sendNack(uint16_t last_newest_seq);
+
+    /// \brief Keeps the packet just sent, and sends again the ones the peer asked for
+    void sendRetransmissions(int full_packet_size);
+
+    /// \brief Echoes the newest peer time stamp in the header of the next packet, at the SENDER
+    void putEchoInHeader();
+
+    /// \brief Keeps when the packet just built is sent, to measure the round trip time
+    void recordSendTime();
+
+    /** \brief Echoes the time stamp of a peer packet, and measures the round trip time
+   * of the packet the peer echoes, at the RECEIVER. With NACK, the round trip time
+   * sets how long a lost packet is waited for.
+   */
+    void measureRoundTrip(int8_t* full_packet);
+
     /** \brief This function blocks until data is available for reading in the
    * QUdpSocket. The function will timeout after timeout_msec microseconds.
    *
@@ -200,6 +589,7 @@ private:
     int mPeerPort; ///< Peer Port number
     const runModeT mRunMode; ///< Run mode, either SENDER or RECEIVER
     bool mIPv6; /// Use IPv6
+    bool mMulticast; ///< Peer address is a multicast group
 
     QHostAddress mPeerAddress; ///< The Peer Address
     struct sockaddr_in mPeerAddr;
@@ -216,6 +606,193 @@ private:
     unsigned int mUdpRedundancyFactor; ///< Factor of redundancy
     static QMutex sUdpMutex; ///< Mutex to make thread safe the binding process
 
+    bool mMultipath; ///< Multipath mode
+    QStringList mMultipathLocalPaths; ///< Local addresses of the extra paths
+#if defined (__WIN_32__)
+    QVector<SOCKET> mPathSockets; ///< Extra sending sockets, one per path
+#else
+    QVector<int> mPathSockets; ///< Extra sending sockets, one per path
+#endif
+    QHostAddress mSenderAddress; ///< Source address of the last packet received
+    uint16_t mSenderPort; ///< Source port of the last packet received
+    int mDatagramSize; ///< Size of the last datagram received
+    QElapsedTimer mReceiveTimer; ///< Clock for the arrival times of packets
+    int64_t mLastPacketUsec; ///< Arrival time of the last packet from the peer
+
+    QHostAddress mMigratedPeerAddress; ///< New peer address, set by migratePeer()
+    uint16_t mMigratedPeerPort; ///< New peer port, set by migratePeer()
+    std::atomic<bool> mPeerMigrated; ///< The SENDER has to apply a new peer address
+    QMutex mMigrationMutex; ///< Protects the new peer address
+    std::atomic<uint32_t> mMigrationCount;
+    std::atomic<uint32_t> mMigrationGapMsec;
+
+    bool mHeartbeat; ///< Send heartbeat and goodbye packets
+    std::atomic<bool> mPeerHeartbeat; ///< The peer sends heartbeats
+    int64_t mLastHeartbeatUsec; ///< Time of the last heartbeat sent
+
+    int mMtu; ///< Path MTU, 0 to send packets whole
+    int mFullPacketSize; ///< Size of a packet (header+audio)
+    bool mReceiveFormatSet; ///< The peer frames and bit resolution are known (RECEIVER)
+    int mReceiveBufferSize; ///< Size of the RECEIVER buffer
+    int mFragmentCount; ///< Fragments per packet at the SENDER, 1 if packets aren't split
+    int mFragmentSize; ///< Audio bytes per fragment at the SENDER
+    int8_t* mFragmentPacket; ///< Buffer to build the fragment packets
+
+    /// \brief Reassembly state of a packet
+    struct Reassembly {
+        bool valid;
+        uint16_t seqNum;
+        uint64_t received; ///< Bit mask of the fragments received
+        int fragmentCount;
+        int fragmentSize;
+    };
+    QVector<Reassembly> mReassembly; ///< Packets being reassembled, indexed by sequence number
+    QVector<int8_t> mReassemblyBuffer; ///< Data of the packets being reassembled
+    QVector<int8_t> mLastReassembled; ///< Last packet played, to conceal missing fragments
+    bool mFragmentStarted; ///< A fragment was received
+    uint16_t mNextFragmentSeq; ///< Sequence number of the next packet to play
+    uint16_t mNewestFragmentSeq; ///< Newest sequence number received in a fragment
+    int mFragmentCopies; ///< Copies (redundancy) of the last fragment received
+    std::atomic<uint32_t> mConcealedCount;
+
+    int mFecGroupSize; ///< Packets per FEC group at the SENDER, 0 without FEC
+    int mFecParityCount; ///< Parity packets per FEC group at the SENDER
+    ForwardErrorCorrection* mFec; ///< FEC code (of the peer, at the RECEIVER)
+    QVector<int8_t> mFecGroupBuffer; ///< Packets of the current group (SENDER)
+    QVector<int8_t> mFecPacket; ///< Buffer to build the parity packets (SENDER)
+    int mFecGroupFill; ///< Packets in the current group (SENDER)
+    uint16_t mFecFirstSeq; ///< Sequence number of the first packet of the group (SENDER)
+
+    /// \brief Parity received for a group of packets
+    struct FecGroup {
+        bool valid;
+        bool done; ///< No packet of the group is missing
+        uint16_t firstSeqNum;
+        uint32_t parityReceived; ///< Bit mask of the parity packets received
+    };
+    /// \brief A packet of the window
+    struct WindowSlot {
+        bool valid;
+        uint16_t seqNum;
+        int64_t requestUsec; ///< Time it was asked for, if it's missing (NACK)
+    };
+    bool mWindowActive; ///< Packets are played from the window (RECEIVER)
+    bool mWindowStarted; ///< A packet was stored in the window
+    QVector<FecGroup> mFecGroups; ///< Groups with parity packets
+    QVector<int8_t> mFecGroupParity; ///< Parity packets of each group
+    int mFecNextGroup; ///< Group entry to reuse next
+    QVector<WindowSlot> mWindowSlots; ///< Packets of the window, indexed by sequence number
+    QVector<int8_t> mWindowData; ///< Data of the packets of the window
+    QVector<int8_t> mFecScratch; ///< A group being decoded
+    uint16_t mWindowNextSeq; ///< Sequence number of the next packet to play
+    uint16_t mWindowNewestSeq; ///< Newest sequence number stored
+    std::atomic<uint32_t> mFecRecoveredCount;
+
+    bool mAdaptiveRedundancy; ///< Adapt the copies per datagram to the peer loss
+    std::atomic<unsigned int> mRedundancyLevel; ///< Copies in each datagram (SENDER)
+    int mLowerLossReports; ///< Reports in a row that need fewer copies (SENDER)
+    std::atomic<bool> mPeerLossReports; ///< The peer sends loss reports (RECEIVER)
+    int64_t mLastLossReportUsec; ///< Time of the last loss report sent (RECEIVER)
+    uint32_t mReportReceived; ///< Datagrams received since the last report (RECEIVER)
+    uint32_t mReportLost; ///< Datagrams lost since the last report (RECEIVER)
+    uint32_t mReportMaxBurst; ///< Longest loss since the last report (RECEIVER)
+    int64_t mReportMinDelayUsec; ///< Shortest one-way delay since the last report (RECEIVER)
+    bool mReportDelayValid; ///< mReportMinDelayUsec was measured (RECEIVER)
+    int64_t mLastMinDelayUsec; ///< Shortest one-way delay of the previous report, or -1 (RECEIVER)
+
+    bool mLongSeqStarted; ///< A 32-bit sequence number was received (RECEIVER)
+    uint32_t mLastLongSeqNum; ///< Newest 32-bit sequence number received (RECEIVER)
+
+    bool mNack; ///< Ask the peer for lost packets (RECEIVER)
+    int64_t mNackDeadlineUsec; ///< Time a missing packet is waited for (RECEIVER)
+    std::atomic<uint32_t> mRetransmittedCount; ///< Missing packets that arrived in time (RECEIVER)
+    QVector<int8_t> mNackHistory; ///< Last packets sent (SENDER)
+    QVector<int32_t> mNackHistorySeq; ///< Sequence number of each packet of the history, or -1
+    QVector<uint16_t> mNackRequests; ///< Packets the peer asked for (SENDER)
+    std::atomic<bool> mNackPending; ///< There are requests to serve (SENDER)
+    QMutex mNackMutex; ///< Protects mNackRequests
+    int64_t mNackQueueUsec; ///< Longest wait for a lost packet the audio queue allows (RECEIVER)
+
+    bool mLossless; ///< Code the audio losslessly (SENDER)
+    LosslessCodec* mLosslessEncoder; ///< Lossless coder, NULL to send raw packets (SENDER)
+    LosslessCodec* mLosslessDecoder; ///< Lossless decoder of the peer format (RECEIVER)
+
+    bool mDtx; ///< Leave the silent channels out of the packets (SENDER)
+    double mDtxGateDb; ///< Peak level under which a channel is silent, in dBFS (SENDER)
+    sample_t mDtxGate; ///< mDtxGateDb as a sample value (SENDER)
+    int mDtxHoldPackets; ///< Packets a channel is sent after it falls under the gate (SENDER)
+    QVector<int> mDtxHold; ///< Packets each channel is still sent (SENDER)
+    QVector<uint8_t> mDtxLevels; ///< Comfort noise level of each channel, 0 if it's sent (SENDER)
+    std::atomic<uint64_t> mDtxAudioBytes; ///< Bytes of the packets before suppression (SENDER)
+    std::atomic<uint64_t> mDtxSentBytes; ///< Bytes of the packets sent (SENDER)
+    uint32_t mDtxNoiseState; ///< State of the comfort noise generator (RECEIVER)
+    QVector<sample_t> mDtxSamples; ///< One channel of a period as samples (SENDER and RECEIVER)
+
+    bool mAdaptiveBitrate; ///< Adapt the bit resolution to the congestion of the path (SENDER)
+    int mMinBytesPerSample; ///< Lowest resolution sent (SENDER)
+    int mFullBytesPerSample; ///< Resolution of the session, 0 without adaptive bitrate (SENDER)
+    std::atomic<int> mWireBytesPerSample; ///< Resolution sent now, 0 without adaptive bitrate (SENDER)
+    int mCleanReports; ///< Loss reports in a row without congestion (SENDER)
+    int mBitrateHoldReports; ///< Loss reports ignored after a step down, while the queues drain (SENDER)
+    std::atomic<uint32_t> mBitrateSwitches; ///< Changes of wire resolution (SENDER)
+
+    uint8_t mCodedType; ///< Type of the datagrams sent, 0 to send raw packets (SENDER)
+    QVector<int8_t> mCodedHistory; ///< Copies of the last packets, header and coded audio (SENDER)
+    QVector<int> mCodedSizes; ///< Size of each copy (SENDER)
+    int mCodedEntrySize; ///< Room for each copy in mCodedHistory (SENDER)
+    int mCodedNewest; ///< Newest copy (SENDER)
+    QVector<int8_t> mCodedPacket; ///< Buffer to build the coded datagrams (SENDER)
+    QVector<int8_t> mCodedScratch; ///< Raw packets of a coded datagram (RECEIVER)
+
+    /// \brief Time a packet was sent, to measure the round trip time
+    struct SendTime {
+        uint32_t timeStamp;
+        int64_t usec; ///< In PacketHeader::steadyUsecTime(), -1 for none
+        int64_t captureUsec; ///< Capture time of the audio, in PacketHeader::steadyUsecTime()
+    };
+    QVector<SendTime> mSendTimes; ///< Last packets sent, by sequence number (SENDER)
+    uint32_t mEchoTimeStamp; ///< Newest peer time stamp, to echo back (SENDER)
+    int64_t mEchoArrivalUsec; ///< Arrival of that peer packet, -1 before the first one (SENDER)
+    QMutex mEchoMutex; ///< Protects mSendTimes and the echo
+    double mSmoothedRttUsec; ///< Smoothed round trip time, 0 before the first one (RECEIVER)
+    double mRttVariationUsec; ///< Smoothed deviation of the round trip time (RECEIVER)
+    bool mRttWarning; ///< The queue was reported too short for the round trip
+    std::atomic<uint32_t> mRttCount; ///< Round trip times measured since the last stats
+    std::atomic<int64_t> mRttSumUsec;
+    std::atomic<int64_t> mRttMinUsec;
+    std::atomic<int64_t> mRttMaxUsec;
+    std::atomic<int64_t> mLatencySumUsec; ///< Capture to peer arrival, summed like mRttSumUsec
+
+    PacketCipher* mSendCipher; ///< Key of the packets to the peer, NULL without encryption
+    PacketCipher* mReceiveCipher; ///< Key of the packets from the peer
+    uint64_t mCipherCounter; ///< Counter of the next datagram sent
+    QVector<char> mCipherPacket; ///< Buffer to build the encrypted datagrams
+    uint64_t mReplayNewest[2]; ///< Newest counter received, from each peer thread
+    uint64_t mReplayMask[2]; ///< Counters received just before the newest one, one per bit
+    bool mAuthenticationFailed; ///< A datagram wasn't authentic, already reported
+
+    /// \brief Receiving state of one multipath path
+    struct PathState {
+        QHostAddress address;
+        uint16_t port;
+        uint16_t lastSeqNum;
+        uint32_t received;
+        uint32_t firstArrivals;
+        uint32_t lost;
+        int64_t lagSumUsec;
+        int64_t lagMaxUsec;
+        uint32_t lagCount;
+    };
+    /// \brief First arrival of a recent sequence number, to detect copies
+    struct SeenPacket {
+        bool valid;
+        uint16_t seqNum;
+        int64_t arrivalUsec;
+    };
+    QVector<PathState> mPaths; ///< Paths seen by the RECEIVER
+    QVector<SeenPacket> mSeenPackets; ///< Recent first arrivals, indexed by sequence number
+    QMutex mPathMutex; ///< Protects mPaths
+
     std::atomic<uint32_t>  mTotCount;
     std::atomic<uint32_t>  mLostCount;
     std::atomic<uint32_t>  mOutOfOrderCount;
@@ -47,6 +47,8 @@
 
 #include "UdpHubListener.h"
 #include "JackTripWorker.h"
+#include "PacketCipher.h"
+#include "Settings.h"
 #include "jacktrip_globals.h"
 
 using std::cout; using std::endl;
@@ -188,6 +190,17 @@ void UdpHubListener::run()
                 break;
             }
 
+            // Agree on the session keys, when encrypting
+            // ------------------------------------------
+            bool encryption = !m_settings->getEncryptionPassphrase().isEmpty();
+            uint8_t keys[2 * PacketCipher::KeySize];
+            if ( encryption && (exchangeCipherSalts(clientConnection, keys) == 0) ) {
+                clientConnection->close();
+                delete clientConnection;
+                releaseThread(id);
+                break;
+            }
+
             // Close and Delete the socket
             // ---------------------------
             clientConnection->close();
@@ -210,6 +223,9 @@ void UdpHubListener::run()
                                                 1,
                                                 m_connectDefaultAudioPorts
                                                ); /// \todo temp default to 1 channel
+                if (encryption) {
+                    mJTWorkers->at(id)->setEncryptionKeys(keys + PacketCipher::KeySize, keys);
+                }
 
 //                qDebug() << "mPeerAddress" << id <<  mActiveAddress[id].address << mActiveAddress[id].port;
             }
@@ -332,6 +348,38 @@ int UdpHubListener::sendUdpPort(QTcpSocket* clientConnection, int udp_port)
 }
 
 
+//*******************************************************************************
+int UdpHubListener::exchangeCipherSalts(QTcpSocket* clientConnection, uint8_t* keys)
+{
+    // The client half of the salt follows its port
+    uint8_t salt[2 * gCipherSaltSize];
+    while (clientConnection->bytesAvailable() < gCipherSaltSize) {
+        if (!clientConnection->waitForReadyRead()) {
+            std::cerr << "TCP Socket ERROR: the client didn't start the encryption handshake "
+                      << "(it must run with --encrypt too)" << endl;
+            return 0;
+        }
+    }
+    clientConnection->read(reinterpret_cast<char*>(salt), gCipherSaltSize);
+
+    // Send our half, then derive the keys of both directions like the client
+    PacketCipher::randomBytes(salt + gCipherSaltSize, gCipherSaltSize);
+    clientConnection->write(reinterpret_cast<const char*>(salt + gCipherSaltSize), gCipherSaltSize);
+    while ( clientConnection->bytesToWrite() > 0 ) {
+        if ( clientConnection->state() == QAbstractSocket::ConnectedState ) {
+            clientConnection->waitForBytesWritten(-1);
+        }
+        else {
+            return 0;
+        }
+    }
+    PacketCipher::deriveKeys(m_settings->getEncryptionPassphrase().toUtf8().constData(),
+                             salt, sizeof(salt), gCipherKdfIterations,
+                             keys, 2 * PacketCipher::KeySize);
+    return 1;
+}
+
+
 //*******************************************************************************
 /*
 void UdpHubListener::sendToPoolPrototype(int id)
@@ -106,6 +106,11 @@ private:
 
     int readClientUdpPort(QTcpSocket* clientConnection);
     int sendUdpPort(QTcpSocket* clientConnection, int udp_port);
+    /** \brief Exchanges the salts with the client and derives the session keys
+   * \param keys Client to server key, followed by the server to client key
+   * \return 0 on error
+   */
+    int exchangeCipherSalts(QTcpSocket* clientConnection, uint8_t* keys);
 
 
     /** \brief Send the JackTripWorker to the thread pool. This will run
@@ -25,6 +25,18 @@ DEFINES += WAIRTOHUB
 nojack {
   DEFINES += __NO_JACK__
 }
+# Configuration with the Opus codec (--opus)
+opus {
+  DEFINES += __OPUS__
+  LIBS += -lopus
+  HEADERS += OpusCodec.h
+  SOURCES += OpusCodec.cpp
+}
+# Configuration with OpenSSL, for the encryption (--encrypt)
+openssl {
+  DEFINES += __OPENSSL__
+  LIBS += -lcrypto
+}
 
 # for plugins
 INCLUDEPATH += ../faust-src-lair/stk
@@ -117,7 +129,12 @@ INSTALLS += target
 INCLUDEPATH += ../faust-src-lair
 
 # Input
-HEADERS += DataProtocol.h \
+HEADERS += AudioCodec.h \
+           AudioConverter.h \
+           BlockFloatCodec.h \
+           DataProtocol.h \
+           ForwardErrorCorrection.h \
+           HalfFloatCodec.h \
            JMess.h \
            JackTrip.h \
            jacktrip_globals.h \
@@ -126,7 +143,9 @@ HEADERS += DataProtocol.h \
            JackTripWorker.h \
            JackTripWorkerMessages.h \
            LoopBack.h \
+           LosslessCodec.h \
            NetKS.h \
+           PacketCipher.h \
            PacketHeader.h \
            ProcessPlugin.h \
            RingBuffer.h \
@@ -141,7 +160,11 @@ HEADERS += DataProtocol.h \
 !nojack {
 HEADERS += JackAudioInterface.h
 }
-SOURCES += DataProtocol.cpp \
+SOURCES += AudioConverter.cpp \
+           BlockFloatCodec.cpp \
+           DataProtocol.cpp \
+           ForwardErrorCorrection.cpp \
+           HalfFloatCodec.cpp \
            JMess.cpp \
            JackTrip.cpp \
            jacktrip_globals.cpp \
@@ -150,6 +173,8 @@ SOURCES += DataProtocol.cpp \
            JackTripThread.cpp \
            JackTripWorker.cpp \
            LoopBack.cpp \
+           LosslessCodec.cpp \
+           PacketCipher.cpp \
            PacketHeader.cpp \
            ProcessPlugin.cpp \
            RingBuffer.cpp \
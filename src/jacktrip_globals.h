@@ -92,6 +92,33 @@ const QString gDefaultLocalAddress = QString();
 const int gDefaultRedundancy = 1;
 const int gTimeOutMultiThreadedServer = 10000; // seconds
 const int gWaitCounter = 60;
+const int gMaxMultipaths = 8; ///< Maximum number of peer paths tracked in multipath mode
+const int gMultipathHistory = 256; ///< Sequence numbers remembered to drop multipath copies
+const int gMulticastTtl = 1; ///< Time to live of multicast packets (stay in the local network)
+const uint32_t gControlPacketMagic = 0x4A54434C; ///< First word of the control packets ("JTCL")
+const int gHeartbeatIntervalMsec = 100; ///< Interval between heartbeat packets
+const int gHeartbeatTimeoutMsec = 500; ///< Silence after which a peer that sends heartbeats is gone
+const int gMinMtu = 576; ///< Smallest path MTU accepted by --mtu
+const int gMaxFragments = 64; ///< Maximum number of fragments of a packet
+const int gFragmentWindow = 16; ///< Packets that can be reassembled at the same time
+const int gMaxDatagramSize = 65536; ///< Receive buffer size, enough for any UDP datagram
+const int gMaxFecGroupSize = 32; ///< Largest group of packets protected by FEC parity
+const int gMaxFecParity = 8; ///< Most FEC parity packets per group
+const int gReorderWindow = 128; ///< Packets kept by the RECEIVER to wait for lost ones (FEC and NACK)
+const int gFecGroups = 8; ///< FEC groups the RECEIVER keeps parity packets for
+const int gLossReportIntervalMsec = 250; ///< Time between loss reports sent to the peer
+const int gRedundancyDecreaseReports = 8; ///< Loss reports that allow fewer copies before dropping one
+const int gBitrateLossPercent = 2; ///< Loss in a report that makes --adaptivebitrate step down
+const int gBitrateDelayRiseUsec = 2000; ///< Rise of the one-way delay in a report that makes --adaptivebitrate step down
+const int gBitrateHoldReports = 2; ///< Loss reports ignored after --adaptivebitrate steps down, while the queues drain
+const int gBitrateIncreaseReports = 20; ///< Loss reports without congestion before --adaptivebitrate steps up
+const int gNackHistory = 64; ///< Packets kept by the SENDER to retransmit them
+const int gDtxHoldMsec = 200; ///< Time a channel is still sent after it falls under the --dtx gate
+const int gMaxNackSeqNumbers = 32; ///< Most sequence numbers requested in one NACK packet
+const int gEchoHistory = 64; ///< Send times kept by the SENDER to measure the round trip time
+const uint32_t gNoEcho = 0xFFFFFFFF; ///< Echo delay of a header sent before any peer packet arrived
+const int gCipherSaltSize = 16; ///< Random bytes each side adds to the keys in the TCP handshake
+const int gCipherKdfIterations = 10000; ///< PBKDF2 iterations to derive the keys from the passphrase
 //@}
 
 
@@ -77,6 +77,33 @@ int main(int argc, char** argv)
 
     if ( testing ) {
         std::cout << "=========TESTING=========" << std::endl;
+        if ( (argc > 2) && !strcmp(argv[2], "header") ) {
+            test_header_codec(); // jacktrip test header
+        }
+        if ( (argc > 2) && !strcmp(argv[2], "fec") ) {
+            test_fec(); // jacktrip test fec
+        }
+        if ( (argc > 2) && !strcmp(argv[2], "lossless") ) {
+            test_lossless_codec(); // jacktrip test lossless
+        }
+        if ( (argc > 2) && !strcmp(argv[2], "cipher") ) {
+            test_packet_cipher(); // jacktrip test cipher
+        }
+        if ( (argc > 2) && !strcmp(argv[2], "blockfloat") ) {
+            test_block_float_codec(); // jacktrip test blockfloat
+        }
+        if ( (argc > 2) && !strcmp(argv[2], "halffloat") ) {
+            test_half_float_codec(); // jacktrip test halffloat
+        }
+        if ( (argc > 2) && !strcmp(argv[2], "conversion") ) {
+            test_sample_conversion(); // jacktrip test conversion
+        }
+        if ( (argc > 2) && !strcmp(argv[2], "resample") ) {
+            test_audio_converter(); // jacktrip test resample
+        }
+        if ( (argc > 2) && !strcmp(argv[2], "callback") ) {
+            test_audio_callback(); // jacktrip test callback
+        }
         //main_tests(argc, argv); // test functions
         JackTrip jacktrip;
         //RtAudioInterface rtaudio(&jacktrip);
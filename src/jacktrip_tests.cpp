@@ -36,10 +36,25 @@
  */
 
 #include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 #include <QVector>
+#include <QElapsedTimer>
 
 #include "JackTripThread.h"
+#include "PacketHeader.h"
+#include "ForwardErrorCorrection.h"
+#include "LosslessCodec.h"
+#include "PacketCipher.h"
+#include "BlockFloatCodec.h"
+#include "HalfFloatCodec.h"
+#include "AudioConverter.h"
+#include "AudioInterface.h"
+#include "ProcessPlugin.h"
+#include "RingBuffer.h"
 
 using std::cout; using std::endl;
 
@@ -50,6 +65,15 @@ const int base_port = 4464;
 void main_tests(int argc, char** argv);
 void test_threads_server();
 void test_threads_client(const char* peer_address);
+void test_header_codec();
+void test_fec();
+void test_lossless_codec();
+void test_packet_cipher();
+void test_block_float_codec();
+void test_half_float_codec();
+void test_sample_conversion();
+void test_audio_converter();
+void test_audio_callback();
 
 
 void main_tests(int /*argc*/, char** argv)
@@ -101,3 +125,668 @@ void test_threads_client(const char* peer_address)
         //sleep(1);
     }
 }
+
+
+// Time the header reads of every packet: virtual calls through PacketHeader,
+// against the JackTrip methods that dispatch on the header type of the session
+void test_header_codec()
+{
+    const int num_packets = 1 << 24;
+    const int num_slots = 64;
+    const int header_size = sizeof(DefaultHeaderV2Struct);
+
+    JackTrip jacktrip;
+    jacktrip.setPacketHeaderType(DataProtocol::DEFAULT_V2);
+    DefaultHeaderV2 header(&jacktrip);
+    PacketHeader* volatile virtual_header = &header; // volatile: keep the virtual calls
+    QVector<int8_t> packets(num_slots * header_size);
+    for (int i = 0; i < num_slots; i++) {
+        header.increaseSequenceNumber();
+        header.putHeaderInPacket(packets.data() + i * header_size);
+    }
+
+    QElapsedTimer timer;
+    uint64_t sum = 0;
+    timer.start();
+    for (int i = 0; i < num_packets; i++) {
+        int8_t* packet = packets.data() + (i % num_slots) * header_size;
+        PacketHeader* packet_header = virtual_header;
+        sum += packet_header->getPeerLongSequenceNumber(packet) + packet_header->getPeerTimeStamp(packet);
+        packet_header->increaseSequenceNumber();
+    }
+    qint64 virtual_nsec = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < num_packets; i++) {
+        int8_t* packet = packets.data() + (i % num_slots) * header_size;
+        sum += jacktrip.getPeerLongSequenceNumber(packet) + jacktrip.getPeerTimeStamp(packet);
+        jacktrip.increaseSequenceNumber();
+    }
+    qint64 codec_nsec = timer.nsecsElapsed();
+
+    cout << "Header reads of " << num_packets << " packets (checksum " << sum << ")" << endl;
+    cout << "  virtual calls: " << static_cast<double>(virtual_nsec) / num_packets << " ns per packet" << endl;
+    cout << "  header codec:  " << static_cast<double>(codec_nsec) / num_packets << " ns per packet" << endl;
+}
+
+
+// Rebuilds random groups of packets with ForwardErrorCorrection after dropping up
+// to ParityCount of their packets (data or parity), and counts the packets that
+// don't come back exactly. Packets are 16-bit stereo periods of 128 frames with a
+// 16 byte header, so the SIMD code also runs into a tail of a few bytes. A group
+// not rebuilt, rebuilt wrong, or rebuilt from too few packets exits with an error.
+void test_fec()
+{
+    const int packet_size = 16 + 2 * 2 * 128;
+    const int num_groups = 2000;
+    const int layouts[][2] = { {1, 1}, {4, 1}, {8, 2}, {16, 4}, {20, 8} };
+    bool failed = false;
+
+    for (unsigned int l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++) {
+        const int group_size = layouts[l][0];
+        const int parity_count = layouts[l][1];
+        ForwardErrorCorrection fec(group_size, parity_count);
+        QVector<int8_t> data(group_size * packet_size);
+        QVector<int8_t> received(group_size * packet_size);
+        QVector<int8_t> parity(parity_count * packet_size);
+        const int num_packets = group_size + parity_count;
+        bool present[256];
+        int order[256];
+
+        int mismatches = 0;
+        int failures = 0;
+        int overloads_rejected = 0;
+        qint64 encode_nsec = 0;
+        qint64 decode_nsec = 0;
+        QElapsedTimer timer;
+        for (int g = 0; g < num_groups; g++) {
+            for (int i = 0; i < data.size(); i++) {
+                data[i] = static_cast<int8_t>(std::rand());
+            }
+            timer.start();
+            fec.encode(data.data(), parity.data(), packet_size);
+            encode_nsec += timer.nsecsElapsed();
+
+            // Drop from 1 to ParityCount random packets, and one more every
+            // tenth group, that can't be rebuilt
+            int dropped = 1 + (g % parity_count);
+            bool overload = (g % 10 == 9);
+            if (overload) { dropped = parity_count + 1; }
+            for (int i = 0; i < num_packets; i++) {
+                order[i] = i;
+                present[i] = true;
+            }
+            for (int i = 0; i < dropped; i++) {
+                std::swap(order[i], order[i + std::rand() % (num_packets - i)]);
+            }
+            for (int i = 0; i < dropped; i++) { present[order[i]] = false; }
+            received = data;
+            for (int i = 0; i < group_size; i++) {
+                if (!present[i]) {
+                    std::memset(received.data() + i * packet_size, 0, packet_size);
+                }
+            }
+
+            timer.restart();
+            bool ok = fec.decode(received.data(), present,
+                                 parity.data(), present + group_size, packet_size);
+            decode_nsec += timer.nsecsElapsed();
+            if (overload) {
+                if (!ok) { ++overloads_rejected; }
+            } else if (!ok) {
+                ++failures;
+            } else if (std::memcmp(received.data(), data.data(), data.size())) {
+                ++mismatches;
+            }
+        }
+
+        cout << "FEC groups of " << group_size << " packets and " << parity_count
+             << " parity packets of " << packet_size << " bytes" << endl;
+        cout << "  encode: " << encode_nsec / 1000.0 / num_groups << " us per group" << endl;
+        cout << "  decode: " << decode_nsec / 1000.0 / num_groups << " us per group" << endl;
+        cout << "  groups that can be rebuilt but aren't: " << failures << endl;
+        cout << "  groups that aren't rebuilt exactly: " << mismatches << endl;
+        cout << "  groups with too many losses rejected: " << overloads_rejected
+             << " of " << num_groups / 10 << endl;
+        failed = failed || (failures > 0) || (mismatches > 0)
+                || (overloads_rejected < num_groups / 10);
+    }
+    if (failed) {
+        std::cerr << "FAILED: groups not rebuilt, rebuilt wrong or not rejected" << endl;
+        std::exit(1);
+    }
+}
+
+
+// Compression ratio and time of LosslessCodec on 24-bit stereo periods of 128
+// frames: two partials with a little noise, like a quiet instrument. A period
+// that doesn't decode exactly exits with an error.
+void test_lossless_codec()
+{
+    const int num_channels = 2;
+    const int bytes_per_sample = 3;
+    const int num_frames = 128;
+    const int num_periods = 20000;
+    const double two_pi = 6.283185307179586;
+
+    LosslessCodec codec(num_channels, bytes_per_sample, num_frames);
+    int audio_size = codec.getAudioSize();
+    QVector<int8_t> audio(num_periods * audio_size);
+    for (int p = 0; p < num_periods; p++) {
+        for (int ch = 0; ch < num_channels; ch++) {
+            for (int n = 0; n < num_frames; n++) {
+                double t = static_cast<double>(p * num_frames + n) / 48000.0;
+                double x = 0.25 * std::sin(two_pi * 220.0 * t + ch)
+                        + 0.05 * std::sin(two_pi * 1870.0 * t)
+                        + 0.0005 * (std::rand() / static_cast<double>(RAND_MAX) - 0.5);
+                int32_t v = static_cast<int32_t>(std::floor(x * 8388608.0));
+                int8_t* sample = audio.data() + (p * audio_size)
+                        + (ch * num_frames + n) * bytes_per_sample;
+                int16_t high = static_cast<int16_t>(v >> 8);
+                std::memcpy(sample, &high, 2);
+                sample[2] = static_cast<int8_t>(v & 0xFF);
+            }
+        }
+    }
+
+    QVector<int8_t> coded(num_periods * audio_size);
+    QVector<int> coded_sizes(num_periods);
+    QElapsedTimer timer;
+    uint64_t total_coded = 0;
+    timer.start();
+    for (int p = 0; p < num_periods; p++) {
+        coded_sizes[p] = codec.encode(audio.data() + p * audio_size, coded.data() + p * audio_size);
+        total_coded += coded_sizes[p];
+    }
+    qint64 encode_nsec = timer.nsecsElapsed();
+
+    QVector<int8_t> decoded(audio_size);
+    int mismatches = 0;
+    qint64 decode_nsec = 0;
+    for (int p = 0; p < num_periods; p++) {
+        timer.restart();
+        bool ok = codec.decode(coded.data() + p * audio_size, coded_sizes[p], decoded.data());
+        decode_nsec += timer.nsecsElapsed();
+        if ( !ok || std::memcmp(decoded.data(), audio.data() + p * audio_size, audio_size) ) {
+            ++mismatches;
+        }
+    }
+
+    cout << "Lossless coding of " << num_periods << " periods of " << num_frames
+         << " frames, " << num_channels << " channels, " << 8 * bytes_per_sample << " bits" << endl;
+    cout << "  compression ratio: "
+         << static_cast<double>(total_coded) / (static_cast<double>(num_periods) * audio_size) << endl;
+    cout << "  encode: " << encode_nsec / 1000.0 / num_periods << " us per period" << endl;
+    cout << "  decode: " << decode_nsec / 1000.0 / num_periods << " us per period" << endl;
+    cout << "  periods that don't decode exactly: " << mismatches << endl;
+    if (mismatches > 0) {
+        std::cerr << "FAILED: " << mismatches << " periods don't decode exactly" << endl;
+        std::exit(1);
+    }
+}
+
+
+// Bytes of a hexadecimal string, for the known answer tests
+static QVector<uint8_t> fromHex(const char* hex)
+{
+    QVector<uint8_t> bytes(static_cast<int>(std::strlen(hex)) / 2);
+    for (int i = 0; i < bytes.size(); i++) {
+        unsigned int byte;
+        std::sscanf(hex + 2 * i, "%2x", &byte);
+        bytes[i] = static_cast<uint8_t>(byte);
+    }
+    return bytes;
+}
+
+
+// Known answers of PacketCipher: AES-128-GCM test case 4 of the GCM specification
+// (McGrew and Viega, also in the NIST test vectors), forged packets, and the
+// PBKDF2-HMAC-SHA256 vectors published along RFC 6070. A wrong answer exits with
+// an error. Then the time to seal and open packets of 528 bytes.
+void test_packet_cipher()
+{
+    if (!PacketCipher::isAvailable()) {
+        std::cerr << "FAILED: this JackTrip was built without OpenSSL, it can't encrypt" << endl;
+        std::exit(1);
+    }
+    int failures = 0;
+
+    QVector<uint8_t> key = fromHex("feffe9928665731c6d6a8f9467308308");
+    QVector<uint8_t> nonce = fromHex("cafebabefacedbaddecaf888");
+    QVector<uint8_t> aad = fromHex("feedfacedeadbeeffeedfacedeadbeefabaddad2");
+    QVector<uint8_t> plain = fromHex("d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d"
+                                     "8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657"
+                                     "ba637b39");
+    QVector<uint8_t> cipher = fromHex("42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e23"
+                                      "29aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac97"
+                                      "3d58e091");
+    QVector<uint8_t> tag = fromHex("5bc94fbc3221a5db94fae95ae7121a47");
+    PacketCipher gcm(key.data());
+    QVector<uint8_t> data = plain;
+    uint8_t sealed_tag[PacketCipher::TagSize];
+    gcm.seal(nonce.data(), aad.data(), aad.size(), data.data(), data.size(), sealed_tag);
+    if ( std::memcmp(data.data(), cipher.data(), cipher.size()) ||
+         std::memcmp(sealed_tag, tag.data(), PacketCipher::TagSize) ) {
+        std::cerr << "FAILED: AES-128-GCM test case 4 doesn't seal to the known answer" << endl;
+        ++failures;
+    }
+    if ( !gcm.open(nonce.data(), aad.data(), aad.size(), data.data(), data.size(), tag.data()) ||
+         std::memcmp(data.data(), plain.data(), plain.size()) ) {
+        std::cerr << "FAILED: AES-128-GCM test case 4 doesn't open to the known answer" << endl;
+        ++failures;
+    }
+    // A changed bit of the data, the additional data or the tag
+    for (int part = 0; part < 3; part++) {
+        QVector<uint8_t> forged = cipher;
+        QVector<uint8_t> forged_aad = aad;
+        QVector<uint8_t> forged_tag = tag;
+        QVector<uint8_t>& changed = (part == 0) ? forged : ((part == 1) ? forged_aad : forged_tag);
+        changed[changed.size() / 2] ^= 0x10;
+        if ( gcm.open(nonce.data(), forged_aad.data(), forged_aad.size(),
+                      forged.data(), forged.size(), forged_tag.data()) ) {
+            std::cerr << "FAILED: AES-128-GCM opens a forged packet" << endl;
+            ++failures;
+        }
+    }
+
+    struct Pbkdf2Vector {
+        const char* passphrase;
+        const char* salt;
+        int iterations;
+        const char* keys;
+    };
+    const Pbkdf2Vector pbkdf2_vectors[] = {
+        { "password", "salt", 1,
+          "120fb6cffcf8b32c43e7225256c4f837a86548c92ccc35480805987cb70be17b" },
+        { "password", "salt", 4096,
+          "c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a" },
+        { "passwordPASSWORDpassword", "saltSALTsaltSALTsaltSALTsaltSALTsalt", 4096,
+          "348c89dbcbd32b2f32d814b8116e84cf2b17347ebc1800181c4e2a1fb8dd53e1c635518c7dac47e9" }
+    };
+    for (unsigned int v = 0; v < sizeof(pbkdf2_vectors) / sizeof(pbkdf2_vectors[0]); v++) {
+        QVector<uint8_t> expected = fromHex(pbkdf2_vectors[v].keys);
+        QVector<uint8_t> keys(expected.size());
+        PacketCipher::deriveKeys(pbkdf2_vectors[v].passphrase,
+                                 reinterpret_cast<const uint8_t*>(pbkdf2_vectors[v].salt),
+                                 static_cast<int>(std::strlen(pbkdf2_vectors[v].salt)),
+                                 pbkdf2_vectors[v].iterations, keys.data(), keys.size());
+        if ( std::memcmp(keys.data(), expected.data(), expected.size()) ) {
+            std::cerr << "FAILED: PBKDF2-HMAC-SHA256 vector " << v + 1
+                      << " doesn't derive the known answer" << endl;
+            ++failures;
+        }
+    }
+    if (failures > 0) {
+        std::cerr << failures << " known answer tests FAILED, don't use --encrypt" << endl;
+        std::exit(1);
+    }
+    cout << "AES-128-GCM and PBKDF2-HMAC-SHA256 known answer tests passed" << endl;
+
+    const int packet_size = 16 + 2 * 2 * 128;
+    const int num_packets = 100000;
+    QVector<uint8_t> packet(packet_size);
+    QElapsedTimer timer;
+    timer.start();
+    for (int p = 0; p < num_packets; p++) {
+        std::memcpy(nonce.data() + 4, &p, sizeof(p));
+        gcm.seal(nonce.data(), aad.data(), 8, packet.data(), packet_size, sealed_tag);
+    }
+    qint64 seal_nsec = timer.nsecsElapsed();
+    QVector<uint8_t> sealed = packet;
+    int rejected = 0;
+    timer.restart();
+    for (int p = 0; p < num_packets; p++) {
+        std::memcpy(packet.data(), sealed.data(), packet_size);
+        if (!gcm.open(nonce.data(), aad.data(), 8, packet.data(), packet_size, sealed_tag)) {
+            ++rejected;
+        }
+    }
+    qint64 open_nsec = timer.nsecsElapsed();
+    if (rejected > 0) {
+        std::cerr << "FAILED: " << rejected << " authentic packets rejected" << endl;
+        std::exit(1);
+    }
+    cout << "Packets of " << packet_size << " bytes" << endl;
+    cout << "  seal: " << seal_nsec / 1000.0 / num_packets << " us per packet" << endl;
+    cout << "  open: " << open_nsec / 1000.0 / num_packets << " us per packet" << endl;
+}
+
+
+// Signal to noise ratio and time of BlockFloatCodec on stereo periods of 128
+// frames, of a loud partial and of a quiet one (-80 dB), for each mantissa size
+void test_block_float_codec()
+{
+    const int num_channels = 2;
+    const int num_frames = 128;
+    const int num_periods = 20000;
+    const double two_pi = 6.283185307179586;
+
+    QVector<sample_t> audio(num_periods * num_channels * num_frames);
+    for (int p = 0; p < num_periods; p++) {
+        for (int n = 0; n < num_frames; n++) {
+            double t = static_cast<double>(p * num_frames + n) / 48000.0;
+            sample_t* frame = audio.data() + p * num_channels * num_frames + n;
+            frame[0] = static_cast<sample_t>(0.5 * std::sin(two_pi * 440.0 * t));
+            frame[num_frames] = static_cast<sample_t>(0.0001 * std::sin(two_pi * 1000.0 * t));
+        }
+    }
+
+    cout << "Block floating point coding of " << num_periods << " periods of " << num_frames
+         << " frames, " << num_channels << " channels (16 bit packets: "
+         << 2 * num_channels * num_frames << " bytes)" << endl;
+    for (int bits = BlockFloatCodec::sMinMantissaBits; bits <= BlockFloatCodec::sMaxMantissaBits; bits++) {
+        BlockFloatCodec codec(num_channels, num_frames, bits);
+        QVector<int8_t> packet(codec.getPacketSize());
+        QVector<sample_t> decoded(num_channels * num_frames);
+        sample_t* output[num_channels];
+        for (int ch = 0; ch < num_channels; ch++) { output[ch] = decoded.data() + ch * num_frames; }
+        double signal[num_channels] = {0.0, 0.0};
+        double noise[num_channels] = {0.0, 0.0};
+        QElapsedTimer timer;
+        qint64 encode_nsec = 0;
+        qint64 decode_nsec = 0;
+        for (int p = 0; p < num_periods; p++) {
+            sample_t* input[num_channels];
+            for (int ch = 0; ch < num_channels; ch++) {
+                input[ch] = audio.data() + (p * num_channels + ch) * num_frames;
+            }
+            timer.start();
+            codec.encode(input, packet.data());
+            encode_nsec += timer.nsecsElapsed();
+            timer.restart();
+            codec.decode(packet.data(), output);
+            decode_nsec += timer.nsecsElapsed();
+            for (int ch = 0; ch < num_channels; ch++) {
+                for (int n = 0; n < num_frames; n++) {
+                    double e = input[ch][n] - output[ch][n];
+                    signal[ch] += input[ch][n] * input[ch][n];
+                    noise[ch] += e * e;
+                }
+            }
+        }
+        cout << "  " << bits << " bit mantissas: " << codec.getPacketSize() << " bytes, SNR "
+             << 10.0 * std::log10(signal[0] / noise[0]) << " dB (loud), "
+             << 10.0 * std::log10(signal[1] / noise[1]) << " dB (quiet), encode "
+             << encode_nsec / 1000.0 / num_periods << " us, decode "
+             << decode_nsec / 1000.0 / num_periods << " us per period" << endl;
+    }
+}
+
+
+// Time and signal to noise ratio of HalfFloatCodec against 16 bit audio
+// (AudioInterface::fromSampleToBitConversion), on periods of 128 frames of a
+// partial at -6 dB and at -80 dB
+void test_half_float_codec()
+{
+    const int num_frames = 128;
+    const int num_periods = 20000;
+    const double two_pi = 6.283185307179586;
+    const double gains[2] = {0.5, 0.0001};
+
+    HalfFloatCodec codec(1, num_frames);
+    QVector<sample_t> audio(num_frames);
+    QVector<sample_t> decoded(num_frames);
+    QVector<int8_t> packet(codec.getPacketSize());
+    sample_t* input = audio.data();
+    sample_t* output = decoded.data();
+    cout << "16 bit floating point against 16 bit audio, " << num_periods << " periods of "
+         << num_frames << " frames" << endl;
+    for (int g = 0; g < 2; g++) {
+        double signal = 0.0;
+        double half_noise = 0.0;
+        double bit16_noise = 0.0;
+        qint64 half_nsec = 0;
+        qint64 bit16_nsec = 0;
+        QElapsedTimer timer;
+        for (int p = 0; p < num_periods; p++) {
+            for (int n = 0; n < num_frames; n++) {
+                double t = static_cast<double>(p * num_frames + n) / 48000.0;
+                audio[n] = static_cast<sample_t>(gains[g] * std::sin(two_pi * 440.0 * t));
+            }
+            timer.start();
+            codec.encode(&input, packet.data());
+            half_nsec += timer.nsecsElapsed();
+            codec.decode(packet.data(), &output);
+            for (int n = 0; n < num_frames; n++) {
+                double e = audio[n] - decoded[n];
+                signal += static_cast<double>(audio[n]) * audio[n];
+                half_noise += e * e;
+            }
+            timer.restart();
+            AudioInterface::fromSampleToBitConversion(audio.data(), packet.data(), num_frames,
+                                                      AudioInterface::BIT16);
+            bit16_nsec += timer.nsecsElapsed();
+            for (int n = 0; n < num_frames; n++) {
+                sample_t sample;
+                AudioInterface::fromBitToSampleConversion(packet.data() + 2 * n, &sample,
+                                                          AudioInterface::BIT16);
+                double e = audio[n] - sample;
+                bit16_noise += e * e;
+            }
+        }
+        cout << "  " << 20.0 * std::log10(gains[g]) << " dB: half float SNR "
+             << 10.0 * std::log10(signal / half_noise) << " dB, "
+             << half_nsec / 1000.0 / num_periods << " us; 16 bit SNR "
+             << 10.0 * std::log10(signal / bit16_noise) << " dB, "
+             << bit16_nsec / 1000.0 / num_periods << " us per period" << endl;
+    }
+}
+
+
+// Time of the sample conversions of AudioInterface, a period of 128 frames at a
+// time against one sample at a time, and check that both give the same bits,
+// for every bit resolution and every SIMD level of the processor. Different bits
+// exit with an error. The samples are a partial at -6 dB, then full scale and out
+// of range values.
+void test_sample_conversion()
+{
+    const int num_frames = 128;
+    const int num_periods = 100000;
+    const double two_pi = 6.283185307179586;
+    const AudioInterface::audioBitResolutionT resolutions[4] = {
+        AudioInterface::BIT8, AudioInterface::BIT16, AudioInterface::BIT24, AudioInterface::BIT32 };
+
+    QVector<sample_t> audio(num_frames);
+    QVector<sample_t> decoded(num_frames);
+    QVector<sample_t> reference(num_frames);
+    QVector<int8_t> packet(4 * num_frames);
+    QVector<int8_t> reference_packet(4 * num_frames);
+    const sample_t edges[] = { 1.0f, -1.0f, 0.99999994f, -0.99999994f, 1.5f, -1.5f, 1e30f, -1e30f,
+                               1e-30f, -1e-30f, 0.0f, -0.0f, 0.5f / 8388608.0f, -0.5f / 8388608.0f };
+    const int num_edges = sizeof(edges) / sizeof(edges[0]);
+
+    cout << "Sample conversions, " << num_periods << " periods of " << num_frames << " frames" << endl;
+    // Every SIMD level the processor has, down to the code of the build target
+    const int max_level = AudioInterface::getSimdLevel();
+    int failures = 0;
+    for (int level = max_level; level >= 0; level--) {
+        AudioInterface::setSimdLevel(level);
+        cout << "  " << AudioInterface::getSimdName() << endl;
+        for (int r = 0; r < 4; r++) {
+            AudioInterface::audioBitResolutionT resolution = resolutions[r];
+            int bytes = resolution;
+            qint64 block_to_nsec = 0, block_from_nsec = 0, sample_to_nsec = 0, sample_from_nsec = 0;
+            bool exact = true;
+            QElapsedTimer timer;
+            for (int p = 0; p < num_periods; p++) {
+                for (int n = 0; n < num_frames; n++) {
+                    double t = static_cast<double>(p * num_frames + n) / 48000.0;
+                    audio[n] = static_cast<sample_t>(0.5 * std::sin(two_pi * 440.0 * t));
+                }
+                if (p == 0) {
+                    for (int n = 0; n < num_edges; n++) { audio[n] = edges[n]; }
+                }
+                timer.start();
+                AudioInterface::fromSampleToBitConversion(audio.data(), packet.data(), num_frames, resolution);
+                block_to_nsec += timer.nsecsElapsed();
+                timer.restart();
+                AudioInterface::fromBitToSampleConversion(packet.data(), decoded.data(), num_frames, resolution);
+                block_from_nsec += timer.nsecsElapsed();
+
+                timer.restart();
+                for (int n = 0; n < num_frames; n++) {
+                    AudioInterface::fromSampleToBitConversion(&audio[n], reference_packet.data() + n * bytes,
+                                                              resolution);
+                }
+                sample_to_nsec += timer.nsecsElapsed();
+                timer.restart();
+                for (int n = 0; n < num_frames; n++) {
+                    AudioInterface::fromBitToSampleConversion(reference_packet.data() + n * bytes,
+                                                              &reference[n], resolution);
+                }
+                sample_from_nsec += timer.nsecsElapsed();
+
+                exact = exact &&
+                        !std::memcmp(packet.data(), reference_packet.data(), num_frames * bytes) &&
+                        !std::memcmp(decoded.data(), reference.data(), num_frames * sizeof(sample_t));
+            }
+            double num_samples = static_cast<double>(num_periods) * num_frames;
+            cout << "    " << 8 * bytes << " bit: to network " << block_to_nsec / num_samples
+                 << " ns per sample (one at a time " << sample_to_nsec / num_samples
+                 << "), from network " << block_from_nsec / num_samples
+                 << " ns per sample (one at a time " << sample_from_nsec / num_samples
+                 << "), " << (exact ? "same bits" : "DIFFERENT BITS") << endl;
+            if (!exact) { ++failures; }
+        }
+    }
+    AudioInterface::setSimdLevel(max_level);
+    if (failures > 0) {
+        std::cerr << "FAILED: " << failures << " conversions don't give the bits of one sample at a time" << endl;
+        std::exit(1);
+    }
+}
+
+
+// Level and time of the peer audio resampler, for peers at higher and lower
+// rates than 48 kHz. A partial at -6 dB below half the local rate has to come
+// out at about the same level, and one above it (which only the higher rates
+// can carry) far below.
+void test_audio_converter()
+{
+    const int num_channels = 2;
+    const int num_frames = 128;
+    const int num_packets = 2000;
+    const int skip_packets = 10; // Filter latency
+    const int target_rate = 48000;
+    const double two_pi = 6.283185307179586;
+    const int source_rates[3] = { 96000, 88200, 44100 };
+    const double frequencies[2] = { 1000.0, 30000.0 };
+
+    QVector<sample_t> audio(num_frames);
+    QVector<int8_t> input(num_channels * num_frames * sizeof(sample_t));
+    QVector<sample_t> output;
+
+    cout << "Resampling to " << target_rate << " Hz, " << num_channels << " channels, "
+         << num_packets << " packets of " << num_frames << " frames" << endl;
+    for (int r = 0; r < 3; r++) {
+        for (int f = 0; f < 2; f++) {
+            if (frequencies[f] >= source_rates[r] / 2) { continue; }
+            AudioConverter converter(num_channels, AudioInterface::BIT32, source_rates[r],
+                                     AudioInterface::BIT32, target_rate);
+            uint32_t stride = converter.getMaxOutputFrames(num_frames);
+            output.resize(num_channels * stride);
+            double power = 0.0;
+            long count = 0;
+            qint64 nsec = 0;
+            QElapsedTimer timer;
+            for (int p = 0; p < num_packets; p++) {
+                for (int n = 0; n < num_frames; n++) {
+                    double t = static_cast<double>(p * num_frames + n) / source_rates[r];
+                    audio[n] = static_cast<sample_t>(0.5 * std::sin(two_pi * frequencies[f] * t));
+                }
+                AudioInterface::fromSampleToBitConversion(audio.data(), input.data(), num_frames,
+                                                          AudioInterface::BIT32);
+                std::memcpy(input.data() + num_frames * sizeof(sample_t), input.data(),
+                            num_frames * sizeof(sample_t));
+                timer.start();
+                uint32_t frames = converter.convert(input.data(), num_frames,
+                                                    reinterpret_cast<int8_t*>(output.data()), stride);
+                nsec += timer.nsecsElapsed();
+                if (p < skip_packets) { continue; }
+                for (uint32_t n = 0; n < frames; n++) {
+                    power += static_cast<double>(output[n]) * output[n];
+                }
+                count += frames;
+            }
+            // A partial at 0.5 has a power of 0.125
+            cout << "  " << source_rates[r] << " Hz, " << frequencies[f] << " Hz partial: "
+                 << 10.0 * std::log10(power / count / 0.125 + 1e-30) << " dB, "
+                 << nsec / 1000.0 / num_packets << " us per packet" << endl;
+        }
+    }
+}
+
+
+// Audio interface without a device, to time the callback
+class BenchmarkAudioInterface : public AudioInterface
+{
+public:
+    BenchmarkAudioInterface(JackTrip* jacktrip, int num_channels) :
+        AudioInterface(jacktrip, num_channels, num_channels,
+               #ifdef WAIR // wair
+                       0,
+               #endif // endwhere
+                       AudioInterface::BIT16) {}
+    virtual int startProcess() const { return 0; }
+    virtual int stopProcess() const { return 0; }
+    virtual void connectDefaultPorts() {}
+    virtual void setClientName(const char* /*ClientName*/) {}
+};
+
+// Plugin that does nothing: the callback takes the path it takes with plugins
+class NullPlugin : public ProcessPlugin
+{
+public:
+    virtual int getNumInputs() { return 0; }
+    virtual int getNumOutputs() { return 0; }
+    virtual void compute(int /*nframes*/, float** /*inputs*/, float** /*outputs*/) {}
+};
+
+
+// Time of AudioInterface::callback with 64 channels of 16 bit audio, in periods
+// of 128 frames sent back to the callback through the ring buffer: without
+// plugins, and with a plugin that does nothing (every period took that path
+// before the callback had a path without plugins)
+void test_audio_callback()
+{
+    const int num_channels = 64;
+    const int num_frames = 128;
+    const int num_periods = 20000;
+
+    JackTrip jacktrip;
+    BenchmarkAudioInterface audio(&jacktrip, num_channels);
+    audio.setBufferSizeInSamples(num_frames);
+    audio.setup();
+    RingBuffer* ring_buffer = new RingBuffer(num_channels * num_frames * AudioInterface::BIT16, 16);
+    jacktrip.setSendRingBuffer(ring_buffer); // JackTrip deletes it
+    jacktrip.setReceiveRingBuffer(ring_buffer);
+
+    QVector<sample_t> samples(2 * num_channels * num_frames);
+    QVarLengthArray<sample_t*> in_buffer(num_channels);
+    QVarLengthArray<sample_t*> out_buffer(num_channels);
+    for (int i = 0; i < num_channels; i++) {
+        in_buffer[i] = samples.data() + i * num_frames;
+        out_buffer[i] = samples.data() + (num_channels + i) * num_frames;
+        for (int n = 0; n < num_frames; n++) {
+            in_buffer[i][n] = static_cast<sample_t>(0.5 * std::sin(0.01 * (n + 1) * (i + 1)));
+        }
+    }
+
+    NullPlugin plugin;
+    qint64 nsec[2];
+    QElapsedTimer timer;
+    for (int k = 0; k < 2; k++) {
+        if (k == 1) { audio.appendProcessPlugin(&plugin); }
+        timer.start();
+        for (int p = 0; p < num_periods; p++) {
+            audio.callback(in_buffer, out_buffer, num_frames);
+        }
+        nsec[k] = timer.nsecsElapsed();
+    }
+    jacktrip.setReceiveRingBuffer(NULL);
+
+    cout << "Audio callback, " << num_channels << " channels, " << num_periods << " periods of "
+         << num_frames << " frames" << endl;
+    cout << "  without plugins:                 " << nsec[0] / 1000.0 / num_periods << " us per period" << endl;
+    cout << "  with a plugin that does nothing: " << nsec[1] / 1000.0 / num_periods << " us per period" << endl;
+}